@@ -0,0 +1,93 @@
+#include <iostream>
+#include <format>
+#include <chrono>
+#include <string_view>
+#include <stdexcept>
+#include <cstring>
+#include <meshark/meshlet-dag.h>
+#include <meshark/mesh-io.h>
+using namespace meshark;
+
+template<typename T>
+static bool sameBytes(const std::vector<T> &a, const std::vector<T> &b) {
+  return a.size() == b.size() && std::memcmp(a.data(), b.data(), a.size() * sizeof(T)) == 0;
+}
+
+static void printUsage(const char *program) {
+  std::cerr << "Usage: " << program << " [--threads <n>] [--group-size <n>] [--check] <input obj path> <output dag path>"
+            << std::endl;
+}
+
+int main(int argc, char **argv) {
+  MeshletDagOptions options;
+  bool check = false;
+  std::vector<const char *> positional;
+  try {
+    for (int i = 1; i < argc; i++) {
+      std::string_view arg(argv[i]);
+      if (arg == "--threads" && i + 1 < argc)
+        options.num_threads = std::stoi(argv[++i]);
+      else if (arg == "--group-size" && i + 1 < argc)
+        options.group_size = std::stoi(argv[++i]);
+      else if (arg == "--check")
+        check = true;
+      else
+        positional.push_back(argv[i]);
+    }
+  } catch (const std::logic_error &) {
+    printUsage(argv[0]);
+    return 1;
+  }
+  if (positional.size() != 2) {
+    printUsage(argv[0]);
+    return 1;
+  }
+  auto mesh = readGeometryMeshFromWavefrontObj(positional[0]);
+  if (!mesh) return 1;
+  auto start = std::chrono::steady_clock::now();
+  auto dag = MeshletDagBuilder(*mesh).build(options);
+  std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+  std::vector<int> clusters_per_level;
+  std::vector<size_t> triangles_per_level;
+  for (const auto &cluster : dag->clusters) {
+    if (cluster.level >= clusters_per_level.size()) {
+      clusters_per_level.resize(cluster.level + 1);
+      triangles_per_level.resize(cluster.level + 1);
+    }
+    clusters_per_level[cluster.level]++;
+    triangles_per_level[cluster.level] += cluster.num_triangles;
+  }
+  for (size_t level = 0; level < clusters_per_level.size(); level++)
+    std::cout << std::format("Level {}: {} clusters, {:.1f} triangles per cluster\n", level, clusters_per_level[level],
+                             static_cast<double>(triangles_per_level[level]) / clusters_per_level[level]);
+  std::cout << std::format("{} clusters in {} groups, built in {:.2f}s\n", dag->clusters.size(), dag->groups.size(),
+                           elapsed.count());
+  // A level has to reduce the cluster count by about the factor the groups simplify by, and keep its
+  // clusters filled, or a renderer gains little from walking down the DAG.
+  bool ok = true;
+  for (size_t level = 0; check && level < clusters_per_level.size(); level++) {
+    double fill = static_cast<double>(triangles_per_level[level]) / clusters_per_level[level];
+    if (level + 1 < clusters_per_level.size() && fill < 0.5 * options.max_triangles) {
+      std::cerr << std::format("Level {} fills its clusters with {:.1f} of {} triangles\n", level, fill,
+                               options.max_triangles);
+      ok = false;
+    }
+    if (level > 0 && clusters_per_level[level - 1] > options.group_size &&
+        3 * clusters_per_level[level] > 2 * clusters_per_level[level - 1]) {
+      std::cerr << std::format("Level {} has {} clusters after {} on level {}\n", level, clusters_per_level[level],
+                               clusters_per_level[level - 1], level - 1);
+      ok = false;
+    }
+  }
+  if (!writeMeshletDag(*dag, positional[1])) return 1;
+  if (check) {
+    auto read = readMeshletDag(positional[1]);
+    if (!read || !sameBytes(read->positions, dag->positions) || !sameBytes(read->indices, dag->indices)
+        || !sameBytes(read->clusters, dag->clusters) || !sameBytes(read->groups, dag->groups)
+        || !sameBytes(read->group_children, dag->group_children)) {
+      std::cerr << "Reading back " << positional[1] << " does not give the DAG that was written" << std::endl;
+      ok = false;
+    }
+  }
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,129 @@
+#include <iostream>
+#include <format>
+#include <chrono>
+#include <random>
+#include <string_view>
+#include <stdexcept>
+#include <meshark/bvh.h>
+#include <meshark/mesh-io.h>
+#include <mystl/parallel-for.h>
+using namespace meshark;
+
+static void printUsage(const char *program) {
+  std::cerr << "Usage: " << program << " [options] <input obj path>\n"
+            << "Builds a BVH over the faces and measures ray, occlusion and closest-point queries.\n"
+            << "Options:\n"
+            << "  --threads <n>            build and query threads (0: all cores)\n"
+            << "  --queries <n>            queries of each kind (default 1000000)\n"
+            << "  --leaf-size <n>          maximum leaf size (default 4)\n"
+            << "  --check <n>              also compare n queries of each kind with brute force" << std::endl;
+}
+
+template<typename Func>
+static double timeIt(Func &&func) {
+  auto start = std::chrono::steady_clock::now();
+  func();
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main(int argc, char **argv) {
+  BvhOptions options;
+  int num_queries = 1000000;
+  int num_checks = 0;
+  std::vector<const char *> positional;
+  try {
+    for (int i = 1; i < argc; i++) {
+      std::string_view arg(argv[i]);
+      if (arg == "--threads" && i + 1 < argc)
+        options.num_threads = std::stoi(argv[++i]);
+      else if (arg == "--queries" && i + 1 < argc)
+        num_queries = std::max(std::stoi(argv[++i]), 1);
+      else if (arg == "--leaf-size" && i + 1 < argc)
+        options.max_leaf_size = std::max(std::stoi(argv[++i]), 1);
+      else if (arg == "--check" && i + 1 < argc)
+        num_checks = std::max(std::stoi(argv[++i]), 0);
+      else
+        positional.push_back(argv[i]);
+    }
+  } catch (const std::logic_error &) {
+    printUsage(argv[0]);
+    return 1;
+  }
+  if (positional.size() != 1) {
+    printUsage(argv[0]);
+    return 1;
+  }
+  auto mesh = readGeometryMeshFromWavefrontObj(positional[0]);
+  if (!mesh) return 1;
+  std::unique_ptr<FaceBvh> bvh;
+  double build_seconds = timeIt([&] { bvh = std::make_unique<FaceBvh>(*mesh, options); });
+  std::cout << std::format("{} faces: built {} nodes in {:.1f}ms, SAH cost {:.2f}\n", mesh->numFaces(),
+                           bvh->nodes.size(), build_seconds * 1e3, bvh->sahCost());
+
+  // Rays from a sphere around the mesh towards points in its box, closest points in a slightly larger box.
+  glm::vec3 lo(std::numeric_limits<float>::max()), hi(std::numeric_limits<float>::lowest());
+  for (auto v : mesh->vertices()) {
+    lo = glm::min(lo, mesh->pos(v));
+    hi = glm::max(hi, mesh->pos(v));
+  }
+  auto center = (lo + hi) * 0.5f;
+  float radius = glm::length(hi - lo);
+  std::mt19937 rng(0);
+  std::uniform_real_distribution<float> uniform(0.0f, 1.0f);
+  std::normal_distribution<float> normal;
+  auto inBox = [&](float scale) {
+    glm::vec3 t(uniform(rng), uniform(rng), uniform(rng));
+    return center + (lo - center + (hi - lo) * t) * scale;
+  };
+  std::vector<Ray> rays(num_queries);
+  std::vector<glm::vec3> points(num_queries);
+  for (int i = 0; i < num_queries; i++) {
+    auto origin = center + glm::normalize(glm::vec3(normal(rng), normal(rng), normal(rng))) * radius;
+    rays[i] = Ray{.origin = origin, .direction = glm::normalize(inBox(1.0f) - origin)};
+    points[i] = inBox(1.1f);
+  }
+
+  std::vector<std::optional<RayHit>> hits(num_queries);
+  std::vector<char> occluded(num_queries);
+  std::vector<std::optional<ClosestPoint>> closest(num_queries);
+  double ray_seconds = timeIt([&] {
+    mystl::parallel_for(0, num_queries, [&](int i) { hits[i] = bvh->intersect(rays[i]); }, options.num_threads);
+  });
+  double occlusion_seconds = timeIt([&] {
+    mystl::parallel_for(0, num_queries, [&](int i) { occluded[i] = bvh->occluded(rays[i]); }, options.num_threads);
+  });
+  double closest_seconds = timeIt([&] {
+    mystl::parallel_for(0, num_queries, [&](int i) { closest[i] = bvh->closestPoint(points[i]); },
+                        options.num_threads);
+  });
+  int num_hits = 0;
+  for (const auto &hit : hits)
+    num_hits += hit.has_value();
+  std::cout << std::format("closest hit:   {:.2f}M rays/s, {:.1f}% hit\n", num_queries / ray_seconds * 1e-6,
+                           100.0 * num_hits / num_queries);
+  std::cout << std::format("any hit:       {:.2f}M rays/s\n", num_queries / occlusion_seconds * 1e-6);
+  std::cout << std::format("closest point: {:.2f}M queries/s\n", num_queries / closest_seconds * 1e-6);
+
+  if (num_checks == 0) return 0;
+  // Hits of several faces at the same distance can be reported for either face, so only distances count.
+  int mismatches = 0;
+  num_checks = std::min(num_checks, num_queries);
+  for (int i = 0; i < num_checks; i++) {
+    std::optional<float> t;
+    float d = std::numeric_limits<float>::infinity();
+    for (const auto &triangle : bvh->triangles) {
+      if (auto hit = intersectTriangle(triangle, rays[i]); hit && (!t || hit->t < *t)) t = hit->t;
+      d = std::min(d, glm::length(closestPointOnTriangle(triangle, points[i]) - points[i]));
+    }
+    bool ray_ok = t.has_value() == hits[i].has_value() && (!t || *t == hits[i]->t);
+    bool occlusion_ok = t.has_value() == static_cast<bool>(occluded[i]);
+    bool closest_ok = closest[i] && closest[i]->distance == d;
+    if (!ray_ok || !occlusion_ok || !closest_ok) {
+      if (mismatches++ < 10)
+        std::cerr << std::format("Query {} differs from brute force: ray {}, occlusion {}, closest point {}\n", i,
+                                 ray_ok, occlusion_ok, closest_ok);
+    }
+  }
+  std::cout << std::format("{} of {} checked queries differ from brute force\n", mismatches, num_checks);
+  return mismatches ? 1 : 0;
+}
@@ -0,0 +1,59 @@
+#include <iostream>
+#include <format>
+#include <meshark/mesh-simplifier.h>
+#include <meshark/mesh-io.h>
+using namespace meshark;
+
+// FNV-1a over the raw bytes of the positions and the face indices.
+static uint64_t hashWavefrontObj(const WavefrontObj &obj) {
+  uint64_t h = 0xcbf29ce484222325ull;
+  auto feed = [&](const void *data, size_t size) {
+    auto bytes = static_cast<const unsigned char *>(data);
+    for (size_t i = 0; i < size; i++)
+      h = (h ^ bytes[i]) * 0x100000001b3ull;
+  };
+  feed(obj.positions.data(), obj.positions.size() * sizeof(glm::vec3));
+  feed(obj.face_splits.data(), obj.face_splits.size() * sizeof(int));
+  for (const auto &fv : obj.face_vertices)
+    feed(&fv.v, sizeof(fv.v));
+  return h;
+}
+
+// Simplifies every input with the parallel and the clustered simplifier under several thread counts
+// and fails if the results are not bit-identical.
+int main(int argc, char **argv) {
+  if (argc < 2) {
+    std::cerr << "Usage: " << argv[0] << " <obj path>..." << std::endl;
+    return 1;
+  }
+  constexpr Real kRatio = 0.25;
+  constexpr int kThreadCounts[] = {1, 2, 8, 64};
+  bool identical = true;
+  for (int i = 1; i < argc; i++) {
+    for (auto cost_model : {SimplifyCostModel::kQuadricError, SimplifyCostModel::kMemoryless}) {
+      for (bool clustered : {false, true}) {
+        std::optional<uint64_t> expected;
+        for (int num_threads : kThreadCounts) {
+          auto mesh = readGeometryMeshFromWavefrontObj(argv[i]);
+          if (!mesh) return 1;
+          MeshSimplifier simplifier(*mesh, cost_model);
+          if (clustered)
+            simplifier.runClusteredSimplify(kRatio, num_threads);
+          else
+            simplifier.runParallelSimplify(kRatio, num_threads);
+          auto hash = hashWavefrontObj(*mesh->toWavefrontObj());
+          std::cout << std::format("{} {} {} threads {:2}: {:016x}\n", argv[i],
+                                   cost_model == SimplifyCostModel::kMemoryless ? "memoryless" : "qem",
+                                   clustered ? "clustered" : "parallel", num_threads, hash);
+          if (!expected) expected = hash;
+          identical &= hash == *expected;
+        }
+      }
+    }
+  }
+  if (!identical) {
+    std::cerr << "Results differ between thread counts" << std::endl;
+    return 1;
+  }
+  return 0;
+}
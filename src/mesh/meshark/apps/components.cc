@@ -0,0 +1,97 @@
+#include <iostream>
+#include <format>
+#include <chrono>
+#include <string_view>
+#include <stdexcept>
+#include <meshark/connected-components.h>
+#include <meshark/mesh-io.h>
+#include <meshark/mesh-simplifier.h>
+#include <mystl/parallel-for.h>
+using namespace meshark;
+
+static void printUsage(const char *program) {
+  std::cerr << "Usage: " << program << " [options] <input obj path> [output obj path]\n"
+            << "Splits a mesh into its edge-connected components, written next to the output path with the\n"
+            << "component index appended to its stem.\n"
+            << "Options:\n"
+            << "  --threads <n>            worker threads (0: all cores)\n"
+            << "  --min-faces <n>          drop components with fewer faces (default 0)\n"
+            << "  --simplify <alpha>       simplify the closed components concurrently to alpha of their faces" << std::endl;
+}
+
+template<typename Func>
+static double timeIt(Func &&func) {
+  auto start = std::chrono::steady_clock::now();
+  func();
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main(int argc, char **argv) {
+  int num_threads = 0;
+  int min_faces = 0;
+  Real alpha = 0;
+  std::vector<const char *> positional;
+  try {
+    for (int i = 1; i < argc; i++) {
+      std::string_view arg(argv[i]);
+      if (arg == "--threads" && i + 1 < argc)
+        num_threads = std::stoi(argv[++i]);
+      else if (arg == "--min-faces" && i + 1 < argc)
+        min_faces = std::stoi(argv[++i]);
+      else if (arg == "--simplify" && i + 1 < argc)
+        alpha = std::stod(argv[++i]);
+      else
+        positional.push_back(argv[i]);
+    }
+  } catch (const std::logic_error &) {
+    printUsage(argv[0]);
+    return 1;
+  }
+  if (positional.empty() || positional.size() > 2) {
+    printUsage(argv[0]);
+    return 1;
+  }
+  auto mesh = readGeometryMeshFromWavefrontObj(positional[0]);
+  if (!mesh) return 1;
+  FaceComponents components;
+  double label_seconds = timeIt([&] { components = findConnectedComponents(*mesh, num_threads); });
+  std::vector<std::unique_ptr<GeometryMesh>> meshes;
+  double split_seconds = timeIt([&] { meshes = splitComponents(*mesh, components, min_faces, num_threads); });
+  if (meshes.empty() && components.numComponents() > 0) return 1;
+  int num_kept = 0;
+  for (const auto &component : meshes)
+    num_kept += component != nullptr;
+  std::cout << std::format("{} faces, {} components: labelled in {:.1f}ms, {} kept and split in {:.1f}ms\n",
+                           mesh->numFaces(), components.numComponents(), label_seconds * 1e3, num_kept,
+                           split_seconds * 1e3);
+
+  if (alpha > 0) {
+    // Every component is simplified on its own thread instead of all of them in one mesh.
+    std::vector<char> closed(meshes.size());
+    double simplify_seconds = timeIt([&] {
+      mystl::parallel_for(0, static_cast<int>(meshes.size()), [&](int c) {
+        if (!meshes[c]) return;
+        closed[c] = true;
+        for (auto h : meshes[c]->halfEdges())
+          closed[c] = closed[c] && h->twin;
+        if (!closed[c]) return;
+        MeshSimplifier simplifier(*meshes[c]);
+        simplifier.runSimplify(alpha);
+      }, num_threads, 1);
+    });
+    int num_simplified = 0;
+    for (char c : closed)
+      num_simplified += c;
+    std::cout << std::format("simplified {} closed components in {:.1f}ms\n", num_simplified,
+                             simplify_seconds * 1e3);
+  }
+
+  if (positional.size() < 2) return 0;
+  std::filesystem::path output(positional[1]);
+  for (size_t c = 0; c < meshes.size(); c++) {
+    if (!meshes[c]) continue;
+    auto path = output.parent_path() / std::format("{}-{}{}", output.stem().string(), c, output.extension().string());
+    if (!writeWavefrontObj(*meshes[c]->toWavefrontObj(), path)) return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,117 @@
+#include <iostream>
+#include <format>
+#include <chrono>
+#include <string_view>
+#include <stdexcept>
+#include <meshark/curvature.h>
+#include <meshark/mesh-io.h>
+#include <meshark/subdivision.h>
+using namespace meshark;
+
+static void printUsage(const char *program) {
+  std::cerr << "Usage: " << program << " [options] <input obj path>\n"
+            << "Estimates per-vertex curvatures of a closed triangle mesh and summarizes them.\n"
+            << "Options:\n"
+            << "  --threads <n>            threads (0: all cores)\n"
+            << "  --subdivide <n>          Loop subdivision levels applied first (default 0)\n"
+            << "  --check sphere           project onto the unit sphere around the origin, where H = K = 1\n"
+            << "  --check torus            compare with the torus around the thinnest axis of the bounding box" << std::endl;
+}
+
+template<typename Func>
+static double timeIt(Func &&func) {
+  auto start = std::chrono::steady_clock::now();
+  func();
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+static void printRange(const char *name, const GeometryMesh &mesh, const VertexData<float> &values) {
+  float lo = std::numeric_limits<float>::infinity(), hi = -lo;
+  double sum = 0.0;
+  for (auto v : mesh.vertices()) {
+    lo = std::min(lo, values(v));
+    hi = std::max(hi, values(v));
+    sum += values(v);
+  }
+  std::cout << std::format("{:>9}: min {:.4g}, mean {:.4g}, max {:.4g}\n", name, lo,
+                           sum / static_cast<double>(mesh.numVertices()), hi);
+}
+
+// Mean absolute errors of the principal curvatures of a torus, and how well the minimum direction
+// follows the latitudes (1 is perfect). The tube radius is half the extent along the thinnest axis.
+static void checkTorus(const GeometryMesh &mesh, const VertexCurvatures &curvatures) {
+  glm::vec3 lo(std::numeric_limits<float>::infinity()), hi(-std::numeric_limits<float>::infinity());
+  for (auto v : mesh.vertices()) {
+    lo = glm::min(lo, mesh.pos(v));
+    hi = glm::max(hi, mesh.pos(v));
+  }
+  auto extent = hi - lo;
+  int axis = extent.x < extent.y ? (extent.x < extent.z ? 0 : 2) : (extent.y < extent.z ? 1 : 2);
+  auto center = (lo + hi) * 0.5f;
+  float tube = extent[axis] * 0.5f;
+  float ring = extent[(axis + 1) % 3] * 0.5f - tube;
+  glm::vec3 up(0.0f);
+  up[axis] = 1.0f;
+  double max_error = 0.0, min_error = 0.0, alignment = 0.0;
+  for (auto v : mesh.vertices()) {
+    auto q = mesh.pos(v) - center;
+    q[axis] = 0.0f;
+    float cos_phi = (glm::length(q) - ring) / tube;
+    max_error += std::abs(curvatures.max_curvature(v) - 1.0f / tube);
+    min_error += std::abs(curvatures.min_curvature(v) - cos_phi / (ring + tube * cos_phi));
+    alignment += std::abs(glm::dot(curvatures.min_direction(v), glm::normalize(glm::cross(up, q))));
+  }
+  auto n = static_cast<double>(mesh.numVertices());
+  std::cout << std::format("torus R = {:.3g}, r = {:.3g}: max curvature error {:.4g} (of {:.4g}), min curvature "
+                           "error {:.4g}, min direction alignment {:.3f}\n", ring, tube, max_error / n, 1.0 / tube,
+                           min_error / n, alignment / n);
+}
+
+int main(int argc, char **argv) {
+  int num_threads = 0;
+  int levels = 0;
+  std::string_view check;
+  std::vector<const char *> positional;
+  try {
+    for (int i = 1; i < argc; i++) {
+      std::string_view arg(argv[i]);
+      if (arg == "--threads" && i + 1 < argc)
+        num_threads = std::stoi(argv[++i]);
+      else if (arg == "--subdivide" && i + 1 < argc)
+        levels = std::max(std::stoi(argv[++i]), 0);
+      else if (arg == "--check" && i + 1 < argc)
+        check = argv[++i];
+      else
+        positional.push_back(argv[i]);
+    }
+  } catch (const std::logic_error &) {
+    printUsage(argv[0]);
+    return 1;
+  }
+  if (positional.size() != 1 || (!check.empty() && check != "sphere" && check != "torus")) {
+    printUsage(argv[0]);
+    return 1;
+  }
+  auto mesh = readGeometryMeshFromWavefrontObj(positional[0]);
+  if (!mesh) return 1;
+  if (levels) {
+    mesh = loopSubdivide(*mesh, levels, num_threads);
+    if (!mesh) return 1;
+  }
+  if (check == "sphere") {
+    std::vector<glm::vec3> positions(mesh->numVertices());
+    for (int i = 0; i < static_cast<int>(positions.size()); i++)
+      positions[i] = glm::normalize(mesh->pos(mesh->vertex(i)));
+    mesh->setVertexPositions(positions, num_threads);
+  }
+  std::optional<VertexCurvatures> curvatures;
+  double seconds = timeIt([&] { curvatures = computeCurvatures(*mesh, num_threads); });
+  if (!curvatures) return 1;
+  std::cout << std::format("{} vertices in {:.1f}ms\n", mesh->numVertices(), seconds * 1e3);
+  printRange("mean", *mesh, curvatures->mean);
+  printRange("gaussian", *mesh, curvatures->gaussian);
+  printRange("max", *mesh, curvatures->max_curvature);
+  printRange("min", *mesh, curvatures->min_curvature);
+  if (check == "torus") checkTorus(*mesh, *curvatures);
+  return 0;
+}
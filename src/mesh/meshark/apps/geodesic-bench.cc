@@ -0,0 +1,131 @@
+#include <iostream>
+#include <format>
+#include <chrono>
+#include <queue>
+#include <random>
+#include <string_view>
+#include <stdexcept>
+#include <meshark/heat-geodesics.h>
+#include <meshark/mesh-io.h>
+#include <mystl/parallel-for.h>
+using namespace meshark;
+
+static void printUsage(const char *program) {
+  std::cerr << "Usage: " << program << " [options] <input obj path>\n"
+            << "Factors the heat method systems once and measures geodesic distance queries from random sources.\n"
+            << "Options:\n"
+            << "  --threads <n>            build threads and concurrent queries (0: all cores)\n"
+            << "  --queries <n>            queries (default 100)\n"
+            << "  --sources <n>            source vertices per query (default 1)\n"
+            << "  --time-scale <f>         diffusion time in squared mean edge lengths (default 1)\n"
+            << "  --check                  compare the first query with Dijkstra along the edges" << std::endl;
+}
+
+template<typename Func>
+static double timeIt(Func &&func) {
+  auto start = std::chrono::steady_clock::now();
+  func();
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Shortest paths along the edges, never shorter than geodesics.
+static std::vector<double> edgeDistances(const GeometryMesh &mesh, const std::vector<int> &sources) {
+  std::vector<double> distances(mesh.numVertices(), std::numeric_limits<double>::infinity());
+  std::priority_queue<std::pair<double, int>, std::vector<std::pair<double, int>>, std::greater<>> queue;
+  for (int s : sources) {
+    distances[s] = 0.0;
+    queue.emplace(0.0, s);
+  }
+  while (!queue.empty()) {
+    auto [d, i] = queue.top();
+    queue.pop();
+    if (d > distances[i]) continue;
+    auto v = mesh.vertex(i);
+    for (auto h : v->outgoingHalfEdges()) {
+      int j = mesh.index(h->tip);
+      double dj = d + glm::length(mesh.pos(h->tip) - mesh.pos(v));
+      if (dj >= distances[j]) continue;
+      distances[j] = dj;
+      queue.emplace(dj, j);
+    }
+  }
+  return distances;
+}
+
+int main(int argc, char **argv) {
+  HeatGeodesicOptions options;
+  int num_queries = 100;
+  int num_sources = 1;
+  bool check = false;
+  std::vector<const char *> positional;
+  try {
+    for (int i = 1; i < argc; i++) {
+      std::string_view arg(argv[i]);
+      if (arg == "--threads" && i + 1 < argc)
+        options.num_threads = std::stoi(argv[++i]);
+      else if (arg == "--queries" && i + 1 < argc)
+        num_queries = std::max(std::stoi(argv[++i]), 1);
+      else if (arg == "--sources" && i + 1 < argc)
+        num_sources = std::max(std::stoi(argv[++i]), 1);
+      else if (arg == "--time-scale" && i + 1 < argc)
+        options.time_scale = std::stod(argv[++i]);
+      else if (arg == "--check")
+        check = true;
+      else
+        positional.push_back(argv[i]);
+    }
+  } catch (const std::logic_error &) {
+    printUsage(argv[0]);
+    return 1;
+  }
+  if (positional.size() != 1) {
+    printUsage(argv[0]);
+    return 1;
+  }
+  auto mesh = readGeometryMeshFromWavefrontObj(positional[0]);
+  if (!mesh || mesh->numVertices() == 0) return 1;
+  std::unique_ptr<HeatGeodesics> geodesics;
+  double build_seconds = timeIt([&] { geodesics = buildHeatGeodesics(*mesh, options); });
+  if (!geodesics) return 1;
+  std::cout << std::format("{} vertices: factored in {:.1f}ms, {} + {} nonzeros\n", mesh->numVertices(),
+                           build_seconds * 1e3, geodesics->heat_factor->nonZeros(),
+                           geodesics->poisson_factor->nonZeros());
+
+  std::mt19937 rng(0);
+  std::uniform_int_distribution<int> vertex(0, static_cast<int>(mesh->numVertices()) - 1);
+  std::vector<std::vector<int>> sources(num_queries);
+  for (auto &query : sources)
+    for (int k = 0; k < num_sources; k++)
+      query.push_back(vertex(rng));
+  // The triangular solves are serial, so queries run side by side rather than each on all threads.
+  geodesics->num_threads = 1;
+  std::vector<std::optional<GeodesicDistances>> results(num_queries);
+  double query_seconds = timeIt([&] {
+    mystl::parallel_for(0, num_queries, [&](int i) { results[i] = geodesics->distances(sources[i]); },
+                        options.num_threads, 1);
+  });
+  double heat = 0.0, divergence = 0.0, poisson = 0.0;
+  for (const auto &result : results) {
+    heat += result->heat_seconds;
+    divergence += result->divergence_seconds;
+    poisson += result->poisson_seconds;
+  }
+  std::cout << std::format("{:.1f} queries/s, {:.1f} sources/s\n", num_queries / query_seconds,
+                           num_queries * num_sources / query_seconds);
+  std::cout << std::format("per query: heat {:.2f}ms, divergence {:.2f}ms, poisson {:.2f}ms\n",
+                           heat / num_queries * 1e3, divergence / num_queries * 1e3, poisson / num_queries * 1e3);
+
+  if (!check) return 0;
+  auto reference = edgeDistances(*mesh, sources.front());
+  const auto &distances = results.front()->distances;
+  double relative = 0.0;
+  int count = 0;
+  for (size_t i = 0; i < reference.size(); i++) {
+    if (reference[i] == 0.0 || std::isinf(reference[i])) continue;
+    relative += (reference[i] - distances[i]) / reference[i];
+    count++;
+  }
+  std::cout << std::format("edge paths are {:.2f}% longer than heat distances on average\n",
+                           count ? 100.0 * relative / count : 0.0);
+  return 0;
+}
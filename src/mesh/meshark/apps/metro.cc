@@ -0,0 +1,85 @@
+#include <iostream>
+#include <format>
+#include <chrono>
+#include <string_view>
+#include <stdexcept>
+#include <meshark/mesh-distance.h>
+#include <meshark/mesh-io.h>
+using namespace meshark;
+
+static void printUsage(const char *program) {
+  std::cerr << "Usage: " << program << " [options] <original obj path> <simplified obj path>\n"
+            << "Samples both surfaces and measures the distances between them in both directions.\n"
+            << "Options:\n"
+            << "  --samples <n>            area samples per direction (default 1000000)\n"
+            << "  --no-vertex-samples      do not also sample the vertices\n"
+            << "  --seed <n>               seed of the sample positions (default 0)\n"
+            << "  --threads <n>            threads (0: all cores)\n"
+            << "  --max-hausdorff <f>      fail if the Hausdorff distance exceeds f times the diagonal\n"
+            << "  --max-rms <f>            fail if the RMS distance exceeds f times the diagonal" << std::endl;
+}
+
+static void printDirection(std::string_view name, const SurfaceDistance &distance, double diagonal) {
+  std::cout << std::format("{}: {} area + {} vertex samples, max {:.6g} ({:.4f}% of diagonal), mean {:.6g}, "
+                           "rms {:.6g}\n",
+                           name, distance.num_area_samples, distance.num_vertex_samples, distance.max,
+                           100.0 * distance.max / diagonal, distance.mean, distance.rms);
+}
+
+int main(int argc, char **argv) {
+  MeshDistanceOptions options;
+  std::optional<double> max_hausdorff, max_rms;
+  std::vector<const char *> positional;
+  try {
+    for (int i = 1; i < argc; i++) {
+      std::string_view arg(argv[i]);
+      if (arg == "--samples" && i + 1 < argc)
+        options.num_samples = std::max<int64_t>(std::stoll(argv[++i]), 0);
+      else if (arg == "--no-vertex-samples")
+        options.sample_vertices = false;
+      else if (arg == "--seed" && i + 1 < argc)
+        options.seed = std::stoull(argv[++i]);
+      else if (arg == "--threads" && i + 1 < argc)
+        options.num_threads = std::stoi(argv[++i]);
+      else if (arg == "--max-hausdorff" && i + 1 < argc)
+        max_hausdorff = std::stod(argv[++i]);
+      else if (arg == "--max-rms" && i + 1 < argc)
+        max_rms = std::stod(argv[++i]);
+      else
+        positional.push_back(argv[i]);
+    }
+  } catch (const std::logic_error &) {
+    printUsage(argv[0]);
+    return 1;
+  }
+  if (positional.size() != 2) {
+    printUsage(argv[0]);
+    return 1;
+  }
+  auto original = readGeometryMeshFromWavefrontObj(positional[0]);
+  if (!original) return 1;
+  auto simplified = readGeometryMeshFromWavefrontObj(positional[1]);
+  if (!simplified) return 1;
+  auto start = std::chrono::steady_clock::now();
+  auto distance = measureMeshDistance(*original, *simplified, options);
+  std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+  double diagonal = distance.diagonal > 0.0 ? distance.diagonal : 1.0;
+  std::cout << std::format("original {} faces, simplified {} faces, diagonal {:.6g}\n", original->numFaces(),
+                           simplified->numFaces(), distance.diagonal);
+  printDirection("original -> simplified", distance.forward, diagonal);
+  printDirection("simplified -> original", distance.backward, diagonal);
+  std::cout << std::format("Hausdorff {:.6g} ({:.4f}% of diagonal), rms {:.6g} ({:.4f}% of diagonal), "
+                           "measured in {:.2f}s\n",
+                           distance.hausdorff(), 100.0 * distance.hausdorff() / diagonal, distance.rms(),
+                           100.0 * distance.rms() / diagonal, elapsed.count());
+  bool failed = false;
+  if (max_hausdorff && distance.hausdorff() > *max_hausdorff * diagonal) {
+    std::cerr << std::format("Hausdorff distance exceeds {} of the diagonal\n", *max_hausdorff);
+    failed = true;
+  }
+  if (max_rms && distance.rms() > *max_rms * diagonal) {
+    std::cerr << std::format("RMS distance exceeds {} of the diagonal\n", *max_rms);
+    failed = true;
+  }
+  return failed ? 1 : 0;
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <algorithm>
+#include <charconv>
+#include <functional>
+#include <string_view>
+#include <vector>
+#include <meshark/mesh-simplifier.h>
+
+namespace meshark {
+// Comma-separated ratios from the command line, largest first. Empty if list holds anything but numbers.
+inline std::vector<Real> parseRatios(std::string_view list) {
+  std::vector<Real> ratios;
+  while (!list.empty()) {
+    auto comma = list.find(',');
+    auto item = list.substr(0, comma);
+    Real ratio;
+    auto [end, error] = std::from_chars(item.data(), item.data() + item.size(), ratio);
+    if (error != std::errc() || end != item.data() + item.size()) return {};
+    ratios.push_back(ratio);
+    list = comma == std::string_view::npos ? std::string_view{} : list.substr(comma + 1);
+  }
+  std::sort(ratios.begin(), ratios.end(), std::greater<>());
+  return ratios;
+}
+}
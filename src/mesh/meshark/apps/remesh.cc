@@ -0,0 +1,59 @@
+#include <iostream>
+#include <format>
+#include <string_view>
+#include <stdexcept>
+#include <meshark/isotropic-remesher.h>
+#include <meshark/mesh-io.h>
+using namespace meshark;
+
+static void printUsage(const char *program) {
+  std::cerr << "Usage: " << program << " [options] <input obj path> <output obj path>\n"
+            << "Remeshes a closed triangle mesh towards uniform edge lengths.\n"
+            << "Options:\n"
+            << "  --length <f>             target edge length (default: mean edge length of the input)\n"
+            << "  --iterations <n>         split, collapse, flip and smooth iterations (default 5)\n"
+            << "  --no-project             do not project the vertices back onto the input surface\n"
+            << "  --threads <n>            threads (0: all cores)" << std::endl;
+}
+
+int main(int argc, char **argv) {
+  RemeshOptions options;
+  std::vector<const char *> positional;
+  try {
+    for (int i = 1; i < argc; i++) {
+      std::string_view arg(argv[i]);
+      if (arg == "--length" && i + 1 < argc)
+        options.target_edge_length = std::stof(argv[++i]);
+      else if (arg == "--iterations" && i + 1 < argc)
+        options.num_iterations = std::max(std::stoi(argv[++i]), 0);
+      else if (arg == "--no-project")
+        options.project = false;
+      else if (arg == "--threads" && i + 1 < argc)
+        options.num_threads = std::stoi(argv[++i]);
+      else
+        positional.push_back(argv[i]);
+    }
+  } catch (const std::logic_error &) {
+    printUsage(argv[0]);
+    return 1;
+  }
+  if (positional.size() != 2) {
+    printUsage(argv[0]);
+    return 1;
+  }
+  auto mesh = readGeometryMeshFromWavefrontObj(positional[0]);
+  if (!mesh) return 1;
+  size_t input_faces = mesh->numFaces();
+  auto stats = remeshIsotropic(*mesh, options);
+  if (!stats) return 1;
+  std::cout << std::format("{} faces, target edge length {:.6g}\n", input_faces, stats->target_edge_length);
+  for (size_t i = 0; i < stats->iterations.size(); i++) {
+    const auto &it = stats->iterations[i];
+    std::cout << std::format("iteration {}: {} splits, {} collapses, {} flips -> {} faces in {:.1f}ms "
+                             "(split {:.1f}, collapse {:.1f}, flip {:.1f}, smooth {:.1f}), {:.2f}M triangles/s\n",
+                             i, it.splits, it.collapses, it.flips, it.num_faces, it.seconds() * 1e3,
+                             it.split_seconds * 1e3, it.collapse_seconds * 1e3, it.flip_seconds * 1e3,
+                             it.smooth_seconds * 1e3, static_cast<double>(it.num_faces) / it.seconds() * 1e-6);
+  }
+  return writeWavefrontObj(*mesh->toWavefrontObj(), positional[1]) ? 0 : 1;
+}
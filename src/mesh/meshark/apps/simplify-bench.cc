@@ -0,0 +1,182 @@
+#include <iostream>
+#include <fstream>
+#include <format>
+#include <filesystem>
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <sys/resource.h>
+#include <meshark/mesh-simplifier.h>
+#include <meshark/mesh-io.h>
+#include "ratio-list.h"
+using namespace meshark;
+
+static void printUsage(const char *program) {
+  std::cerr << "Usage: " << program << " [options] <obj path or directory>...\n"
+            << "Runs the serial simplifier on every input (every .obj of a directory) at each ratio and\n"
+            << "writes the timings as JSON.\n"
+            << "Options:\n"
+            << "  --ratios <r>[,<r>...]    edge ratios to simplify to (default 0.75,0.5,0.25)\n"
+            << "  --repeat <n>             runs per input and ratio, the fastest one is reported (default 1)\n"
+            << "  --memoryless             use the memoryless (Lindstrom-Turk) cost model instead of quadrics\n"
+            << "  --output <path>          write the JSON there instead of stdout\n"
+            << "peak_rss_bytes is the peak resident memory of the whole process so far (ru_maxrss), it never\n"
+            << "decreases. Benchmark one input per process to attribute it to that input alone." << std::endl;
+}
+
+// Inputs sorted by size, so that the process-wide peak memory read after every run mostly belongs to
+// the run itself. It is only exact for the first input, or when the inputs grow fast enough.
+static std::vector<std::filesystem::path> collectInputs(const std::vector<const char *> &args) {
+  std::vector<std::filesystem::path> inputs;
+  for (const char *arg : args) {
+    if (std::filesystem::is_directory(arg)) {
+      for (const auto &entry : std::filesystem::directory_iterator(arg))
+        if (entry.path().extension() == ".obj") inputs.push_back(entry.path());
+    } else {
+      inputs.emplace_back(arg);
+    }
+  }
+  std::sort(inputs.begin(), inputs.end(), [](const auto &a, const auto &b) {
+    return std::make_pair(std::filesystem::file_size(a), a) < std::make_pair(std::filesystem::file_size(b), b);
+  });
+  return inputs;
+}
+
+// High-water mark of the whole process, it never goes down between runs.
+static size_t peakResidentBytes() {
+  rusage usage{};
+  getrusage(RUSAGE_SELF, &usage);
+  // ru_maxrss is in KiB on Linux.
+  return static_cast<size_t>(usage.ru_maxrss) << 10;
+}
+
+struct BenchResult {
+  size_t input_faces;
+  size_t output_faces;
+  int64_t collapses;
+  double seconds;
+  SimplifyPhaseTimes phases;
+  Real error;
+};
+
+static std::unique_ptr<BenchResult> runOnce(const std::filesystem::path &input, Real ratio,
+                                            SimplifyCostModel cost_model) {
+  auto mesh = readClosedManifoldFromWavefrontObj(input);
+  if (!mesh) return nullptr;
+  auto input_faces = mesh->numFaces();
+  MeshSimplifier simplifier(*mesh, cost_model);
+  simplifier.enablePhaseTiming();
+  auto start = std::chrono::steady_clock::now();
+  simplifier.runSimplify(ratio);
+  std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+  return std::make_unique<BenchResult>(BenchResult{
+      .input_faces = input_faces,
+      .output_faces = mesh->numFaces(),
+      // Every collapse removes two faces.
+      .collapses = static_cast<int64_t>(input_faces - mesh->numFaces()) / 2,
+      .seconds = elapsed.count(),
+      .phases = simplifier.phaseTimes(),
+      .error = simplifier.accumulatedError(),
+  });
+}
+
+// str as a quoted JSON string.
+static std::string jsonString(std::string_view str) {
+  std::string quoted = "\"";
+  for (char c : str) {
+    if (c == '"' || c == '\\')
+      quoted += {'\\', c};
+    else if (static_cast<unsigned char>(c) < 0x20)
+      quoted += std::format("\\u{:04x}", static_cast<int>(c));
+    else
+      quoted += c;
+  }
+  return quoted + '"';
+}
+
+// JSON has no infinity or NaN, an error that overflowed is written as null.
+static std::string jsonNumber(double value) {
+  return std::isfinite(value) ? std::format("{:.9g}", value) : "null";
+}
+
+static std::string toJson(const std::filesystem::path &input, Real ratio, const BenchResult &result,
+                          size_t peak_bytes) {
+  const auto &phases = result.phases;
+  double phase_sum = (phases.setup + phases.queue + phases.link_check + phases.collapse + phases.recost).count();
+  return std::format(R"({{"asset": {}, "ratio": {}, "input_faces": {}, "output_faces": {}, "collapses": {}, )"
+                     R"("seconds": {:.6f}, "collapses_per_second": {:.1f}, "phases": {{"setup": {:.6f}, )"
+                     R"("queue": {:.6f}, "link_check": {:.6f}, "collapse": {:.6f}, "recost": {:.6f}, )"
+                     R"("other": {:.6f}}}, "peak_rss_bytes": {}, "error": {}}})",
+                     jsonString(input.filename().string()), ratio, result.input_faces, result.output_faces, result.collapses,
+                     result.seconds, result.seconds > 0 ? static_cast<double>(result.collapses) / result.seconds : 0.0,
+                     phases.setup.count(), phases.queue.count(), phases.link_check.count(), phases.collapse.count(),
+                     phases.recost.count(), std::max(result.seconds - phase_sum, 0.0), peak_bytes, jsonNumber(result.error));
+}
+
+int main(int argc, char **argv) {
+  std::vector<Real> ratios{0.75, 0.5, 0.25};
+  int repeat = 1;
+  auto cost_model = SimplifyCostModel::kQuadricError;
+  const char *output = nullptr;
+  std::vector<const char *> positional;
+  try {
+    for (int i = 1; i < argc; i++) {
+      std::string_view arg(argv[i]);
+      if (arg == "--ratios" && i + 1 < argc)
+        ratios = parseRatios(argv[++i]);
+      else if (arg == "--repeat" && i + 1 < argc)
+        repeat = std::max(std::stoi(argv[++i]), 1);
+      else if (arg == "--memoryless")
+        cost_model = SimplifyCostModel::kMemoryless;
+      else if (arg == "--output" && i + 1 < argc)
+        output = argv[++i];
+      else
+        positional.push_back(argv[i]);
+    }
+  } catch (const std::logic_error &) {
+    printUsage(argv[0]);
+    return 1;
+  }
+  if (positional.empty() || ratios.empty()) {
+    printUsage(argv[0]);
+    return 1;
+  }
+  std::vector<std::string> entries;
+  for (const auto &input : collectInputs(positional)) {
+    for (Real ratio : ratios) {
+      std::unique_ptr<BenchResult> best;
+      for (int i = 0; i < repeat; i++) {
+        auto result = runOnce(input, ratio, cost_model);
+        if (!result) break;
+        if (!best || result->seconds < best->seconds) best = std::move(result);
+      }
+      if (!best) {
+        std::cerr << "Skip " << input << ", it could not be loaded as a closed manifold" << std::endl;
+        break;
+      }
+      std::cerr << std::format("{} at {}: {:.3f}s\n", input.filename().string(), ratio, best->seconds);
+      entries.push_back(toJson(input, ratio, *best, peakResidentBytes()));
+    }
+  }
+  std::string json = std::format(R"({{"cost_model": "{}", "runs": [)",
+                                 cost_model == SimplifyCostModel::kMemoryless ? "memoryless" : "qem");
+  for (size_t i = 0; i < entries.size(); i++)
+    json += (i ? ",\n  " : "\n  ") + entries[i];
+  json += "\n]}\n";
+  if (!output) {
+    std::cout << json << std::flush;
+    return std::cout ? 0 : 1;
+  }
+  std::ofstream out(output);
+  if (!out) {
+    std::cerr << "Failed to open file: " << output << std::endl;
+    return 1;
+  }
+  out << json;
+  out.close();
+  if (!out) {
+    std::cerr << "Failed to write file: " << output << std::endl;
+    return 1;
+  }
+  return 0;
+}
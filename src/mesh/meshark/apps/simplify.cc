@@ -1,15 +1,421 @@
 #include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string_view>
+#include <format>
+#include <semaphore>
+#include <stdexcept>
+#include <mystl/thread-pool.h>
 #include <meshark/mesh-simplifier.h>
 #include <meshark/mesh-io.h>
+#include "ratio-list.h"
+#include <meshark/ooc-simplifier.h>
+#include <meshark/vertex-clustering-simplifier.h>
+#include <meshark/progressive-mesh.h>
 using namespace meshark;
 
+static void printUsage(const char *program) {
+  std::cerr << "Usage: " << program << " [options] <input obj path> <output obj path> <ratio>[,<ratio>...]\n"
+            << "       " << program << " [options] --resume <checkpoint> <output obj path> <ratio>[,<ratio>...]\n"
+            << "       " << program << " [options] --batch <manifest>\n"
+            << "A manifest lists one job per line as <input obj path> <output obj path> <ratio>[,<ratio>...];\n"
+            << "blank lines and lines starting with # are skipped. Jobs run concurrently, one thread each.\n"
+            << "With several ratios, one output <stem>-<ratio><ext> is written per ratio from a single run.\n"
+            << "--batch, --ooc, --cluster and --extract-pm refuse the options below that they do not use.\n"
+            << "Options:\n"
+            << "  --threads <n>            run the parallel simplifier on n threads (0: all cores), or n batch jobs at once\n"
+            << "  --ooc                    out-of-core clustering, then in-core QEM down to <ratio>\n"
+            << "  --memory-budget <MiB>    memory budget of the out-of-core cluster grid\n"
+            << "  --spill-dir <path>       directory of the out-of-core position file (default $TMPDIR or /tmp)\n"
+            << "  --cluster                fast grid vertex clustering aiming at <ratio> of the faces\n"
+            << "  --clustered              simplify spatial clusters of the mesh concurrently, merging them level by level\n"
+            << "  --record-pm <path>       also write the collapse sequence as a progressive mesh\n"
+            << "  --extract-pm <path>      replay a progressive mesh of <input> down to <ratio> of its faces\n"
+            << "  --memoryless             use the memoryless (Lindstrom-Turk) cost model instead of quadrics\n"
+            << "  --max-error <e>          also stop before a collapse whose quadric error exceeds e\n"
+            << "  --time-budget <ms>       also stop after ms milliseconds of simplification\n"
+            << "  --checkpoint <path>      write a checkpoint to path periodically (not with --clustered)\n"
+            << "  --checkpoint-interval <s>  seconds between two checkpoints (default 60)\n"
+            << "  --resume <checkpoint>    carry on from a checkpoint instead of reading an input mesh" << std::endl;
+}
+
+// Prints the first option of options that is set and cannot be combined with mode.
+static bool rejectOptions(std::string_view mode, std::initializer_list<std::pair<std::string_view, bool>> options) {
+  for (auto [name, set] : options) {
+    if (!set) continue;
+    std::cerr << name << " cannot be combined with " << mode << std::endl;
+    return true;
+  }
+  return false;
+}
+
+static const char *stopReasonName(SimplifyStopReason reason) {
+  switch (reason) {
+    case SimplifyStopReason::kEdgeRatio: return "edge ratio";
+    case SimplifyStopReason::kFaceBudget: return "face budget";
+    case SimplifyStopReason::kErrorThreshold: return "error threshold";
+    case SimplifyStopReason::kTimeBudget: return "time budget";
+    case SimplifyStopReason::kNoCollapsableEdge: return "no collapsable edge";
+    case SimplifyStopReason::kCancelled: return "cancellation";
+  }
+  return "unknown";
+}
+
+static void printProgress(const SimplifyProgress &progress) {
+  auto collapses = static_cast<double>(std::max<int64_t>(progress.collapses, 1));
+  std::cout << std::format("{:.1f}s: {} collapses ({:.0f}/s), {} skipped, {} edges left, min cost {:.3g}, "
+                           "per collapse {:.1f} quadrics recomputed, {:.1f} patched ({:.1f} face planes saved), "
+                           "{:.1f} edge costs recomputed\n",
+                           progress.elapsed.count(), progress.collapses, progress.collapses_per_second,
+                           progress.skipped_edges, progress.remaining_edges, progress.min_cost,
+                           static_cast<double>(progress.recost.quadrics_recomputed) / collapses,
+                           static_cast<double>(progress.recost.quadrics_patched) / collapses,
+                           static_cast<double>(progress.recost.planes_saved) / collapses,
+                           static_cast<double>(progress.recost.edges_recosted) / collapses);
+}
+
+struct OutputPaths {
+  std::filesystem::path output;
+  bool multiple;
+  [[nodiscard]] std::filesystem::path operator()(Real ratio) const {
+    if (!multiple) return output;
+    auto path = output;
+    path.replace_filename(std::format("{}-{}{}", output.stem().string(), ratio, output.extension().string()));
+    return path;
+  }
+};
+
+struct BatchJob {
+  std::filesystem::path input;
+  OutputPaths outputs;
+  std::vector<Real> ratios;
+};
+
+// Malformed lines are reported and skipped, and counted in num_invalid.
+static std::vector<BatchJob> readManifest(const char *path, int &num_invalid) {
+  std::vector<BatchJob> jobs;
+  std::ifstream file(path);
+  if (!file.is_open()) {
+    std::cerr << "Failed to open file: " << path << std::endl;
+    num_invalid++;
+    return jobs;
+  }
+  std::string line;
+  for (int line_number = 1; std::getline(file, line); line_number++) {
+    std::istringstream iss(line);
+    std::string input, output, ratio_list, extra;
+    if (!(iss >> input) || input.starts_with('#')) continue;
+    iss >> output >> ratio_list;
+    auto ratios = parseRatios(ratio_list);
+    if (output.empty() || ratios.empty() || iss >> extra) {
+      std::cerr << std::format("{}:{}: expected <input> <output> <ratio>[,<ratio>...]\n", path, line_number);
+      num_invalid++;
+      continue;
+    }
+    jobs.push_back({input, OutputPaths{output, ratios.size() > 1}, std::move(ratios)});
+  }
+  return jobs;
+}
+
+// Loads and writes on a small I/O pool while the compute pool simplifies, one job per worker. At most
+// two jobs per worker are in flight, which bounds the meshes held in memory.
+static int runBatch(const char *manifest, int num_threads, SimplifyCostModel cost_model) {
+  // Loading is mostly parsing and writing mostly formatting, two threads keep up with many workers.
+  constexpr int kIoThreads = 2;
+  auto start = std::chrono::steady_clock::now();
+  int num_invalid = 0;
+  auto jobs = readManifest(manifest, num_invalid);
+  std::vector<std::string> failures(jobs.size());
+  std::vector<std::atomic<int>> pending_writes(jobs.size());
+  std::vector<std::atomic<bool>> write_failed(jobs.size());
+  std::mutex report_mutex;
+  size_t num_finished = 0;
+  mystl::ThreadPool compute(std::max(num_threads, 0));
+  mystl::ThreadPool io(kIoThreads);
+  const std::ptrdiff_t max_in_flight = 2 * compute.size();
+  std::counting_semaphore<> in_flight(max_in_flight);
+  auto finish = [&](size_t i, std::string failure) {
+    {
+      std::lock_guard lock(report_mutex);
+      num_finished++;
+      if (failure.empty())
+        std::cout << std::format("[{}/{}] {}: ok\n", num_finished, jobs.size(), jobs[i].input.string());
+      else
+        std::cout << std::format("[{}/{}] {}: FAILED, {}\n", num_finished, jobs.size(), jobs[i].input.string(),
+                                 failure);
+      failures[i] = std::move(failure);
+    }
+    in_flight.release();
+  };
+  for (size_t i = 0; i < jobs.size(); i++) {
+    in_flight.acquire();
+    io.submit([&, i] {
+      std::shared_ptr<GeometryMesh> mesh = readClosedManifoldFromWavefrontObj(jobs[i].input);
+      if (!mesh) return finish(i, "could not load a closed manifold triangle mesh");
+      compute.submit([&, i, mesh] {
+        MeshSimplifier simplifier(*mesh, cost_model);
+        pending_writes[i] = static_cast<int>(jobs[i].ratios.size());
+        simplifier.runSimplify(jobs[i].ratios, [&, i](Real ratio, std::unique_ptr<WavefrontObj> snapshot) {
+          io.submit([&, i, ratio, snapshot = std::shared_ptr<WavefrontObj>(std::move(snapshot))] {
+            if (!writeWavefrontObj(*snapshot, jobs[i].outputs(ratio))) write_failed[i] = true;
+            if (--pending_writes[i] == 0) finish(i, write_failed[i] ? "could not write every output" : "");
+          });
+        });
+      });
+    });
+  }
+  // Every job releases its slot when it is done.
+  for (std::ptrdiff_t k = 0; k < max_in_flight; k++)
+    in_flight.acquire();
+  std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+  auto num_failed = static_cast<size_t>(std::count_if(failures.begin(), failures.end(),
+                                                      [](const auto &f) { return !f.empty(); }));
+  size_t num_succeeded = jobs.size() - num_failed;
+  std::cout << std::format("Simplified {} of {} assets in {:.1f}s ({:.1f} assets/min) on {} threads",
+                           num_succeeded, jobs.size(), elapsed.count(),
+                           elapsed.count() > 0 ? static_cast<double>(num_succeeded) * 60 / elapsed.count() : 0.0,
+                           compute.size());
+  if (num_invalid) std::cout << std::format(", {} invalid manifest lines", num_invalid);
+  std::cout << "\n";
+  for (size_t i = 0; i < jobs.size(); i++)
+    if (!failures[i].empty())
+      std::cout << std::format("  failed: {} ({})\n", jobs[i].input.string(), failures[i]);
+  return num_failed || num_invalid ? 1 : 0;
+}
+
+static void runQem(MeshSimplifier &simplifier, const std::vector<Real> &alphas, int num_threads, bool clustered,
+                   const MeshSimplifier::SnapshotCallback &callback) {
+  if (clustered) {
+    // alphas are sorted in descending order, every run resumes from the previous one.
+    for (Real alpha : alphas) {
+      simplifier.runClusteredSimplify(alpha, std::max(num_threads, 0));
+      callback(alpha, simplifier.mesh.toWavefrontObj());
+    }
+  } else if (num_threads >= 0)
+    simplifier.runParallelSimplify(alphas, callback, num_threads);
+  else
+    simplifier.runSimplify(alphas, callback);
+}
+
+// Streams the input through the out-of-core clustering and, if the clustered mesh is a closed
+// manifold, refines it with the in-core QEM simplifier down to every ratio it has not reached yet.
+static int runOutOfCore(const char *input, const OutputPaths &outputs, const std::vector<Real> &ratios,
+                        const OutOfCoreSimplifyOptions &options, int num_threads, bool clustered,
+                        SimplifyCostModel cost_model, AsyncObjWriter &writer) {
+  auto result = simplifyOutOfCore(input, options);
+  if (!result.mesh) return 1;
+  std::cout << std::format("Clustered {} triangles into {} (cell size {}, peak grid memory {} MiB, "
+                           "positions {} MiB on disk)\n", result.num_input_triangles, result.mesh->face_splits.size() - 1,
+                           result.cell_size, result.peak_grid_bytes >> 20, result.position_bytes >> 20);
+  if (!isClosedManifold(*result.mesh)) {
+    // Without the refinement the clustered mesh is the only level there is, it stands for every
+    // ratio that keeps at least as many faces.
+    std::cout << "Clustered mesh is not a closed manifold, skip in-core refinement\n";
+    auto clustered_faces = static_cast<Real>(result.mesh->face_splits.size() - 1);
+    std::string unreachable;
+    for (Real ratio : ratios) {
+      if (ratio * static_cast<Real>(result.num_input_triangles) >= clustered_faces)
+        writer.write(std::make_unique<WavefrontObj>(*result.mesh), outputs(ratio));
+      else
+        unreachable += std::format("{}{}", unreachable.empty() ? "" : ", ", ratio);
+    }
+    if (unreachable.empty()) return writer.wait() ? 0 : 1;
+    std::cerr << std::format("Cannot produce ratios {}: they need fewer faces than the non-manifold clustered "
+                             "mesh has, a smaller --memory-budget clusters more coarsely\n", unreachable);
+    return 1;
+  }
+  auto mesh = std::make_unique<GeometryMesh>();
+  mesh->buildFromWavefrontObj(*result.mesh);
+  result.mesh.reset();
+  // A closed triangle mesh has 3/2 edges per face. Ratios are relative to the input, rescale them
+  // to the clustered mesh.
+  Real input_edges = 1.5 * static_cast<Real>(result.num_input_triangles);
+  Real clustered_edges = static_cast<Real>(mesh->numEdges());
+  std::vector<Real> alphas, refined_ratios;
+  for (Real ratio : ratios) {
+    Real alpha = ratio * input_edges / clustered_edges;
+    if (alpha >= 1) {
+      writer.write(mesh->toWavefrontObj(), outputs(ratio));
+      continue;
+    }
+    alphas.push_back(alpha);
+    refined_ratios.push_back(ratio);
+  }
+  MeshSimplifier simplifier(*mesh, cost_model);
+  simplifier.setProgressCallback(printProgress);
+  int snapshot_index = 0;
+  // Snapshots arrive in the (descending) order of alphas.
+  runQem(simplifier, alphas, num_threads, clustered, [&](Real, std::unique_ptr<WavefrontObj> snapshot) {
+    writer.write(std::move(snapshot), outputs(refined_ratios[snapshot_index++]));
+  });
+  return writer.wait() ? 0 : 1;
+}
+
 int main(int argc, char **argv) {
-  if (argc != 4) {
-    std::cerr << "Usage: " << argv[0] << " <input obj path> <output obj path> <ratio>" << std::endl;
+  int num_threads = -1;
+  bool out_of_core = false;
+  bool cluster = false;
+  bool clustered = false;
+  const char *record_pm = nullptr;
+  const char *extract_pm = nullptr;
+  const char *checkpoint = nullptr;
+  const char *resume = nullptr;
+  const char *batch = nullptr;
+  std::chrono::milliseconds checkpoint_interval = std::chrono::seconds(60);
+  OutOfCoreSimplifyOptions ooc_options;
+  bool has_memory_budget = false;
+  SimplifyStoppingPolicy policy;
+  auto cost_model = SimplifyCostModel::kQuadricError;
+  std::vector<const char *> positional;
+  // std::sto* throw on anything that does not start with a number.
+  try {
+    for (int i = 1; i < argc; i++) {
+      std::string_view arg(argv[i]);
+      if (arg == "--threads" && i + 1 < argc)
+        num_threads = std::stoi(argv[++i]);
+      else if (arg == "--ooc")
+        out_of_core = true;
+      else if (arg == "--record-pm" && i + 1 < argc)
+        record_pm = argv[++i];
+      else if (arg == "--extract-pm" && i + 1 < argc)
+        extract_pm = argv[++i];
+      else if (arg == "--clustered")
+        clustered = true;
+      else if (arg == "--cluster")
+        cluster = true;
+      else if (arg == "--memory-budget" && i + 1 < argc) {
+        ooc_options.memory_budget = std::stoull(argv[++i]) << 20;
+        has_memory_budget = true;
+      } else if (arg == "--spill-dir" && i + 1 < argc)
+        ooc_options.spill_directory = argv[++i];
+      else if (arg == "--memoryless")
+        cost_model = SimplifyCostModel::kMemoryless;
+      else if (arg == "--max-error" && i + 1 < argc)
+        policy.max_error = std::stod(argv[++i]);
+      else if (arg == "--time-budget" && i + 1 < argc)
+        policy.time_budget = std::chrono::milliseconds(std::stoll(argv[++i]));
+      else if (arg == "--checkpoint" && i + 1 < argc)
+        checkpoint = argv[++i];
+      else if (arg == "--checkpoint-interval" && i + 1 < argc)
+        checkpoint_interval = std::chrono::milliseconds(static_cast<int64_t>(std::stod(argv[++i]) * 1000));
+      else if (arg == "--resume" && i + 1 < argc)
+        resume = argv[++i];
+      else if (arg == "--batch" && i + 1 < argc)
+        batch = argv[++i];
+      else
+        positional.push_back(argv[i]);
+    }
+  } catch (const std::logic_error &) {
+    printUsage(argv[0]);
     return 1;
   }
-  auto mesh = readGeometryMeshFromWavefrontObj(argv[1]);
-  std::unique_ptr<MeshSimplifier> simplifier = std::make_unique<MeshSimplifier>(*mesh);
-  simplifier->runSimplify(std::stod(argv[3]));
-  mesh->writeWavefrontObj(argv[2]);
-}
\ No newline at end of file
+  if (batch) {
+    if (!positional.empty()) {
+      printUsage(argv[0]);
+      return 1;
+    }
+    if (rejectOptions("--batch", {{"--max-error", policy.max_error.has_value()},
+                                  {"--time-budget", policy.time_budget.has_value()},
+                                  {"--checkpoint", checkpoint}, {"--resume", resume}, {"--record-pm", record_pm},
+                                  {"--extract-pm", extract_pm}, {"--clustered", clustered}, {"--cluster", cluster},
+                                  {"--ooc", out_of_core}, {"--memory-budget", has_memory_budget},
+                                  {"--spill-dir", !ooc_options.spill_directory.empty()}}))
+      return 1;
+    return runBatch(batch, num_threads, cost_model);
+  }
+  // A resumed run has no input mesh.
+  if (resume) positional.insert(positional.begin(), resume);
+  if (positional.size() != 3) {
+    printUsage(argv[0]);
+    return 1;
+  }
+  auto ratios = parseRatios(positional[2]);
+  if (ratios.empty()) {
+    printUsage(argv[0]);
+    return 1;
+  }
+  if (checkpoint && clustered) {
+    std::cerr << "--checkpoint cannot be combined with --clustered" << std::endl;
+    return 1;
+  }
+  // --extract-pm, --ooc and --cluster replace the in-core simplifier and do not take its options.
+  if (extract_pm && rejectOptions("--extract-pm", {{"--memoryless", cost_model == SimplifyCostModel::kMemoryless},
+                                                   {"--max-error", policy.max_error.has_value()},
+                                                   {"--time-budget", policy.time_budget.has_value()},
+                                                   {"--checkpoint", checkpoint}, {"--resume", resume},
+                                                   {"--record-pm", record_pm}, {"--clustered", clustered},
+                                                   {"--cluster", cluster}, {"--ooc", out_of_core}}))
+    return 1;
+  if (out_of_core && rejectOptions("--ooc", {{"--max-error", policy.max_error.has_value()},
+                                             {"--time-budget", policy.time_budget.has_value()},
+                                             {"--checkpoint", checkpoint}, {"--resume", resume},
+                                             {"--record-pm", record_pm}, {"--cluster", cluster}}))
+    return 1;
+  if (cluster && rejectOptions("--cluster", {{"--memoryless", cost_model == SimplifyCostModel::kMemoryless},
+                                             {"--max-error", policy.max_error.has_value()},
+                                             {"--time-budget", policy.time_budget.has_value()},
+                                             {"--checkpoint", checkpoint}, {"--record-pm", record_pm},
+                                             {"--clustered", clustered}}))
+    return 1;
+  if (!out_of_core && (has_memory_budget || !ooc_options.spill_directory.empty())) {
+    std::cerr << (has_memory_budget ? "--memory-budget" : "--spill-dir") << " only applies to --ooc" << std::endl;
+    return 1;
+  }
+  OutputPaths outputs{positional[1], ratios.size() > 1};
+  AsyncObjWriter writer;
+  if (extract_pm) {
+    auto base = readWavefrontObj(positional[0]);
+    auto pm = readProgressiveMesh(extract_pm);
+    if (!base || !pm) return 1;
+    for (Real ratio : ratios) {
+      auto lod = extractLevelOfDetail(*base, *pm, pm->numCollapsesForFaceRatio(ratio));
+      if (!lod) return 1;
+      writer.write(std::move(lod), outputs(ratio));
+    }
+    return writer.wait() ? 0 : 1;
+  }
+  if (out_of_core)
+    return runOutOfCore(positional[0], outputs, ratios, ooc_options, num_threads, clustered, cost_model, writer);
+  std::unique_ptr<SimplifierCheckpoint> resumed;
+  if (resume) {
+    resumed = readSimplifierCheckpoint(resume);
+    if (!resumed) return 1;
+  }
+  auto mesh = resumed ? resumed->restoreMesh() : readClosedManifoldFromWavefrontObj(positional[0]);
+  if (!mesh) return 1;
+  if (cluster) {
+    VertexClusteringSimplifier clustering(*mesh);
+    for (Real ratio : ratios) {
+      auto target_faces = static_cast<int>(ratio * static_cast<Real>(mesh->numFaces()));
+      writer.write(clustering.runSimplify(target_faces, std::max(num_threads, 0)), outputs(ratio));
+    }
+    return writer.wait() ? 0 : 1;
+  }
+  auto simplifier = resumed ? std::make_unique<MeshSimplifier>(*mesh, *resumed)
+                            : std::make_unique<MeshSimplifier>(*mesh, cost_model);
+  resumed.reset();
+  // A resumed simplifier keeps recording if its checkpoint was.
+  if (record_pm && !resume)
+    simplifier->enableCollapseRecording();
+  if (checkpoint)
+    simplifier->enableCheckpoints(checkpoint, checkpoint_interval);
+  simplifier->setProgressCallback(printProgress);
+  if (policy.max_error || policy.time_budget) {
+    if (ratios.size() > 1) {
+      std::cerr << "--max-error and --time-budget take a single ratio" << std::endl;
+      return 1;
+    }
+    policy.edge_ratio = ratios.front();
+    auto reason = clustered ? simplifier->runClusteredSimplify(policy, std::max(num_threads, 0))
+                  : num_threads >= 0 ? simplifier->runParallelSimplify(policy, num_threads)
+                                     : simplifier->runSimplify(policy);
+    std::cout << std::format("Stopped by {} with {} faces left\n", stopReasonName(reason), mesh->numFaces());
+    writer.write(mesh->toWavefrontObj(), outputs(ratios.front()));
+  } else {
+    runQem(*simplifier, ratios, num_threads, clustered, [&](Real alpha, std::unique_ptr<WavefrontObj> snapshot) {
+      writer.write(std::move(snapshot), outputs(alpha));
+    });
+  }
+  bool written = !record_pm || writeProgressiveMesh(simplifier->progressiveMesh(), record_pm);
+  return writer.wait() && written ? 0 : 1;
+}
@@ -0,0 +1,62 @@
+#include <iostream>
+#include <format>
+#include <string_view>
+#include <stdexcept>
+#include <meshark/laplacian.h>
+#include <meshark/mesh-io.h>
+using namespace meshark;
+
+static void printUsage(const char *program) {
+  std::cerr << "Usage: " << program << " [options] <input obj path> <output obj path>\n"
+            << "Smooths a closed triangle mesh with implicit Laplacian steps.\n"
+            << "Options:\n"
+            << "  --uniform                uniform instead of cotangent weights\n"
+            << "  --time-step <f>          step size, 1 is about one step to the neighbour centroid (default 1)\n"
+            << "  --steps <n>              implicit steps (default 1)\n"
+            << "  --tolerance <f>          relative residual of the solver (default 1e-8)\n"
+            << "  --no-preconditioner      plain conjugate gradients instead of Jacobi preconditioning\n"
+            << "  --incomplete-cholesky    incomplete Cholesky instead of Jacobi preconditioning\n"
+            << "  --threads <n>            threads (0: all cores)" << std::endl;
+}
+
+int main(int argc, char **argv) {
+  ImplicitSmoothingOptions options;
+  std::vector<const char *> positional;
+  try {
+    for (int i = 1; i < argc; i++) {
+      std::string_view arg(argv[i]);
+      if (arg == "--uniform")
+        options.weighting = LaplacianWeighting::kUniform;
+      else if (arg == "--time-step" && i + 1 < argc)
+        options.time_step = std::stod(argv[++i]);
+      else if (arg == "--steps" && i + 1 < argc)
+        options.num_steps = std::max(std::stoi(argv[++i]), 0);
+      else if (arg == "--tolerance" && i + 1 < argc)
+        options.solver.tolerance = std::stod(argv[++i]);
+      else if (arg == "--no-preconditioner")
+        options.solver.preconditioner = Preconditioner::kNone;
+      else if (arg == "--incomplete-cholesky")
+        options.solver.preconditioner = Preconditioner::kIncompleteCholesky;
+      else if (arg == "--threads" && i + 1 < argc)
+        options.solver.num_threads = std::stoi(argv[++i]);
+      else
+        positional.push_back(argv[i]);
+    }
+  } catch (const std::logic_error &) {
+    printUsage(argv[0]);
+    return 1;
+  }
+  if (positional.size() != 2) {
+    printUsage(argv[0]);
+    return 1;
+  }
+  auto mesh = readGeometryMeshFromWavefrontObj(positional[0]);
+  if (!mesh) return 1;
+  auto stats = smoothImplicitly(*mesh, options);
+  if (!stats) return 1;
+  std::cout << std::format("{} vertices, {} steps: {} solver iterations{}, build {:.1f}ms, solve {:.1f}ms\n",
+                           mesh->numVertices(), options.num_steps, stats->iterations,
+                           stats->converged ? "" : " (not converged)", stats->build_seconds * 1e3,
+                           stats->solve_seconds * 1e3);
+  return writeWavefrontObj(*mesh->toWavefrontObj(), positional[1]) ? 0 : 1;
+}
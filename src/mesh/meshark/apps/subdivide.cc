@@ -0,0 +1,50 @@
+#include <iostream>
+#include <format>
+#include <chrono>
+#include <string_view>
+#include <stdexcept>
+#include <meshark/subdivision.h>
+#include <meshark/mesh-io.h>
+using namespace meshark;
+
+static void printUsage(const char *program) {
+  std::cerr << "Usage: " << program << " [options] <input obj path> <output obj path>\n"
+            << "Refines a closed triangle mesh with Loop subdivision.\n"
+            << "Options:\n"
+            << "  --levels <n>             subdivision levels (default 1)\n"
+            << "  --threads <n>            threads (0: all cores)" << std::endl;
+}
+
+int main(int argc, char **argv) {
+  int levels = 1;
+  int num_threads = 0;
+  std::vector<const char *> positional;
+  try {
+    for (int i = 1; i < argc; i++) {
+      std::string_view arg(argv[i]);
+      if (arg == "--levels" && i + 1 < argc)
+        levels = std::max(std::stoi(argv[++i]), 0);
+      else if (arg == "--threads" && i + 1 < argc)
+        num_threads = std::stoi(argv[++i]);
+      else
+        positional.push_back(argv[i]);
+    }
+  } catch (const std::logic_error &) {
+    printUsage(argv[0]);
+    return 1;
+  }
+  if (positional.size() != 2) {
+    printUsage(argv[0]);
+    return 1;
+  }
+  auto mesh = readGeometryMeshFromWavefrontObj(positional[0]);
+  if (!mesh) return 1;
+  auto start = std::chrono::steady_clock::now();
+  auto refined = loopSubdivide(*mesh, levels, num_threads);
+  std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+  if (!refined) return 1;
+  std::cout << std::format("{} levels: {} vertices, {} faces -> {} vertices, {} faces in {:.1f}ms\n", levels,
+                           mesh->numVertices(), mesh->numFaces(), refined->numVertices(), refined->numFaces(),
+                           elapsed.count() * 1e3);
+  return writeWavefrontObj(*refined->toWavefrontObj(), positional[1]) ? 0 : 1;
+}
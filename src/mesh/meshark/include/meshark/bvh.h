@@ -0,0 +1,84 @@
+//
+// Created by creeper on 10/16/26.
+//
+
+#ifndef MESHSIMPLIFICATION_MESHARK_INCLUDE_MESHARK_BVH_H_
+#define MESHSIMPLIFICATION_MESHARK_INCLUDE_MESHARK_BVH_H_
+
+#include <meshark/geometry-mesh.h>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <optional>
+#include <vector>
+
+namespace meshark {
+struct Ray {
+  glm::vec3 origin;
+  glm::vec3 direction;
+  float t_min{0.0f};
+  float t_max{std::numeric_limits<float>::infinity()};
+};
+
+struct RayHit {
+  float t;
+  // Index of the face when the BVH was built.
+  int face;
+  // Weights of the second and third corner of the face, starting at face->halfEdge()->tail.
+  glm::vec2 barycentric;
+};
+
+struct ClosestPoint {
+  glm::vec3 point;
+  float distance;
+  int face;
+};
+
+// Internal nodes have their left child right after them and the right one at index, leaves hold the
+// triangles [index, index + count).
+struct BvhNode {
+  glm::vec3 lo;
+  uint32_t index;
+  glm::vec3 hi;
+  uint32_t count;
+};
+static_assert(sizeof(BvhNode) == 32);
+
+struct BvhTriangle {
+  glm::vec3 v0, v1, v2;
+  int face;
+};
+
+// Two-sided; the barycentric weights are those of v1 and v2.
+std::optional<RayHit> intersectTriangle(const BvhTriangle &triangle, const Ray &ray);
+glm::vec3 closestPointOnTriangle(const BvhTriangle &triangle, const glm::vec3 &p);
+
+struct BvhOptions {
+  // Nodes with at most this many triangles become leaves when splitting them does not pay off
+  // according to the surface area heuristic; larger nodes are always split.
+  int max_leaf_size{4};
+  int num_bins{16};
+  int num_threads{0};
+};
+
+// Bounding volume hierarchy over the faces of a triangle mesh, built top-down with binned SAH splits,
+// subtrees in parallel. It holds a copy of the triangles, so the mesh can change afterwards. The
+// layout only depends on the mesh, not on the number of threads.
+struct FaceBvh {
+  explicit FaceBvh(const GeometryMesh &mesh, const BvhOptions &options = {});
+
+  // Closest hit in [t_min, t_max].
+  [[nodiscard]] std::optional<RayHit> intersect(const Ray &ray) const;
+  // Whether anything is hit in [t_min, t_max], stops at the first hit found.
+  [[nodiscard]] bool occluded(const Ray &ray) const;
+  // Closest point of the surface within max_distance of p.
+  [[nodiscard]] std::optional<ClosestPoint> closestPoint(
+      const glm::vec3 &p, float max_distance = std::numeric_limits<float>::infinity()) const;
+  // Expected traversal cost relative to testing one triangle, with a node test costing as much.
+  [[nodiscard]] float sahCost() const;
+
+  std::vector<BvhNode> nodes;
+  std::vector<BvhTriangle> triangles;
+};
+}
+#endif //MESHSIMPLIFICATION_MESHARK_INCLUDE_MESHARK_BVH_H_
@@ -0,0 +1,37 @@
+//
+// Created by creeper on 10/16/26.
+//
+
+#ifndef MESHSIMPLIFICATION_MESHARK_INCLUDE_MESHARK_CONNECTED_COMPONENTS_H_
+#define MESHSIMPLIFICATION_MESHARK_INCLUDE_MESHARK_CONNECTED_COMPONENTS_H_
+
+#include <meshark/geometry-mesh.h>
+#include <memory>
+#include <vector>
+
+namespace meshark {
+struct FaceComponents {
+  // Component of every face, indexed like the faces. Components are numbered in the order of their
+  // first face.
+  std::vector<int> labels;
+  // Number of faces of every component.
+  std::vector<int> sizes;
+
+  [[nodiscard]] int numComponents() const {
+    return static_cast<int>(sizes.size());
+  }
+};
+
+// Faces are connected when they share an edge, so shells that only touch at a vertex stay apart. The
+// faces on both sides of every edge are united concurrently in a lock-free union-find; the labels do not
+// depend on the number of threads.
+FaceComponents findConnectedComponents(const GeometryMesh &mesh, int num_threads = 0);
+
+// One mesh per component of a triangle mesh, indexed like the components, null for components with
+// fewer than min_faces faces. The meshes are built concurrently, wired from the half-edges of mesh
+// instead of being rebuilt from indices. A vertex shared by several components is copied into each.
+// Nothing is returned if the faces are not all triangles.
+std::vector<std::unique_ptr<GeometryMesh>> splitComponents(const GeometryMesh &mesh, const FaceComponents &components,
+                                                           int min_faces = 0, int num_threads = 0);
+}
+#endif //MESHSIMPLIFICATION_MESHARK_INCLUDE_MESHARK_CONNECTED_COMPONENTS_H_
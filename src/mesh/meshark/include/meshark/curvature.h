@@ -0,0 +1,33 @@
+//
+// Created by creeper on 10/16/26.
+//
+
+#ifndef MESHSIMPLIFICATION_MESHARK_INCLUDE_MESHARK_CURVATURE_H_
+#define MESHSIMPLIFICATION_MESHARK_INCLUDE_MESHARK_CURVATURE_H_
+
+#include <meshark/element-data.h>
+#include <meshark/geometry-mesh.h>
+#include <optional>
+
+namespace meshark {
+// Discrete curvatures of Meyer et al. per vertex, integrated over the mixed Voronoi area: the mean
+// curvature from the cotangent Laplacian of the positions, positive where the surface is convex, and the
+// Gaussian curvature from the angle defect. The principal curvatures follow from both, their directions
+// from a least-squares fit of the second fundamental form to the normal curvatures along the edges.
+struct VertexCurvatures {
+  VertexData<float> mean;
+  VertexData<float> gaussian;
+  // max_curvature >= min_curvature.
+  VertexData<float> max_curvature;
+  VertexData<float> min_curvature;
+  // Unit tangent directions, arbitrary where both principal curvatures are equal.
+  VertexData<glm::vec3> max_direction;
+  VertexData<glm::vec3> min_direction;
+};
+
+// One parallel pass over the one-rings, read from a table of face corners built once rather than from
+// the half-edges, without allocating per vertex. Vertices without faces get zeros. Nothing is returned
+// if the mesh is not a closed triangle mesh.
+std::optional<VertexCurvatures> computeCurvatures(const GeometryMesh &mesh, int num_threads = 0);
+}
+#endif //MESHSIMPLIFICATION_MESHARK_INCLUDE_MESHARK_CURVATURE_H_
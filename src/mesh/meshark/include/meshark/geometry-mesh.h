@@ -8,48 +8,138 @@
 #include <meshark/half-edge-mesh.h>
 #include <meshark/element-data.h>
 #include <glm/glm.hpp>
+#include <atomic>
+#include <cstdint>
 #include <filesystem>
+#include <optional>
+#include <vector>
+
+namespace mystl {
+struct ThreadPool;
+}
 
 namespace meshark {
 struct WavefrontObj;
 
+// How the normals of the faces around a vertex are weighted in its normal.
+enum class VertexNormalWeighting {
+  kArea,
+  kAngle,
+};
+
 struct GeometryMesh : public HalfEdgeMesh<GeometryMesh> {
   GeometryMesh() = default;
   using Base = HalfEdgeMesh<GeometryMesh>;
   void buildFromWavefrontObj(const WavefrontObj &obj);
-  void writeWavefrontObj(const std::filesystem::path &path) const;
+  // False, after reporting to std::cerr, if the file cannot be opened or written.
+  [[nodiscard]] bool writeWavefrontObj(const std::filesystem::path &path) const;
+  // Indexed copy of the current positions and faces, cheap enough to take in the middle of a run.
+  [[nodiscard]] std::unique_ptr<WavefrontObj> toWavefrontObj() const;
   [[nodiscard]] glm::vec3 pos(Vertex v) const {
     return position(v);
   }
   [[nodiscard]] glm::vec3 normal(Face f) const {
+    if (deferred_normals && isNormalDirty(f)) return computeFaceNormal(f);
     return normals(f);
   }
+  // Cached vertex normal if vertex normals are enabled, otherwise an area-weighted one computed on the fly.
+  [[nodiscard]] glm::vec3 normal(Vertex v) const {
+    if (!vertex_normal_weighting) return computeVertexNormal(v, VertexNormalWeighting::kArea);
+    if (isBitSet(dirty_vertex_normals, index(v))) return computeVertexNormal(v, *vertex_normal_weighting);
+    return vertex_normals(v);
+  }
+  // Gathered from the one-ring, so it does not depend on the cached face normals.
+  [[nodiscard]] glm::vec3 computeVertexNormal(Vertex v, VertexNormalWeighting weighting) const;
+  // Safe to call concurrently for vertices that share no face, and with eager vertex normals, no
+  // neighbour either.
   void setVertexPos(Vertex v, const glm::vec3 &pos) {
     position(v) = pos;
     for (auto h : v->outgoingHalfEdges()) {
       auto f = h->face;
-      normals(f) = computeFaceNormal(f);
+      if (deferred_normals)
+        markNormalDirty(f);
+      else
+        normals(f) = computeFaceNormal(f);
+    }
+    if (!vertex_normal_weighting) return;
+    // Moving v changes the faces around its neighbours too.
+    if (deferred_normals) {
+      setBit(dirty_vertex_normals, index(v));
+      for (auto h : v->outgoingHalfEdges())
+        setBit(dirty_vertex_normals, index(h->tip));
+    } else {
+      updateVertexNormal(v);
+      for (auto h : v->outgoingHalfEdges())
+        updateVertexNormal(h->tip);
     }
   }
+  // Caches a normal per vertex, computed in parallel and from then on kept up to date by setVertexPos.
+  void enableVertexNormals(VertexNormalWeighting weighting = VertexNormalWeighting::kArea, int num_threads = 0);
+  void disableVertexNormals();
+  [[nodiscard]] std::optional<VertexNormalWeighting> vertexNormalWeighting() const {
+    return vertex_normal_weighting;
+  }
+  // In deferred mode setVertexPos only marks the faces (and cached vertex normals) around the vertex,
+  // and flushNormals() recomputes all marked ones at once, so that a face shared by several moved
+  // vertices is normalized once. Until then normal() computes marked ones on the fly. Leaving deferred
+  // mode flushes.
+  void setDeferredNormals(bool deferred);
+  [[nodiscard]] bool deferredNormals() const {
+    return deferred_normals;
+  }
+  void flushNormals(int num_threads = 0);
+  // The same on the workers of pool, which the caller must not be one of.
+  void flushNormals(mystl::ThreadPool &pool);
+  // Moves all vertices at once, positions indexed like the vertices, and recomputes every normal in
+  // parallel instead of fan by fan.
+  void setVertexPositions(const std::vector<glm::vec3> &positions, int num_threads = 0);
+  // Splits the interior edge e at a new vertex placed at pos, turning its two triangles into four. e
+  // keeps the half from e->halfEdge()->tail to the new vertex.
+  Vertex splitEdge(Edge e, const glm::vec3 &pos);
+  // rewireEdgeFlip() with the normals of the two faces and four vertices kept up to date. Safe to call
+  // concurrently for edges whose triangles share no vertex.
+  void flipEdge(Edge e);
  protected:
   friend Base;
   virtual void createVertexAttribute(const glm::vec3 &vertex_pos) {
     position.addVertexData(vertex_pos);
+    if (vertex_normal_weighting) {
+      // It has no faces yet, so its normal is computed once it is read.
+      vertex_normals.addVertexData({});
+      pushBit(dirty_vertex_normals, numVertices(), true);
+    }
   }
   virtual void createVertexAttribute(float x, float y, float z) {
-    position.addVertexData({x, y, z});
+    createVertexAttribute(glm::vec3(x, y, z));
   }
   virtual void removeVertexAttribute(Vertex v) {
     position.removeVertexData(v);
+    if (vertex_normal_weighting) {
+      vertex_normals.removeVertexData(v);
+      swapRemoveBit(dirty_vertex_normals, index(v), numVertices());
+    }
+  }
+  // Zeroed positions and normals for allocateElements.
+  virtual void allocateAttributes(int num_vertices, int num_faces) {
+    position = VertexData<glm::vec3>(num_vertices);
+    normals = FaceData<glm::vec3>(num_faces);
+    if (deferred_normals) dirty_normals.assign((num_faces + 63) / 64, 0);
+    if (vertex_normal_weighting) {
+      vertex_normals = VertexData<glm::vec3>(num_vertices);
+      dirty_vertex_normals.assign((num_vertices + 63) / 64, ~uint64_t{0});
+      if (num_vertices % 64) dirty_vertex_normals.back() = (uint64_t{1} << (num_vertices % 64)) - 1;
+    }
   }
   virtual void createFaceAttribute(const glm::vec3 &face_normal) {
     normals.addFaceData(face_normal);
+    if (deferred_normals) pushBit(dirty_normals, numFaces(), false);
   }
   virtual void createFaceAttribute(float x, float y, float z) {
-    normals.addFaceData({x, y, z});
+    createFaceAttribute(glm::vec3(x, y, z));
   }
   virtual void removeFaceAttribute(Face f) {
     normals.removeFaceData(f);
+    if (deferred_normals) swapRemoveBit(dirty_normals, index(f), numFaces());
   }
   [[nodiscard]] glm::vec3 computeFaceNormal(Face f) const {
     auto h = f->halfEdge();
@@ -58,8 +148,56 @@ struct GeometryMesh : public HalfEdgeMesh<GeometryMesh> {
     auto v2 = pos(h->next->tip);
     return glm::normalize(glm::cross(v1 - v0, v2 - v0));
   }
+  [[nodiscard]] bool isNormalDirty(Face f) const {
+    return isBitSet(dirty_normals, index(f));
+  }
+  void markNormalDirty(Face f) {
+    setBit(dirty_normals, index(f));
+  }
+  void updateVertexNormal(Vertex v) {
+    vertex_normals(v) = computeVertexNormal(v, *vertex_normal_weighting);
+    clearBit(dirty_vertex_normals, index(v));
+  }
+  // Words of the dirty bitsets are accessed atomically, since concurrent setVertexPos calls on disjoint
+  // fans still mark elements that share a word.
+  static bool isBitSet(std::vector<uint64_t> &bits, int i) {
+    return std::atomic_ref(bits[i >> 6]).load(std::memory_order_relaxed) >> (i & 63) & 1;
+  }
+  static void setBit(std::vector<uint64_t> &bits, int i) {
+    std::atomic_ref(bits[i >> 6]).fetch_or(uint64_t{1} << (i & 63), std::memory_order_relaxed);
+  }
+  static void clearBit(std::vector<uint64_t> &bits, int i) {
+    std::atomic_ref(bits[i >> 6]).fetch_and(~(uint64_t{1} << (i & 63)), std::memory_order_relaxed);
+  }
+  // size is the number of elements after the push.
+  static void pushBit(std::vector<uint64_t> &bits, size_t size, bool bit) {
+    if (bits.size() * 64 < size) bits.push_back(0);
+    if (bit) setBit(bits, static_cast<int>(size - 1));
+  }
+  // Mirrors the swap of element i with the last one; size is the number of elements before the removal.
+  static void swapRemoveBit(std::vector<uint64_t> &bits, int i, size_t size) {
+    auto last = static_cast<int>(size - 1);
+    bool last_bit = isBitSet(bits, last);
+    clearBit(bits, last);
+    if (i != last) {
+      clearBit(bits, i);
+      if (last_bit) setBit(bits, i);
+    }
+    if (last % 64 == 0) bits.pop_back();
+  }
+  // Recomputes the marked vertex normals and clears the marks.
+  // Both run on pool instead of num_threads threads of their own when it is given.
+  void flushVertexNormals(int num_threads, mystl::ThreadPool *pool = nullptr);
+  void updateFaceNormals(const std::vector<int> &faces, int num_threads, mystl::ThreadPool *pool = nullptr);
   FaceData<glm::vec3> normals;
   VertexData<glm::vec3> position;
+  bool deferred_normals{false};
+  // One bit per face in deferred mode. Mutable for the atomic loads of normal().
+  mutable std::vector<uint64_t> dirty_normals;
+  std::optional<VertexNormalWeighting> vertex_normal_weighting;
+  VertexData<glm::vec3> vertex_normals;
+  // One bit per vertex while vertex normals are enabled, for vertices whose cached normal is stale.
+  mutable std::vector<uint64_t> dirty_vertex_normals;
 };
 
 template<>
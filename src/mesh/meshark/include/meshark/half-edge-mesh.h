@@ -6,10 +6,14 @@
 #define MESHSIMPLIFICATION_MESH_SIMPLIFICATION_INCLUDE_MESH_SIMPLIFICATION_HALF_EDGE_MESH_H_
 
 #include <vector>
+#include <array>
 #include <memory>
 #include <optional>
+#include <new>
+#include <type_traits>
 #include <meshark/mesh-type-traits.h>
 #include <meshark/mesh-elements.h>
+#include <mystl/parallel-for.h>
 #include <iostream>
 #include <cassert>
 
@@ -17,11 +21,55 @@ namespace meshark {
 
 struct WavefrontObj;
 
+struct EdgeCollapseRecord {
+  Vertex kept_vertex;
+  Vertex removed_vertex;
+  std::array<Edge, 3> removed_edges;
+  std::array<Face, 2> removed_faces;
+  std::array<HalfEdge, 6> removed_half_edges;
+};
+
+// Elements of a mesh built by allocateElements live in one block per type owned by the mesh, all the
+// others are allocated one by one. Only the latter are deleted with their pointer.
+template<typename Element>
+struct ElementDeleter {
+  void operator()(Element *element) const {
+    if (!element->pooled) delete element;
+  }
+};
+template<typename Element>
+using ElementPtr = std::unique_ptr<Element, ElementDeleter<Element>>;
+
+template<typename Element>
+struct ElementBlockDeleter {
+  static_assert(std::is_trivially_destructible_v<Element>);
+  void operator()(Element *elements) const {
+    ::operator delete(elements, std::align_val_t(alignof(Element)));
+  }
+};
+template<typename Element>
+using ElementBlock = std::unique_ptr<Element, ElementBlockDeleter<Element>>;
+
 template<typename Derived>
 struct HalfEdgeMesh {
+  HalfEdgeMesh() = default;
+  HalfEdgeMesh(HalfEdgeMesh &&) noexcept = default;
+  // Member-wise, a block would be freed before the old pointers into it.
+  HalfEdgeMesh &operator=(HalfEdgeMesh &&other) noexcept {
+    m_edges = std::move(other.m_edges);
+    m_faces = std::move(other.m_faces);
+    m_vertices = std::move(other.m_vertices);
+    m_half_edges = std::move(other.m_half_edges);
+    m_edge_block = std::move(other.m_edge_block);
+    m_face_block = std::move(other.m_face_block);
+    m_vertex_block = std::move(other.m_vertex_block);
+    m_half_edge_block = std::move(other.m_half_edge_block);
+    return *this;
+  }
+
   template<typename... Args>
   Vertex createVertex(Args &&... args) {
-    m_vertices.push_back(std::make_unique<VertexElement>(numVertices()));
+    m_vertices.push_back(ElementPtr<VertexElement>(new VertexElement(numVertices())));
     auto v = mystl::make_observer(m_vertices.back().get());
     if constexpr (additional_vertex_attribute_trait<Derived>::value)
       derived().createVertexAttribute(std::forward<Args...>(args...));
@@ -30,7 +78,7 @@ struct HalfEdgeMesh {
 
   template<typename... Args>
   Edge createEdge(Args &&... args) {
-    m_edges.push_back(std::make_unique<EdgeElement>(numEdges()));
+    m_edges.push_back(ElementPtr<EdgeElement>(new EdgeElement(numEdges())));
     auto e = mystl::make_observer(m_edges.back().get());
     if constexpr (additional_edge_attribute_trait<Derived>::value)
       derived().createEdgeAttribute(std::forward<Args...>(args...));
@@ -39,7 +87,7 @@ struct HalfEdgeMesh {
 
   template<typename... Args>
   Face createFace(Args &&... args) {
-    m_faces.push_back(std::make_unique<FaceElement>(numFaces()));
+    m_faces.push_back(ElementPtr<FaceElement>(new FaceElement(numFaces())));
     auto f = mystl::make_observer(m_faces.back().get());
     if constexpr (additional_face_attribute_trait<Derived>::value)
       derived().createFaceAttribute(std::forward<Args...>(args...));
@@ -48,7 +96,7 @@ struct HalfEdgeMesh {
 
   template<typename... Args>
   HalfEdge createHalfEdge(Args &&... args) {
-    m_half_edges.push_back(std::make_unique<HalfEdgeElement>(numHalfEdges()));
+    m_half_edges.push_back(ElementPtr<HalfEdgeElement>(new HalfEdgeElement(numHalfEdges())));
     return mystl::make_observer(m_half_edges.back().get());;
   }
 
@@ -147,6 +195,36 @@ struct HalfEdgeMesh {
   [[nodiscard]] Vertex vertex(int i) const {
     return mystl::make_observer(m_vertices[i].get());
   }
+  [[nodiscard]] Edge edge(int i) const {
+    return mystl::make_observer(m_edges[i].get());
+  }
+  [[nodiscard]] HalfEdge halfEdge(int i) const {
+    return mystl::make_observer(m_half_edges[i].get());
+  }
+
+  // Fills an empty mesh with the given numbers of elements at once, indexed in order and with their
+  // connectivity left for the caller to set by index. Attributes are sized in one go instead of per
+  // element, so that builders which know the exact output sizes skip the create* calls.
+  void allocateElements(int num_vertices, int num_edges, int num_faces, int num_half_edges, int num_threads = 0) {
+    assert(m_vertices.empty() && m_edges.empty() && m_faces.empty() && m_half_edges.empty());
+    // Tens of millions of separate allocations would dominate building large meshes.
+    auto allocate = [num_threads](auto &elements, auto &block, int n) {
+      using Element = typename std::remove_reference_t<decltype(elements)>::value_type::element_type;
+      block.reset(static_cast<Element *>(::operator new(n * sizeof(Element), std::align_val_t(alignof(Element)))));
+      elements.resize(n);
+      mystl::parallel_for(0, n, [&](int i) {
+        auto element = new(block.get() + i) Element(i);
+        element->pooled = true;
+        elements[i] = ElementPtr<Element>(element);
+      }, num_threads, 4096);
+    };
+    allocate(m_vertices, m_vertex_block, num_vertices);
+    allocate(m_edges, m_edge_block, num_edges);
+    allocate(m_faces, m_face_block, num_faces);
+    allocate(m_half_edges, m_half_edge_block, num_half_edges);
+    if constexpr (additional_vertex_attribute_trait<Derived>::value || additional_face_attribute_trait<Derived>::value)
+      derived().allocateAttributes(num_vertices, num_faces);
+  }
   [[nodiscard]] bool isCollapsable(Edge e) const {
     auto h1 = e->halfEdge();
     auto h2 = h1->twin;
@@ -157,19 +235,105 @@ struct HalfEdgeMesh {
       return false;
     return true;
   }
- protected:
 
-  [[nodiscard]] Edge edge(int i) const {
-    return mystl::make_observer(m_edges[i].get());
+  // Rewires the connectivity around e as if it was collapsed into e->halfEdge()->tail.
+  // Element storage is left untouched, so the returned elements still have to be removed
+  // afterwards. Rewiring only touches the 1-ring of e, therefore collapses with disjoint
+  // 1-rings can be rewired concurrently.
+  EdgeCollapseRecord rewireEdgeCollapse(Edge e) {
+    auto h = e->halfEdge();
+    auto t = h->twin;
+    auto h1 = h->next;
+    auto h2 = h1->next;
+    auto t1 = t->next;
+    auto t2 = t1->next;
+    auto h1_twin = h1->twin;
+    auto h2_twin = h2->twin;
+    auto t1_twin = t1->twin;
+    auto t2_twin = t2->twin;
+    auto kept = h->tail;
+    auto removed = h->tip;
+    auto a = h2->tail;
+    auto b = t2->tail;
+    auto ea = h2->edge;
+    auto eb = t1->edge;
+    EdgeCollapseRecord record{
+        .kept_vertex = kept,
+        .removed_vertex = removed,
+        .removed_edges = {e, h1->edge, t2->edge},
+        .removed_faces = {h->face, t->face},
+        .removed_half_edges = {h, h1, h2, t, t1, t2},
+    };
+    for (auto o : removed->outgoingHalfEdges()) {
+      o->tail = kept;
+      o->twin->tip = kept;
+    }
+    h1_twin->twin = h2_twin;
+    h2_twin->twin = h1_twin;
+    t1_twin->twin = t2_twin;
+    t2_twin->twin = t1_twin;
+    h1_twin->edge = ea;
+    ea->halfEdge() = h2_twin;
+    t2_twin->edge = eb;
+    eb->halfEdge() = t1_twin;
+    kept->halfEdge() = h2_twin;
+    a->halfEdge() = h1_twin;
+    b->halfEdge() = t1_twin;
+    return record;
   }
 
-  [[nodiscard]] HalfEdge halfEdge(int i) const {
-    return mystl::make_observer(m_half_edges[i].get());
+  // An interior edge can be flipped if its endpoints keep at least three neighbours and the opposite
+  // vertices are not connected yet.
+  [[nodiscard]] bool isFlippable(Edge e) const {
+    auto h = e->halfEdge();
+    auto t = h->twin;
+    if (!t) return false;
+    auto c = h->next->tip;
+    auto d = t->next->tip;
+    if (c == d || h->tail->degree() <= 3 || h->tip->degree() <= 3)
+      return false;
+    return !c->halfEdgeTo(d).has_value();
   }
 
+  // Turns e, shared by the triangles (a, b, c) and (b, a, d), into the edge from d to c, shared by
+  // (a, d, c) and (d, b, c). No element is created or removed and the faces keep their indices. Only
+  // the two faces and their vertices are touched, so flips with disjoint vertex sets can be rewired
+  // concurrently.
+  void rewireEdgeFlip(Edge e) {
+    auto h = e->halfEdge();
+    auto t = h->twin;
+    auto h1 = h->next;
+    auto h2 = h1->next;
+    auto t1 = t->next;
+    auto t2 = t1->next;
+    auto a = h->tail;
+    auto b = h->tip;
+    auto c = h2->tail;
+    auto d = t2->tail;
+    auto fh = h->face;
+    auto ft = t->face;
+    if (a->halfEdge() == h) a->halfEdge() = t1;
+    if (b->halfEdge() == t) b->halfEdge() = h1;
+    h->tail = d;
+    h->tip = c;
+    t->tail = c;
+    t->tip = d;
+    h->next = h2;
+    h2->next = t1;
+    t1->next = h;
+    t->next = t2;
+    t2->next = h1;
+    h1->next = t;
+    t1->face = fh;
+    h1->face = ft;
+    fh->halfEdge() = h;
+    ft->halfEdge() = t;
+  }
+ protected:
+
   template<typename Element>
   struct ElementRange {
-    explicit ElementRange(const std::vector<std::unique_ptr<Element>> &elements) : elements(elements) {}
+    explicit ElementRange(const std::vector<ElementPtr<Element>> &elements) : elements(elements) {}
 
     using ElementObserver = mystl::observer_ptr<Element>;
 
@@ -187,7 +351,7 @@ struct HalfEdgeMesh {
         return it == other.it;
       }
 
-      std::vector<std::unique_ptr<Element>>::const_iterator it;
+      std::vector<ElementPtr<Element>>::const_iterator it;
     };
 
     [[nodiscard]] Iterator begin() const {
@@ -202,14 +366,19 @@ struct HalfEdgeMesh {
       };
     }
 
-    const std::vector<std::unique_ptr<Element>> &elements;
+    const std::vector<ElementPtr<Element>> &elements;
   };
 
  private:
-  std::vector<std::unique_ptr<EdgeElement>> m_edges;
-  std::vector<std::unique_ptr<FaceElement>> m_faces;
-  std::vector<std::unique_ptr<VertexElement>> m_vertices;
-  std::vector<std::unique_ptr<HalfEdgeElement>> m_half_edges;
+  // Declared first, the blocks outlive the pointers into them.
+  ElementBlock<EdgeElement> m_edge_block;
+  ElementBlock<FaceElement> m_face_block;
+  ElementBlock<VertexElement> m_vertex_block;
+  ElementBlock<HalfEdgeElement> m_half_edge_block;
+  std::vector<ElementPtr<EdgeElement>> m_edges;
+  std::vector<ElementPtr<FaceElement>> m_faces;
+  std::vector<ElementPtr<VertexElement>> m_vertices;
+  std::vector<ElementPtr<HalfEdgeElement>> m_half_edges;
 
   [[nodiscard]] const Derived &derived() const {
     return *static_cast<Derived *>(this);
@@ -0,0 +1,58 @@
+//
+// Created by creeper on 10/16/26.
+//
+
+#ifndef MESHSIMPLIFICATION_MESHARK_INCLUDE_MESHARK_HEAT_GEODESICS_H_
+#define MESHSIMPLIFICATION_MESHARK_INCLUDE_MESHARK_HEAT_GEODESICS_H_
+
+#include <meshark/geometry-mesh.h>
+#include <meshark/sparse-matrix.h>
+#include <array>
+#include <memory>
+#include <optional>
+#include <vector>
+
+namespace meshark {
+struct HeatGeodesicOptions {
+  // Diffusion time t = time_scale * h^2, h the mean edge length. Larger values give smoother distances.
+  double time_scale{1.0};
+  int num_threads{0};
+};
+
+struct GeodesicDistances {
+  // Indexed like the vertices, shifted so that the smallest one at a source is zero.
+  std::vector<double> distances;
+  double heat_seconds{};
+  double divergence_seconds{};
+  double poisson_seconds{};
+};
+
+// Geodesic distances with the heat method of Crane et al.: diffuse heat from the sources for a short
+// time, normalise its gradient on every face and find the function whose gradient matches it best.
+// (M + t L) and L are factored once when built, so a query costs two pairs of triangular solves and
+// a pass over the faces. It holds a copy of the geometry, so the mesh can change afterwards.
+struct HeatGeodesics {
+  // Nothing is returned for an empty source set or one with an index out of range. Several queries may
+  // run at the same time.
+  [[nodiscard]] std::optional<GeodesicDistances> distances(const std::vector<int> &sources) const;
+
+  struct FaceGeometry {
+    std::array<int, 3> vertices;
+    // Cotangent of the angle at every corner.
+    std::array<double, 3> cotangents;
+  };
+
+  std::vector<glm::dvec3> positions;
+  std::vector<FaceGeometry> faces;
+  // Corners 3f + k around every vertex, in increasing order: [corner_offsets[i], corner_offsets[i + 1]).
+  std::vector<int> corner_offsets;
+  std::vector<int> vertex_corners;
+  std::unique_ptr<SparseCholesky> heat_factor;
+  std::unique_ptr<SparseCholesky> poisson_factor;
+  int num_threads{0};
+};
+
+// Nothing is returned if the mesh is not a closed triangle mesh.
+std::unique_ptr<HeatGeodesics> buildHeatGeodesics(const GeometryMesh &mesh, const HeatGeodesicOptions &options = {});
+}
+#endif //MESHSIMPLIFICATION_MESHARK_INCLUDE_MESHARK_HEAT_GEODESICS_H_
@@ -0,0 +1,52 @@
+//
+// Created by creeper on 10/16/26.
+//
+
+#ifndef MESHSIMPLIFICATION_MESHARK_INCLUDE_MESHARK_ISOTROPIC_REMESHER_H_
+#define MESHSIMPLIFICATION_MESHARK_INCLUDE_MESHARK_ISOTROPIC_REMESHER_H_
+
+#include <meshark/geometry-mesh.h>
+#include <optional>
+#include <vector>
+
+namespace meshark {
+struct RemeshOptions {
+  // Zero: the mean edge length of the input.
+  float target_edge_length{0.0f};
+  int num_iterations{5};
+  // Pull the smoothed vertices back onto the input surface.
+  bool project{true};
+  int num_threads{0};
+};
+
+struct RemeshIterationStats {
+  int splits{};
+  int collapses{};
+  int flips{};
+  // Faces at the end of the iteration.
+  size_t num_faces{};
+  double split_seconds{};
+  double collapse_seconds{};
+  double flip_seconds{};
+  double smooth_seconds{};
+
+  [[nodiscard]] double seconds() const {
+    return split_seconds + collapse_seconds + flip_seconds + smooth_seconds;
+  }
+};
+
+struct RemeshStats {
+  float target_edge_length{};
+  std::vector<RemeshIterationStats> iterations;
+};
+
+// Botsch-Kobbelt isotropic remeshing of a closed triangle mesh, in place: every iteration splits edges
+// longer than 4/3 of the target length, collapses those shorter than 4/5 of it, flips edges towards
+// valence 6 and moves the vertices tangentially towards the centroid of their neighbours. Splits and
+// collapses run sequentially; flips are applied in parallel in batches of edges with disjoint
+// vertices, and smoothing updates all vertices at once from the previous positions, so the result
+// does not depend on the number of threads. Nothing is returned if the mesh is not a closed triangle
+// mesh.
+std::optional<RemeshStats> remeshIsotropic(GeometryMesh &mesh, const RemeshOptions &options = {});
+}
+#endif //MESHSIMPLIFICATION_MESHARK_INCLUDE_MESHARK_ISOTROPIC_REMESHER_H_
@@ -0,0 +1,60 @@
+//
+// Created by creeper on 10/16/26.
+//
+
+#ifndef MESHSIMPLIFICATION_MESHARK_INCLUDE_MESHARK_LAPLACIAN_H_
+#define MESHSIMPLIFICATION_MESHARK_INCLUDE_MESHARK_LAPLACIAN_H_
+
+#include <meshark/geometry-mesh.h>
+#include <meshark/sparse-matrix.h>
+#include <optional>
+#include <vector>
+
+namespace meshark {
+enum class LaplacianWeighting {
+  kUniform,
+  // (cot a + cot b) / 2, with a and b the angles opposite the edge.
+  kCotangent,
+};
+
+// Positive semidefinite Laplacian of a closed triangle mesh, rows indexed like the vertices: L_ij = -w_ij
+// for neighbours and L_ii the sum of the weights of row i. Rows are filled in parallel. Empty if the
+// mesh is not a closed triangle mesh.
+CsrMatrix buildLaplacian(const GeometryMesh &mesh, LaplacianWeighting weighting, int num_threads = 0);
+// Lumped mass matrix: a third of the area of the faces around every vertex.
+std::vector<double> buildLumpedMass(const GeometryMesh &mesh, int num_threads = 0);
+
+struct LaplacianSolveStats {
+  // Solver iterations, summed over the coordinates and steps.
+  int iterations{};
+  bool converged{true};
+  double build_seconds{};
+  double solve_seconds{};
+};
+
+struct ImplicitSmoothingOptions {
+  LaplacianWeighting weighting{LaplacianWeighting::kCotangent};
+  // Backward Euler step, scaled so that 1 smooths a regular mesh about as much as moving every vertex
+  // to the centroid of its neighbours, for either weighting.
+  double time_step{1.0};
+  int num_steps{1};
+  ConjugateGradientOptions solver;
+};
+
+// Backward Euler steps of the diffusion flow, (M + t L) x' = M x per coordinate, with the mass M the
+// vertex degrees for uniform weights and the lumped areas for cotangent ones. The operators are rebuilt
+// every step. Nothing is returned if the mesh is not a closed triangle mesh.
+std::optional<LaplacianSolveStats> smoothImplicitly(GeometryMesh &mesh, const ImplicitSmoothingOptions &options = {});
+
+struct FairingOptions {
+  LaplacianWeighting weighting{LaplacianWeighting::kCotangent};
+  ConjugateGradientOptions solver;
+};
+
+// Moves the vertices that are not fixed, indexed like the vertices, to where the Laplacian of the
+// positions vanishes, with the fixed ones as boundary conditions; every free region has to touch a
+// fixed vertex. Nothing is returned if the mesh is not a closed triangle mesh.
+std::optional<LaplacianSolveStats> fairMesh(GeometryMesh &mesh, const std::vector<char> &fixed,
+                                            const FairingOptions &options = {});
+}
+#endif //MESHSIMPLIFICATION_MESHARK_INCLUDE_MESHARK_LAPLACIAN_H_
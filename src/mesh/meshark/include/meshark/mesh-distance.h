@@ -0,0 +1,55 @@
+//
+// Created by creeper on 10/16/26.
+//
+
+#ifndef MESHSIMPLIFICATION_MESHARK_INCLUDE_MESHARK_MESH_DISTANCE_H_
+#define MESHSIMPLIFICATION_MESHARK_INCLUDE_MESHARK_MESH_DISTANCE_H_
+
+#include <meshark/geometry-mesh.h>
+#include <meshark/bvh.h>
+#include <algorithm>
+#include <cstdint>
+
+namespace meshark {
+// Distances from the samples of one surface to another. Mean and RMS are over the samples spread
+// uniformly over the area; the maximum also covers the vertices, where the largest deviations of a
+// simplified mesh usually are.
+struct SurfaceDistance {
+  double max{};
+  double mean{};
+  double rms{};
+  int64_t num_area_samples{};
+  int64_t num_vertex_samples{};
+};
+
+struct MeshDistance {
+  // From the samples of the first mesh to the second, and back.
+  SurfaceDistance forward;
+  SurfaceDistance backward;
+  // Diagonal of the bounding box of the first mesh, to relate the distances to.
+  double diagonal{};
+
+  [[nodiscard]] double hausdorff() const {
+    return std::max(forward.max, backward.max);
+  }
+  // The worse direction, like the Hausdorff distance.
+  [[nodiscard]] double rms() const {
+    return std::max(forward.rms, backward.rms);
+  }
+};
+
+struct MeshDistanceOptions {
+  // Area samples per direction, spread over the faces proportionally to their area.
+  int64_t num_samples{1000000};
+  bool sample_vertices{true};
+  // Samples only depend on the seed and the mesh, not on the number of threads.
+  uint64_t seed{0};
+  int num_threads{0};
+};
+
+SurfaceDistance measureSurfaceDistance(const GeometryMesh &from, const FaceBvh &to,
+                                       const MeshDistanceOptions &options = {});
+// Builds a BVH over each mesh and samples both directions, like Metro.
+MeshDistance measureMeshDistance(const GeometryMesh &a, const GeometryMesh &b, const MeshDistanceOptions &options = {});
+}
+#endif //MESHSIMPLIFICATION_MESHARK_INCLUDE_MESHARK_MESH_DISTANCE_H_
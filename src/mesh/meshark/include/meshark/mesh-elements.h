@@ -22,7 +22,12 @@ struct HalfEdgeElement {
   template<typename Derived>
   friend
   struct HalfEdgeMesh;
+  template<typename Element>
+  friend
+  struct ElementDeleter;
   int index;
+  // Lives in a block allocated by HalfEdgeMesh::allocateElements instead of on its own.
+  bool pooled{false};
 };
 
 inline HalfEdge nullHalfEdge() {
@@ -52,11 +57,15 @@ struct EdgeElement {
   template<typename Derived>
   friend
   struct HalfEdgeMesh;
+  template<typename Element>
+  friend
+  struct ElementDeleter;
   template<typename T>
   friend
   struct EdgeData;
   HalfEdge he;
   int index;
+  bool pooled{false};
 };
 
 inline Edge nullEdge() {
@@ -131,11 +140,15 @@ struct FaceElement {
   template<typename Derived>
   friend
   struct HalfEdgeMesh;
+  template<typename Element>
+  friend
+  struct ElementDeleter;
   template<typename T>
   friend
   struct FaceData;
   HalfEdge he;
   int index;
+  bool pooled{false};
 };
 inline Face nullFace() {
   return mystl::make_observer<FaceElement>(nullptr);
@@ -147,8 +160,8 @@ struct VertexElement {
 
     struct Iterator {
       Iterator &operator++() {
-        // TODO: implement operator++ for OutgoingHalfEdgeRange::Iterator
-
+        it = it->twin->next;
+        if (it == start) it = static_cast<HalfEdge>(nullptr);
         return *this;
       }
 
@@ -222,11 +235,15 @@ struct VertexElement {
   template<typename Derived>
   friend
   struct HalfEdgeMesh;
+  template<typename Element>
+  friend
+  struct ElementDeleter;
   template<typename T>
   friend
   struct VertexData;
   HalfEdge he;
   int index;
+  bool pooled{false};
 };
 inline Vertex nullVertex() {
   return mystl::make_observer<VertexElement>(nullptr);
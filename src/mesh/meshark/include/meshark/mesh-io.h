@@ -6,7 +6,11 @@
 #define MESHSIMPLIFICATION_MESHARK_INCLUDE_MESHARK_MESH_IO_H_
 
 #include <meshark/geometry-mesh.h>
+#include <mystl/thread-pool.h>
+#include <atomic>
 #include <filesystem>
+#include <memory>
+#include <semaphore>
 
 namespace meshark {
 struct WavefrontObj {
@@ -22,7 +26,47 @@ struct WavefrontObj {
   std::vector<glm::vec3> normals;
 };
 
+// Relative (negative) indices are resolved, and nothing is returned if a face refers to an element
+// that does not exist.
 std::unique_ptr<WavefrontObj> readWavefrontObj(const std::filesystem::path &path);
 std::unique_ptr<GeometryMesh> readGeometryMeshFromWavefrontObj(const std::filesystem::path &path);
+// Like readGeometryMeshFromWavefrontObj, but checks that the file holds a closed manifold triangle mesh
+// before building the half-edge mesh, which the simplifiers rely on.
+std::unique_ptr<GeometryMesh> readClosedManifoldFromWavefrontObj(const std::filesystem::path &path);
+bool writeWavefrontObj(const WavefrontObj &obj, const std::filesystem::path &path);
+// Whether every edge is shared by exactly two consistently oriented faces and every vertex
+// has a single fan, i.e. whether obj can be turned into a GeometryMesh safely. Indices out of range
+// fail the check.
+bool isClosedManifold(const WavefrontObj &obj);
+
+// Writes obj files on a background thread so that the caller does not block on disk. write() blocks
+// while kMaxInFlight snapshots are still being written, which bounds the memory they hold.
+// The destructor waits for all pending writes, wait() also tells whether they all succeeded.
+struct AsyncObjWriter {
+  static constexpr std::ptrdiff_t kMaxInFlight = 2;
+  AsyncObjWriter() = default;
+  AsyncObjWriter(const AsyncObjWriter &) = delete;
+  AsyncObjWriter &operator=(const AsyncObjWriter &) = delete;
+  ~AsyncObjWriter() {
+    wait();
+  }
+  void write(std::unique_ptr<WavefrontObj> obj, std::filesystem::path path) {
+    in_flight.acquire();
+    // Pool tasks are std::functions and have to be copyable.
+    writer.submit([this, obj = std::shared_ptr<WavefrontObj>(std::move(obj)), path = std::move(path)] {
+      if (!writeWavefrontObj(*obj, path)) failed = true;
+      in_flight.release();
+    });
+  }
+  bool wait() {
+    writer.wait();
+    return !failed.exchange(false);
+  }
+ private:
+  std::counting_semaphore<kMaxInFlight> in_flight{kMaxInFlight};
+  std::atomic<bool> failed{false};
+  // Declared last so that it is joined before the members its tasks use are destroyed.
+  mystl::ThreadPool writer{1};
+};
 }
 #endif //MESHSIMPLIFICATION_MESHARK_INCLUDE_MESHARK_MESH_IO_H_
@@ -7,52 +7,364 @@
 
 #include <meshark/geometry-mesh.h>
 #include <meshark/element-data.h>
+#include <meshark/progressive-mesh.h>
 #include <set>
 #include <map>
+#include <span>
+#include <functional>
+#include <chrono>
+#include <optional>
+#include <stop_token>
+#include <future>
+#include <filesystem>
 
 namespace meshark {
 using Real = double;
 
+enum class SimplifyCostModel {
+  // Garland-Heckbert quadric error metric, with a 4x4 quadric stored per vertex.
+  kQuadricError,
+  // Lindstrom-Turk memoryless simplification: costs and placements are derived from the current
+  // faces around the edge (volume preservation and optimization, shape as tie breaker), nothing
+  // is stored per vertex.
+  kMemoryless,
+};
+
+// When to stop a run. Every criterion that is set is checked and the first one reached stops it;
+// the simplifier keeps its queue, so the next call resumes where this one stopped.
+struct SimplifyStoppingPolicy {
+  // Stop once numEdges() <= edge_ratio * original number of edges.
+  std::optional<Real> edge_ratio;
+  // Stop once numFaces() <= max_faces.
+  std::optional<size_t> max_faces;
+  // Stop instead of performing a collapse whose quadric error exceeds max_error.
+  std::optional<Real> max_error;
+  // Wall-clock budget of a single call.
+  std::optional<std::chrono::milliseconds> time_budget;
+  // Stops the run as soon as a stop is requested on the source of this token.
+  std::stop_token stop_token;
+};
+
+enum class SimplifyStopReason {
+  kEdgeRatio,
+  kFaceBudget,
+  kErrorThreshold,
+  kTimeBudget,
+  kNoCollapsableEdge,
+  kCancelled,
+};
+
+// Work of the incremental updates after collapses. The serial modes rebuild only the quadric of the
+// kept vertex and patch those of its ring with the planes that moved; planes_saved counts the face
+// planes that rebuilding the ring quadrics from scratch would have summed on top.
+struct SimplifyRecostStats {
+  int64_t quadrics_recomputed{};
+  int64_t quadrics_patched{};
+  int64_t planes_saved{};
+  int64_t edges_recosted{};
+
+  SimplifyRecostStats &operator+=(const SimplifyRecostStats &other) {
+    quadrics_recomputed += other.quadrics_recomputed;
+    quadrics_patched += other.quadrics_patched;
+    planes_saved += other.planes_saved;
+    edges_recosted += other.edges_recosted;
+    return *this;
+  }
+};
+
+// Time spent by runSimplify in each of its phases, summed over the calls made while timing is enabled.
+struct SimplifyPhaseTimes {
+  // Quadrics and initial edge costs.
+  std::chrono::duration<double> setup{};
+  // Building the cost queue, popping the cheapest edge and re-inserting updated costs.
+  std::chrono::duration<double> queue{};
+  std::chrono::duration<double> link_check{};
+  // Rewiring the mesh and removing the collapsed elements (and their queue entries).
+  std::chrono::duration<double> collapse{};
+  // Collapse positions, quadrics and costs of the edges around collapsed vertices.
+  std::chrono::duration<double> recost{};
+};
+
+// Snapshot of a running simplification. Counters cover the current call only.
+struct SimplifyProgress {
+  int64_t collapses{};
+  // Min-cost edges that were not collapsable and got pushed to the back of the queue.
+  int64_t skipped_edges{};
+  size_t remaining_edges{};
+  Real min_cost{};
+  double collapses_per_second{};
+  std::chrono::duration<double> elapsed{};
+  SimplifyRecostStats recost{};
+};
+
+// State of a MeshSimplifier between two collapses, from which another process carries on with the
+// exact same result. Half-edges are stored as 3 * face + corner, counting corners from the face's
+// half-edge.
+struct SimplifierCheckpoint {
+  SimplifyCostModel cost_model{};
+  std::vector<glm::vec3> positions;
+  // Three vertices per face, starting at the tail of the face's half-edge.
+  std::vector<int> face_vertices;
+  // Where every vertex starts its fan and the half-edge of every edge, whose tail the edge collapses
+  // into. Both decide the outcome bit for bit.
+  std::vector<int> vertex_half_edges;
+  std::vector<int> edge_half_edges;
+  // Per edge, in the order of edge_half_edges, and per vertex. Empty until the costs are initialized.
+  std::vector<Real> edge_costs;
+  std::vector<int> edge_ids;
+  std::vector<glm::mat4> quadrics;
+  int num_original_edges{};
+  Real accumulated_error{};
+  bool recording{};
+  int num_recorded_vertices{};
+  int num_recorded_faces{};
+  std::vector<int> vertex_ids;
+  std::vector<int> face_ids;
+  std::vector<VertexSplitRecord> collapse_records;
+
+  // The mesh the checkpoint was taken of, with the same vertex and face order, or null if the faces
+  // do not form a closed manifold or the half-edge codes do not fit them.
+  [[nodiscard]] std::unique_ptr<GeometryMesh> restoreMesh() const;
+
+  [[nodiscard]] static int halfEdgeCode(const GeometryMesh &mesh, HalfEdge h);
+  [[nodiscard]] static HalfEdge halfEdgeFromCode(const GeometryMesh &mesh, int code);
+};
+
+bool writeSimplifierCheckpoint(const SimplifierCheckpoint &checkpoint, const std::filesystem::path &path);
+std::unique_ptr<SimplifierCheckpoint> readSimplifierCheckpoint(const std::filesystem::path &path);
+
 struct MeshSimplifier {
-  explicit MeshSimplifier(GeometryMesh &mesh)
-      : mesh(mesh), Q(mesh.numVertices()), edge_collapse_cost(mesh.numEdges()), num_original_edges(mesh.numEdges()) {
+  explicit MeshSimplifier(GeometryMesh &mesh, SimplifyCostModel cost_model = SimplifyCostModel::kQuadricError)
+      : mesh(mesh), cost_model(cost_model), edge_collapse_cost(mesh.numEdges()), edge_id(mesh.numEdges()),
+        Q(cost_model == SimplifyCostModel::kQuadricError ? mesh.numVertices() : 0),
+        num_original_edges(mesh.numEdges()) {
   }
 
+  // Resumes from checkpoint. mesh must be checkpoint.restoreMesh().
+  MeshSimplifier(GeometryMesh &mesh, const SimplifierCheckpoint &checkpoint);
+
   void runSimplify(Real alpha);
 
+  SimplifyStopReason runSimplify(const SimplifyStoppingPolicy &policy);
+
+  // Collapses rounds of low-cost edges with disjoint 1-rings concurrently, then re-costs
+  // the touched neighbourhoods in parallel, all on one pool of num_threads - 1 workers and the
+  // calling thread. Picking the batch and removing the collapsed elements stay serial.
+  // num_threads = 0 uses all hardware threads.
+  void runParallelSimplify(Real alpha, int num_threads = 0);
+
+  SimplifyStopReason runParallelSimplify(const SimplifyStoppingPolicy &policy, int num_threads = 0);
+
+  // Splits the mesh into spatial clusters of about cluster_faces faces and simplifies every cluster
+  // on its own thread, leaving the edges near cluster borders alone. Each level does half of the
+  // remaining collapses, then neighbouring clusters are merged so that former borders become
+  // interior, down to a single cluster that finishes serially. Cannot be checkpointed: with
+  // checkpoints enabled it reports an error and returns kCancelled without collapsing anything.
+  void runClusteredSimplify(Real alpha, int num_threads = 0, int cluster_faces = 4096);
+
+  SimplifyStopReason runClusteredSimplify(const SimplifyStoppingPolicy &policy, int num_threads = 0,
+                                          int cluster_faces = 4096);
+
+  // LOD chain in a single run: simplifies down to every alpha in turn (largest first) and hands a
+  // snapshot of the mesh to callback each time numEdges() reaches alpha * original edges.
+  using SnapshotCallback = std::function<void(Real alpha, std::unique_ptr<WavefrontObj> snapshot)>;
+  void runSimplify(std::span<const Real> alphas, const SnapshotCallback &callback);
+  void runParallelSimplify(std::span<const Real> alphas, const SnapshotCallback &callback, int num_threads = 0);
+
+  // Called at most once per interval while a run is in progress, and once when it stops.
+  // Without a callback (the default) nothing is reported.
+  using ProgressCallback = std::function<void(const SimplifyProgress &progress)>;
+  void setProgressCallback(ProgressCallback callback,
+                           std::chrono::milliseconds interval = std::chrono::milliseconds(500)) {
+    progress_callback = std::move(callback);
+    progress_interval = interval;
+  }
+
+  // Sum of the costs (quadric errors for kQuadricError) of all collapses performed so far.
+  [[nodiscard]] Real accumulatedError() const {
+    return accumulated_error;
+  }
+
+  // Records every following collapse as a vertex split, so that any LOD between the current mesh
+  // and the result can be replayed from the records (see extractLevelOfDetail). Ids refer to the
+  // element indices at the time of this call, which are the obj indices for a freshly loaded mesh.
+  void enableCollapseRecording();
+
+  [[nodiscard]] ProgressiveMesh progressiveMesh() const;
+
+  // Copies the state needed to resume. Between runs it can be taken at any time, e.g. after a run
+  // cancelled through its stop token.
+  [[nodiscard]] SimplifierCheckpoint checkpoint() const;
+
+  // Writes a checkpoint to path every interval during runSimplify and runParallelSimplify, the latter
+  // between two rounds. The state is mirrored in flat arrays that are encoded in full once when a run
+  // starts; afterwards a checkpoint only pauses the run to encode the elements changed since the
+  // previous one. The file is written from the mirror on a background thread and renamed over path
+  // once complete, so path always holds a whole checkpoint.
+  void enableCheckpoints(std::filesystem::path path, std::chrono::milliseconds interval) {
+    checkpoint_path = std::move(path);
+    checkpoint_interval = interval;
+  }
+
+  // Times the phases of every following runSimplify call. Off by default, as it reads the clock
+  // several times per collapse.
+  void enablePhaseTiming() {
+    phase_times = SimplifyPhaseTimes{};
+  }
+
+  [[nodiscard]] SimplifyPhaseTimes phaseTimes() const {
+    return phase_times.value_or(SimplifyPhaseTimes{});
+  }
+
   GeometryMesh &mesh;
  private:
+  friend struct MeshletDagBuilder;
+  SimplifyCostModel cost_model;
   EdgeData<Real> edge_collapse_cost;
-  std::multimap<Real, Edge> cost_edge_map;
+  // Edge indices change as edges are removed, so the queue breaks cost ties with the index an edge
+  // had before the first collapse. The resulting total order makes the serial loop deterministic, and
+  // the rounds of the parallel mode independent of the number of threads. The two modes pick different
+  // edges.
+  EdgeData<int> edge_id;
+  using CostKey = std::pair<Real, int>;
+  std::map<CostKey, Edge> cost_edge_map;
   VertexData<glm::mat4> Q;
 
-  [[nodiscard]] Vertex collapseEdge(Edge e);
+  void collapseEdge(Edge e, const glm::vec3 &pos, SimplifyRecostStats &stats);
+
+  void removeCollapsedElements(const EdgeCollapseRecord &record);
 
   void eraseEdgeMapping(Edge e);
 
   int num_original_edges;
+  Real accumulated_error{};
+  ProgressCallback progress_callback;
+  std::chrono::milliseconds progress_interval{500};
+  bool initialized{false};
+  // Whether cost_edge_map holds every edge. Clustered levels keep per-cluster queues instead.
+  bool queued{false};
+
+  std::optional<SimplifyPhaseTimes> phase_times;
+
+  std::optional<std::filesystem::path> checkpoint_path;
+  std::chrono::milliseconds checkpoint_interval{};
+  // Flat copy of the checkpoint state. Removals and re-costs mark the slots they touch, and only those
+  // are encoded again before the next write.
+  struct CheckpointMirror {
+    SimplifierCheckpoint snapshot;
+    bool valid{false};
+    std::vector<int> dirty_vertices, dirty_edges, dirty_faces;
+    std::vector<char> vertex_marks, edge_marks, face_marks;
+    // Slots a removal moved another element into. Faces refer to their vertices by index, vertices and
+    // edges to the face of their half-edge, so those are encoded again as well.
+    std::vector<int> moved_vertices, moved_faces;
+
+    static void mark(std::vector<char> &marks, std::vector<int> &dirty, int i) {
+      if (marks[i]) return;
+      marks[i] = 1;
+      dirty.push_back(i);
+    }
+  };
+  // Read by the pending write, so it is only updated once that is done. Declared before the future,
+  // whose destructor waits for the write.
+  std::unique_ptr<CheckpointMirror> checkpoint_mirror;
+  std::future<void> pending_checkpoint;
+  void writeCheckpointInBackground();
+  void checkpointIfDue(std::chrono::steady_clock::time_point &last_checkpoint);
+  // Encodes the whole state if the mirror is not valid, otherwise only the marked slots.
+  void syncCheckpointMirror();
+  // Encodes the whole state before a run, so that checkpoints during the run stay incremental.
+  void prepareCheckpoints();
+  void resizeCheckpoint(SimplifierCheckpoint &checkpoint) const;
+  void encodeVertex(SimplifierCheckpoint &checkpoint, int i) const;
+  void encodeEdge(SimplifierCheckpoint &checkpoint, int i) const;
+  void encodeFace(SimplifierCheckpoint &checkpoint, int i) const;
+  // Marks v, the faces around it and their vertices and edges, which is all a collapse into v changes.
+  void markCollapsedRing(Vertex v);
+  [[nodiscard]] CheckpointMirror *trackedCheckpointMirror() const {
+    return checkpoint_mirror && checkpoint_mirror->valid ? checkpoint_mirror.get() : nullptr;
+  }
+  // Costs computed by the serial path, applied to the queue once the update is done.
+  std::vector<std::pair<Edge, Real>> updated_costs;
+
+  bool recording{false};
+  int num_recorded_vertices{};
+  int num_recorded_faces{};
+  VertexData<int> vertex_id;
+  FaceData<int> face_id;
+  std::vector<VertexSplitRecord> collapse_records;
+
+  [[nodiscard]] VertexSplitRecord makeVertexSplitRecord(const EdgeCollapseRecord &record, const glm::vec3 &pos) const;
+
+  void initializeCosts(int num_threads = 1, bool build_queue = true);
+
+  struct ClusterRun {
+    std::vector<EdgeCollapseRecord> records;
+    std::vector<VertexSplitRecord> split_records;
+    Real error{};
+    Real max_cost{};
+    SimplifyRecostStats recost;
+  };
+
+  // Collapses the cheapest edges of one cluster up to cost threshold, at most max_collapses of them.
+  // Only edges between interior vertices (as flagged by the caller) are touched, which keeps
+  // concurrent clusters apart; elements are left in place for the caller to remove.
+  void simplifyCluster(std::span<const Edge> edges, Real threshold, size_t max_collapses,
+                       const std::vector<char> &interior, std::vector<char> &touched, std::vector<char> &dead_edges,
+                       const SimplifyStoppingPolicy &policy,
+                       std::optional<std::chrono::steady_clock::time_point> deadline, ClusterRun &run);
+
+  // Number of collapses left before the edge ratio or face budget of policy is reached, or nullopt
+  // if the policy has neither.
+  [[nodiscard]] std::optional<Real> remainingCollapses(const SimplifyStoppingPolicy &policy) const;
+
+  [[nodiscard]] std::optional<SimplifyStopReason> checkCountTargets(const SimplifyStoppingPolicy &policy) const;
 
   struct MinCostEdgeCollapsingResult {
     Edge failed_edge;
     bool is_collapsable;
   };
 
-  MinCostEdgeCollapsingResult collapseMinCostEdge();
+  MinCostEdgeCollapsingResult collapseMinCostEdge(SimplifyRecostStats &stats);
 
-  void updateVertexPos(Vertex v, const glm::vec3 &pos);
+  // Takes the planes of the two faces a collapse removes out of the quadrics of their opposite
+  // vertices. Must run after the rewiring and before the faces are removed.
+  void retractRemovedPlanes(const EdgeCollapseRecord &record);
+
+  // Moves v, the vertex an edge was just collapsed into, to pos. The quadric of v is recomputed, the
+  // quadrics of its ring trade the old planes of the faces around v for the new ones, and every edge
+  // around them is handed to update_cost. The edges are enumerated without marking them, which keeps
+  // concurrent clusters from sharing any state.
+  template<typename UpdateCost>
+  void updateVertexPos(Vertex v, const glm::vec3 &pos, SimplifyRecostStats &stats, UpdateCost &&update_cost);
 
   [[nodiscard]] glm::mat4 computeQuadricMatrix(Vertex v) const;
 
+  // The plane of f as computeQuadricMatrix sums it into the quadric of its corner c.
+  [[nodiscard]] glm::mat4 planeQuadric(Face f, Vertex c) const;
+
   [[nodiscard]] Real computeEdgeCost(Edge e) const;
 
   [[nodiscard]] glm::vec3 computeOptimalCollapsePosition(Edge e) const;
 
+  struct MemorylessCollapse {
+    glm::vec3 position;
+    Real cost;
+  };
+
+  [[nodiscard]] MemorylessCollapse computeMemorylessCollapse(Edge e) const;
+
   void updateEdgeCost(Edge e, Real updated_cost) {
     if (edge_collapse_cost(e) == updated_cost)
       return;
-    eraseEdgeMapping(e);
+    // The node moves to its new key instead of being freed and allocated again.
+    auto node = cost_edge_map.extract({edge_collapse_cost(e), edge_id(e)});
+    assert(!node.empty());
+    node.key().first = updated_cost;
+    cost_edge_map.insert(std::move(node));
     edge_collapse_cost(e) = updated_cost;
-    cost_edge_map.insert({updated_cost, e});
+    if (auto mirror = trackedCheckpointMirror())
+      CheckpointMirror::mark(mirror->edge_marks, mirror->dirty_edges, mesh.index(e));
   }
 };
 }
@@ -0,0 +1,80 @@
+//
+// Created by creeper on 10/16/26.
+//
+
+#ifndef MESHSIMPLIFICATION_MESHARK_INCLUDE_MESHARK_MESHLET_DAG_H_
+#define MESHSIMPLIFICATION_MESHARK_INCLUDE_MESHARK_MESHLET_DAG_H_
+
+#include <meshark/geometry-mesh.h>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <vector>
+
+namespace meshark {
+struct MeshletCluster {
+  uint32_t first_vertex;
+  uint32_t first_triangle;
+  uint8_t num_vertices;
+  uint8_t num_triangles;
+  uint16_t level;
+  // Group whose simplification produced the cluster, kNoGroup on level 0.
+  uint32_t group;
+  // Group the cluster is merged into and simplified on the next level, kNoGroup for roots.
+  uint32_t parent_group;
+  // Bounding sphere as (center, radius).
+  glm::vec4 bounds;
+  // Error of the cluster, and of its parent group (infinite for roots). A renderer draws the cluster
+  // when lod_error <= threshold < parent_error.
+  float lod_error;
+  float parent_error;
+};
+static_assert(sizeof(MeshletCluster) == 44);
+
+struct MeshletGroup {
+  // Clusters the group was built from, as a range of MeshletDag::group_children.
+  uint32_t first_child;
+  uint32_t num_children;
+  // Clusters produced by simplifying the group, always contiguous.
+  uint32_t first_cluster;
+  uint32_t num_clusters;
+  // Encloses the bounds of the children, so that LOD selection with it stays monotonic.
+  glm::vec4 bounds;
+  float error;
+};
+static_assert(sizeof(MeshletGroup) == 36);
+
+struct MeshletDag {
+  static constexpr uint32_t kNoGroup = 0xffffffff;
+  std::vector<glm::vec3> positions;
+  // Three cluster-local vertex indices per triangle.
+  std::vector<uint8_t> indices;
+  std::vector<MeshletCluster> clusters;
+  std::vector<MeshletGroup> groups;
+  std::vector<uint32_t> group_children;
+};
+
+struct MeshletDagOptions {
+  int max_vertices{64};
+  int max_triangles{124};
+  // Clusters merged into one group before simplification.
+  int group_size{8};
+  int num_threads{0};
+};
+
+// Builds a cluster LOD DAG: faces are split into meshlets, neighbouring meshlets are grouped, every
+// group is simplified to half of its triangles with its border locked and split into meshlets again,
+// until a single cluster remains or nothing simplifies any more. Groups that share no vertex are
+// simplified concurrently. The mesh is simplified in place.
+struct MeshletDagBuilder {
+  explicit MeshletDagBuilder(GeometryMesh &mesh) : mesh(mesh) {}
+
+  std::unique_ptr<MeshletDag> build(const MeshletDagOptions &options = {});
+
+  GeometryMesh &mesh;
+};
+
+bool writeMeshletDag(const MeshletDag &dag, const std::filesystem::path &path);
+std::unique_ptr<MeshletDag> readMeshletDag(const std::filesystem::path &path);
+}
+#endif //MESHSIMPLIFICATION_MESHARK_INCLUDE_MESHARK_MESHLET_DAG_H_
@@ -0,0 +1,40 @@
+//
+// Created by creeper on 10/16/26.
+//
+
+#ifndef MESHSIMPLIFICATION_MESHARK_INCLUDE_MESHARK_OOC_SIMPLIFIER_H_
+#define MESHSIMPLIFICATION_MESHARK_INCLUDE_MESHARK_OOC_SIMPLIFIER_H_
+
+#include <meshark/mesh-io.h>
+#include <filesystem>
+#include <memory>
+
+namespace meshark {
+struct OutOfCoreSimplifyOptions {
+  // Upper bound (in bytes) for the cluster grid: cells, their quadrics and the clustered triangles.
+  // The grid is coarsened on the fly whenever its estimate exceeds that.
+  size_t memory_budget = size_t(256) << 20;
+  // Where the vertex positions are spilled. Empty uses std::filesystem::temp_directory_path(), i.e.
+  // $TMPDIR or /tmp, which is often a tmpfs held in memory; point it at a disk for inputs whose
+  // positions do not fit in RAM.
+  std::filesystem::path spill_directory;
+};
+
+struct OutOfCoreSimplifyResult {
+  std::unique_ptr<WavefrontObj> mesh;
+  size_t num_input_vertices{};
+  size_t num_input_triangles{};
+  double cell_size{};
+  size_t peak_grid_bytes{};
+  // Size of the disk-backed position table.
+  size_t position_bytes{};
+};
+
+// Lindstrom-style out-of-core clustering: streams the triangles of an obj file once, accumulates
+// area-weighted plane quadrics into a sparse grid and places one vertex per occupied cell. A first
+// pass spills the vertex positions to a memory-mapped temporary file, so only the grid is held in
+// memory; faces never are. Fails with an empty mesh if the file cannot be read or spilled.
+OutOfCoreSimplifyResult simplifyOutOfCore(const std::filesystem::path &path,
+                                          const OutOfCoreSimplifyOptions &options = {});
+}
+#endif //MESHSIMPLIFICATION_MESHARK_INCLUDE_MESHARK_OOC_SIMPLIFIER_H_
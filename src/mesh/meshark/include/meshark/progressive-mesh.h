@@ -0,0 +1,47 @@
+//
+// Created by creeper on 10/16/26.
+//
+
+#ifndef MESHSIMPLIFICATION_MESHARK_INCLUDE_MESHARK_PROGRESSIVE_MESH_H_
+#define MESHSIMPLIFICATION_MESHARK_INCLUDE_MESHARK_PROGRESSIVE_MESH_H_
+
+#include <meshark/mesh-io.h>
+#include <filesystem>
+#include <memory>
+#include <vector>
+#include <array>
+
+namespace meshark {
+// One edge collapse, stored so that it can be replayed on the base mesh (collapse direction) or
+// inverted as a vertex split. All ids are vertex/face indices of the base mesh.
+struct VertexSplitRecord {
+  int kept_vertex;
+  int removed_vertex;
+  // The vertices opposite to the collapsed edge, which delimit the faces that go back to
+  // removed_vertex when the collapse is undone.
+  int left_vertex;
+  int right_vertex;
+  std::array<int, 2> removed_faces;
+  glm::vec3 new_position;
+  glm::vec3 kept_position;
+  glm::vec3 removed_position;
+};
+static_assert(sizeof(VertexSplitRecord) == 60);
+
+struct ProgressiveMesh {
+  int num_base_vertices{};
+  int num_base_faces{};
+  std::vector<VertexSplitRecord> records;
+
+  // Number of leading records to replay so that at most face_ratio of the base faces remain.
+  [[nodiscard]] int numCollapsesForFaceRatio(double face_ratio) const;
+};
+
+bool writeProgressiveMesh(const ProgressiveMesh &pm, const std::filesystem::path &path);
+std::unique_ptr<ProgressiveMesh> readProgressiveMesh(const std::filesystem::path &path);
+// Replays the first num_collapses records on base in a single linear pass. Nothing is returned if a
+// record refers to a vertex or face that is not in base, or to a vertex that was already removed.
+std::unique_ptr<WavefrontObj> extractLevelOfDetail(const WavefrontObj &base, const ProgressiveMesh &pm,
+                                                   int num_collapses);
+}
+#endif //MESHSIMPLIFICATION_MESHARK_INCLUDE_MESHARK_PROGRESSIVE_MESH_H_
@@ -0,0 +1,63 @@
+//
+// Created by creeper on 10/16/26.
+//
+
+#ifndef MESHSIMPLIFICATION_MESHARK_INCLUDE_MESHARK_QUADRIC_H_
+#define MESHSIMPLIFICATION_MESHARK_INCLUDE_MESHARK_QUADRIC_H_
+
+#include <glm/glm.hpp>
+#include <array>
+#include <optional>
+#include <cmath>
+
+namespace meshark {
+// Symmetric 4x4 quadric stored as its upper triangle (10 doubles instead of 16), for
+// places that keep one quadric per cluster/cell and care about the footprint.
+struct Quadric {
+  std::array<double, 10> a{};
+
+  static Quadric fromPlane(const glm::dvec4 &p, double weight = 1.0) {
+    Quadric q;
+    q.a = {p.x * p.x, p.x * p.y, p.x * p.z, p.x * p.w,
+           p.y * p.y, p.y * p.z, p.y * p.w,
+           p.z * p.z, p.z * p.w,
+           p.w * p.w};
+    for (auto &x : q.a) x *= weight;
+    return q;
+  }
+
+  Quadric &operator+=(const Quadric &rhs) {
+    for (int i = 0; i < 10; i++) a[i] += rhs.a[i];
+    return *this;
+  }
+
+  [[nodiscard]] double evaluate(const glm::dvec3 &v) const {
+    return a[0] * v.x * v.x + 2 * a[1] * v.x * v.y + 2 * a[2] * v.x * v.z + 2 * a[3] * v.x
+        + a[4] * v.y * v.y + 2 * a[5] * v.y * v.z + 2 * a[6] * v.y
+        + a[7] * v.z * v.z + 2 * a[8] * v.z
+        + a[9];
+  }
+
+  // Point minimizing the quadric, or nullopt if the 3x3 system is (nearly) singular.
+  [[nodiscard]] std::optional<glm::dvec3> minimizer() const {
+    glm::dmat3 A(a[0], a[1], a[2],
+                 a[1], a[4], a[5],
+                 a[2], a[5], a[7]);
+    double det = glm::determinant(A);
+    double scale = std::abs(a[0]) + std::abs(a[4]) + std::abs(a[7]);
+    if (std::abs(det) <= 1e-9 * scale * scale * scale)
+      return std::nullopt;
+    return glm::inverse(A) * glm::dvec3(-a[3], -a[6], -a[8]);
+  }
+
+  // Minimizer if it exists and lies in [lo, hi], fallback otherwise. Clustering uses this to keep
+  // ill-conditioned cells from throwing their representative far away.
+  [[nodiscard]] glm::dvec3 boundedMinimizer(const glm::dvec3 &fallback, const glm::dvec3 &lo, const glm::dvec3 &hi) const {
+    auto optimal = minimizer();
+    if (!optimal || glm::any(glm::lessThan(*optimal, lo)) || glm::any(glm::greaterThan(*optimal, hi)))
+      return fallback;
+    return *optimal;
+  }
+};
+}
+#endif //MESHSIMPLIFICATION_MESHARK_INCLUDE_MESHARK_QUADRIC_H_
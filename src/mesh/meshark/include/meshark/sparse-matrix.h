@@ -0,0 +1,110 @@
+//
+// Created by creeper on 10/16/26.
+//
+
+#ifndef MESHSIMPLIFICATION_MESHARK_INCLUDE_MESHARK_SPARSE_MATRIX_H_
+#define MESHSIMPLIFICATION_MESHARK_INCLUDE_MESHARK_SPARSE_MATRIX_H_
+
+#include <memory>
+#include <optional>
+#include <vector>
+
+namespace meshark {
+// Square matrix in compressed sparse row form, with the columns of every row in increasing order.
+struct CsrMatrix {
+  // Entries of row i are [row_offsets[i], row_offsets[i + 1]).
+  std::vector<int> row_offsets{0};
+  std::vector<int> columns;
+  std::vector<double> values;
+
+  [[nodiscard]] int rows() const {
+    return static_cast<int>(row_offsets.size()) - 1;
+  }
+  [[nodiscard]] int nonZeros() const {
+    return static_cast<int>(columns.size());
+  }
+  [[nodiscard]] std::vector<double> diagonal() const;
+  // y = A x, rows in parallel.
+  void multiply(const std::vector<double> &x, std::vector<double> &y, int num_threads = 0) const;
+};
+
+enum class Preconditioner {
+  kNone,
+  kJacobi,
+  // Zero fill-in incomplete Cholesky, factored once per matrix. The triangular solves are serial.
+  kIncompleteCholesky,
+};
+
+// A ~ L L^T with L restricted to the sparsity of the lower triangle of A.
+struct IncompleteCholesky {
+  // z = (L L^T)^-1 r.
+  void solve(const std::vector<double> &r, std::vector<double> &z) const;
+
+  // Rows of L, the diagonal last in every row.
+  CsrMatrix lower;
+  // Multiple of the diagonal of A that was added.
+  double shift{};
+};
+
+// When a pivot breaks down, A is factored again with a growing multiple of its diagonal added, a bounded
+// number of times. Nothing is returned if a diagonal entry of A is not positive and finite, which no
+// shift can fix, or if every retry breaks down.
+std::optional<IncompleteCholesky> factorIncompleteCholesky(const CsrMatrix &a);
+
+struct ConjugateGradientOptions {
+  int max_iterations{1000};
+  // Stop once |b - A x| <= tolerance * |b|.
+  double tolerance{1e-8};
+  Preconditioner preconditioner{Preconditioner::kJacobi};
+  int num_threads{0};
+};
+
+struct ConjugateGradientResult {
+  int iterations{};
+  // Relative residual |b - A x| / |b| at the end.
+  double residual{};
+  bool converged{};
+};
+
+// Preconditioned conjugate gradients for a symmetric positive definite A. The preconditioner is set up
+// once, so solving for many right-hand sides only pays for the iterations. Dot products are summed
+// over fixed chunks of rows, so the iterates do not depend on the number of threads. If A cannot be
+// factored incompletely, Jacobi preconditioning is used instead.
+struct ConjugateGradientSolver {
+  explicit ConjugateGradientSolver(CsrMatrix a, const ConjugateGradientOptions &options = {});
+
+  // Starts from x. Several solves may run at the same time.
+  ConjugateGradientResult solve(const std::vector<double> &b, std::vector<double> &x) const;
+
+  CsrMatrix matrix;
+  ConjugateGradientOptions options;
+  std::vector<double> inverse_diagonal;
+  std::optional<IncompleteCholesky> factor;
+};
+
+// Solves once with a ConjugateGradientSolver, starting from x.
+ConjugateGradientResult solveConjugateGradient(const CsrMatrix &a, const std::vector<double> &b,
+                                               std::vector<double> &x, const ConjugateGradientOptions &options = {});
+
+// P A P^T = L L^T for a symmetric positive definite A, ordered by nested dissection: a part of the graph
+// of A is split at the middle level of a breadth-first search from a peripheral vertex, and that level
+// is ordered after both halves. Factored serially, row by row.
+struct SparseCholesky {
+  // x = A^-1 b. Several solves may run at the same time.
+  void solve(const std::vector<double> &b, std::vector<double> &x) const;
+  [[nodiscard]] int nonZeros() const {
+    return static_cast<int>(rows.size());
+  }
+
+  // Row of A for every row of P A P^T.
+  std::vector<int> permutation;
+  // Columns of L, the diagonal first in every column.
+  std::vector<int> column_offsets;
+  std::vector<int> rows;
+  std::vector<double> values;
+};
+
+// Nothing is returned if A is not positive definite.
+std::unique_ptr<SparseCholesky> factorCholesky(const CsrMatrix &a);
+}
+#endif //MESHSIMPLIFICATION_MESHARK_INCLUDE_MESHARK_SPARSE_MATRIX_H_
@@ -0,0 +1,19 @@
+//
+// Created by creeper on 10/16/26.
+//
+
+#ifndef MESHSIMPLIFICATION_MESHARK_INCLUDE_MESHARK_SUBDIVISION_H_
+#define MESHSIMPLIFICATION_MESHARK_INCLUDE_MESHARK_SUBDIVISION_H_
+
+#include <meshark/geometry-mesh.h>
+#include <memory>
+
+namespace meshark {
+// Loop subdivision of a closed triangle mesh, levels times, with the original Loop weights. Every
+// level splits each face into four: face f becomes the corner faces 4f, 4f + 1, 4f + 2 at its three
+// corners, starting at f->halfEdge()->tail, and the middle face 4f + 3. Old vertices keep their
+// indices and the vertex of edge e gets index numVertices() + e. Null if the mesh is not a closed
+// triangle mesh.
+std::unique_ptr<GeometryMesh> loopSubdivide(const GeometryMesh &mesh, int levels = 1, int num_threads = 0);
+}
+#endif //MESHSIMPLIFICATION_MESHARK_INCLUDE_MESHARK_SUBDIVISION_H_
@@ -0,0 +1,31 @@
+//
+// Created by creeper on 10/16/26.
+//
+
+#ifndef MESHSIMPLIFICATION_MESHARK_INCLUDE_MESHARK_VERTEX_CLUSTERING_SIMPLIFIER_H_
+#define MESHSIMPLIFICATION_MESHARK_INCLUDE_MESHARK_VERTEX_CLUSTERING_SIMPLIFIER_H_
+
+#include <meshark/geometry-mesh.h>
+#include <meshark/mesh-io.h>
+#include <memory>
+
+namespace meshark {
+// O(n) simplifier for preview LODs: vertices are quantized into a uniform grid, every occupied cell
+// is replaced by the minimizer of the summed quadrics of its vertices, and faces that lose a corner
+// are dropped. The result is generally not manifold, so it is returned as an indexed mesh.
+struct VertexClusteringSimplifier {
+  explicit VertexClusteringSimplifier(const GeometryMesh &mesh) : mesh(mesh) {}
+
+  // The cell size is derived from target_faces, the face count of the result only approximates it.
+  std::unique_ptr<WavefrontObj> runSimplify(int target_faces, int num_threads = 0);
+
+  [[nodiscard]] double cellSize() const {
+    return cell_size;
+  }
+
+  const GeometryMesh &mesh;
+ private:
+  double cell_size{};
+};
+}
+#endif //MESHSIMPLIFICATION_MESHARK_INCLUDE_MESHARK_VERTEX_CLUSTERING_SIMPLIFIER_H_
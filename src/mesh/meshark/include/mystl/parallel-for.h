@@ -0,0 +1,48 @@
+//
+// Created by creeper on 10/16/26.
+//
+
+#ifndef MESHSIMPLIFICATION_MESHARK_INCLUDE_MYSTL_PARALLEL_FOR_H_
+#define MESHSIMPLIFICATION_MESHARK_INCLUDE_MYSTL_PARALLEL_FOR_H_
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+namespace mystl {
+inline int default_concurrency() {
+  return std::max(1u, std::thread::hardware_concurrency());
+}
+
+// Calls func(i) for every i in [begin, end), distributing chunks of the range over
+// num_threads threads (0 means default_concurrency()). Small ranges run inline.
+template<typename Func>
+void parallel_for(int begin, int end, Func &&func, int num_threads = 0, int grain_size = 256) {
+  if (num_threads <= 0) num_threads = default_concurrency();
+  int n = end - begin;
+  if (n <= 0) return;
+  int num_chunks = (n + grain_size - 1) / grain_size;
+  num_threads = std::min(num_threads, num_chunks);
+  if (num_threads <= 1) {
+    for (int i = begin; i < end; i++)
+      func(i);
+    return;
+  }
+  std::atomic<int> next_chunk{0};
+  auto worker = [&]() {
+    for (int chunk = next_chunk++; chunk < num_chunks; chunk = next_chunk++) {
+      int chunk_begin = begin + chunk * grain_size;
+      int chunk_end = std::min(end, chunk_begin + grain_size);
+      for (int i = chunk_begin; i < chunk_end; i++)
+        func(i);
+    }
+  };
+  std::vector<std::jthread> threads;
+  threads.reserve(num_threads - 1);
+  for (int t = 1; t < num_threads; t++)
+    threads.emplace_back(worker);
+  worker();
+}
+}
+#endif //MESHSIMPLIFICATION_MESHARK_INCLUDE_MYSTL_PARALLEL_FOR_H_
@@ -0,0 +1,67 @@
+//
+// Created by creeper on 10/16/26.
+//
+
+#ifndef MESHSIMPLIFICATION_MESHARK_INCLUDE_MYSTL_PARALLEL_SORT_H_
+#define MESHSIMPLIFICATION_MESHARK_INCLUDE_MYSTL_PARALLEL_SORT_H_
+
+#include <mystl/parallel-for.h>
+#include <mystl/thread-pool.h>
+#include <algorithm>
+#include <functional>
+#include <iterator>
+
+namespace mystl {
+namespace detail {
+// Sorts num_chunks chunks of [first, last) and merges them pairwise, every level through
+// for_each(n, func), which calls func(i) for every i in [0, n) concurrently.
+template<typename RandomIt, typename Compare, typename ForEach>
+void chunkedSort(RandomIt first, RandomIt last, Compare comp, int num_chunks, ForEach &&for_each) {
+  auto n = static_cast<int>(std::distance(first, last));
+  if (num_chunks <= 1) {
+    std::sort(first, last, comp);
+    return;
+  }
+  auto bound = [&](int chunk) {
+    return first + static_cast<std::ptrdiff_t>(n) * chunk / num_chunks;
+  };
+  for_each(num_chunks, [&](int chunk) {
+    std::sort(bound(chunk), bound(chunk + 1), comp);
+  });
+  for (int width = 1; width < num_chunks; width *= 2) {
+    int num_merges = (num_chunks + 2 * width - 1) / (2 * width);
+    for_each(num_merges, [&](int m) {
+      int lo = 2 * width * m;
+      int mid = std::min(lo + width, num_chunks);
+      int hi = std::min(lo + 2 * width, num_chunks);
+      if (mid < hi)
+        std::inplace_merge(bound(lo), bound(mid), bound(hi), comp);
+    });
+  }
+}
+
+constexpr int kMinSortChunkSize = 1 << 14;
+}
+
+// Sorts chunks of [first, last) concurrently and merges them pairwise, each merge level in parallel.
+template<typename RandomIt, typename Compare = std::less<>>
+void parallel_sort(RandomIt first, RandomIt last, Compare comp = {}, int num_threads = 0) {
+  if (num_threads <= 0) num_threads = default_concurrency();
+  auto n = static_cast<int>(std::distance(first, last));
+  int num_chunks = std::clamp(n / detail::kMinSortChunkSize, 1, num_threads);
+  detail::chunkedSort(first, last, comp, num_chunks, [&](int count, auto &&func) {
+    parallel_for(0, count, func, num_threads, 1);
+  });
+}
+
+// The same on the workers of pool and the calling thread, which must not be one of them.
+template<typename RandomIt, typename Compare = std::less<>>
+void parallel_sort(ThreadPool &pool, RandomIt first, RandomIt last, Compare comp = {}) {
+  auto n = static_cast<int>(std::distance(first, last));
+  int num_chunks = std::clamp(n / detail::kMinSortChunkSize, 1, pool.size() + 1);
+  detail::chunkedSort(first, last, comp, num_chunks, [&](int count, auto &&func) {
+    parallel_for(pool, 0, count, func, 1);
+  });
+}
+}
+#endif //MESHSIMPLIFICATION_MESHARK_INCLUDE_MYSTL_PARALLEL_SORT_H_
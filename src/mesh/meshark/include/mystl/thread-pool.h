@@ -0,0 +1,183 @@
+//
+// Created by creeper on 10/16/26.
+//
+
+#ifndef MESHSIMPLIFICATION_MESHARK_INCLUDE_MYSTL_THREAD_POOL_H_
+#define MESHSIMPLIFICATION_MESHARK_INCLUDE_MYSTL_THREAD_POOL_H_
+
+#include <mystl/parallel-for.h>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <vector>
+
+namespace mystl {
+// Work-stealing pool for independent, long-running tasks. Every worker owns a deque: tasks submitted
+// from a worker go to its own deque and are run newest first, tasks submitted from outside are dealt
+// round-robin, and a worker whose deque is empty steals the oldest task of another one.
+struct ThreadPool {
+  using Task = std::function<void()>;
+
+  // num_threads = 0 uses default_concurrency().
+  explicit ThreadPool(int num_threads = 0) {
+    if (num_threads <= 0) num_threads = default_concurrency();
+    for (int i = 0; i < num_threads; i++)
+      queues.push_back(std::make_unique<Queue>());
+    workers.reserve(num_threads);
+    for (int i = 0; i < num_threads; i++)
+      workers.emplace_back([this, i] { work(i); });
+  }
+
+  ThreadPool(const ThreadPool &) = delete;
+  ThreadPool &operator=(const ThreadPool &) = delete;
+
+  // Runs every task submitted so far before joining.
+  ~ThreadPool() {
+    wait();
+    {
+      std::lock_guard lock(mutex);
+      stopping = true;
+    }
+    wake.notify_all();
+  }
+
+  void submit(Task task) {
+    int q = current_pool == this ? current_worker
+                                 : static_cast<int>(next_queue++ % static_cast<unsigned>(queues.size()));
+    unfinished++;
+    {
+      std::lock_guard lock(queues[q]->mutex);
+      queues[q]->tasks.push_back(std::move(task));
+    }
+    {
+      std::lock_guard lock(mutex);
+      queued++;
+    }
+    wake.notify_one();
+  }
+
+  // Blocks until every submitted task, including those submitted by tasks, has finished.
+  void wait() {
+    std::unique_lock lock(mutex);
+    done.wait(lock, [this] { return unfinished == 0; });
+  }
+
+  [[nodiscard]] int size() const {
+    return static_cast<int>(workers.size());
+  }
+
+ private:
+  struct Queue {
+    std::mutex mutex;
+    std::deque<Task> tasks;
+  };
+
+  std::optional<Task> take(int worker) {
+    {
+      auto &own = *queues[worker];
+      std::lock_guard lock(own.mutex);
+      if (!own.tasks.empty()) {
+        auto task = std::move(own.tasks.back());
+        own.tasks.pop_back();
+        return task;
+      }
+    }
+    for (size_t k = 1; k < queues.size(); k++) {
+      auto &victim = *queues[(worker + k) % queues.size()];
+      std::lock_guard lock(victim.mutex);
+      if (!victim.tasks.empty()) {
+        auto task = std::move(victim.tasks.front());
+        victim.tasks.pop_front();
+        return task;
+      }
+    }
+    return std::nullopt;
+  }
+
+  void work(int worker) {
+    current_pool = this;
+    current_worker = worker;
+    while (true) {
+      {
+        std::unique_lock lock(mutex);
+        wake.wait(lock, [this] { return stopping || queued > 0; });
+        if (queued == 0) return;
+        queued--;
+      }
+      // A task is queued somewhere for every decrement, so taking one cannot fail for long; it can only
+      // be in a deque that is briefly locked.
+      auto task = take(worker);
+      while (!task) {
+        std::this_thread::yield();
+        task = take(worker);
+      }
+      (*task)();
+      if (--unfinished == 0) {
+        std::lock_guard lock(mutex);
+        done.notify_all();
+      }
+    }
+  }
+
+  static inline thread_local const ThreadPool *current_pool{};
+  static inline thread_local int current_worker{};
+
+  std::vector<std::unique_ptr<Queue>> queues;
+  std::mutex mutex;
+  std::condition_variable wake;
+  std::condition_variable done;
+  // Tasks in the deques that no worker has claimed yet, guarded by mutex.
+  int queued{};
+  bool stopping{};
+  std::atomic<int> unfinished{};
+  std::atomic<unsigned> next_queue{};
+  // Last, so that the workers are joined before anything they use is destroyed.
+  std::vector<std::jthread> workers;
+};
+
+// parallel_for on the workers of pool, for loops that run too often to start threads every time, e.g.
+// once per round of a simplification. The caller takes chunks as well, so it must not be a worker of
+// pool itself. Returns once every chunk is done and no helper task still touches the loop state.
+template<typename Func>
+void parallel_for(ThreadPool &pool, int begin, int end, Func &&func, int grain_size = 256) {
+  int n = end - begin;
+  if (n <= 0) return;
+  int num_chunks = (n + grain_size - 1) / grain_size;
+  int num_helpers = std::min(pool.size(), num_chunks - 1);
+  if (num_helpers <= 0) {
+    for (int i = begin; i < end; i++)
+      func(i);
+    return;
+  }
+  // Shared with the helpers, which may only get to run after the caller has taken every chunk.
+  struct State {
+    std::atomic<int> next_chunk{0};
+    std::atomic<int> running;
+  };
+  auto state = std::make_shared<State>();
+  state->running = num_helpers;
+  auto worker = [&, state = state.get()] {
+    for (int chunk = state->next_chunk++; chunk < num_chunks; chunk = state->next_chunk++) {
+      int chunk_begin = begin + chunk * grain_size;
+      int chunk_end = std::min(end, chunk_begin + grain_size);
+      for (int i = chunk_begin; i < chunk_end; i++)
+        func(i);
+    }
+  };
+  for (int t = 0; t < num_helpers; t++) {
+    pool.submit([&worker, state] {
+      worker();
+      if (--state->running == 0) state->running.notify_all();
+    });
+  }
+  worker();
+  for (int running = state->running; running != 0; running = state->running)
+    state->running.wait(running);
+}
+}
+#endif //MESHSIMPLIFICATION_MESHARK_INCLUDE_MYSTL_THREAD_POOL_H_
@@ -0,0 +1,429 @@
+//
+// Created by creeper on 10/16/26.
+//
+#include <meshark/bvh.h>
+#include <mystl/parallel-for.h>
+#include <mystl/thread-pool.h>
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cmath>
+
+namespace meshark {
+
+namespace {
+// Splits fall back to halving the triangle range near this depth, so that traversal stacks fit.
+constexpr int kMaxDepth = 64;
+constexpr int kMaxBins = 64;
+// Nodes with more triangles hand their right subtree to another thread.
+constexpr int kTaskSize = 4096;
+// Nodes with more triangles bin them in parallel.
+constexpr int kParallelBinningSize = 1 << 16;
+
+struct Aabb {
+  glm::vec3 lo{std::numeric_limits<float>::max()};
+  glm::vec3 hi{std::numeric_limits<float>::lowest()};
+
+  void grow(const glm::vec3 &p) {
+    lo = glm::min(lo, p);
+    hi = glm::max(hi, p);
+  }
+  void grow(const Aabb &b) {
+    lo = glm::min(lo, b.lo);
+    hi = glm::max(hi, b.hi);
+  }
+  [[nodiscard]] float area() const {
+    auto d = hi - lo;
+    if (d.x < 0.0f || d.y < 0.0f || d.z < 0.0f) return 0.0f;
+    return 2.0f * (d.x * d.y + d.y * d.z + d.z * d.x);
+  }
+};
+
+struct BuildPrimitive {
+  Aabb bounds;
+  glm::vec3 centroid;
+  int face;
+};
+
+struct Bin {
+  Aabb bounds;
+  int count{};
+};
+
+// Maps centroids to bins along each axis of the centroid bounds; axes without extent have no bins.
+struct Binning {
+  Binning(const Aabb &centroid_bounds, int num_bins) : lo(centroid_bounds.lo), num_bins(num_bins) {
+    auto extent = centroid_bounds.hi - centroid_bounds.lo;
+    for (int axis = 0; axis < 3; axis++)
+      scale[axis] = extent[axis] > 0.0f ? static_cast<float>(num_bins) / extent[axis] : 0.0f;
+  }
+  [[nodiscard]] bool hasBins(int axis) const {
+    return scale[axis] > 0.0f;
+  }
+  [[nodiscard]] int bin(const glm::vec3 &centroid, int axis) const {
+    return std::min(static_cast<int>((centroid[axis] - lo[axis]) * scale[axis]), num_bins - 1);
+  }
+
+  glm::vec3 lo;
+  glm::vec3 scale;
+  int num_bins;
+};
+
+// Primitives are partitioned in place rather than through an index array, so that every pass over a
+// node reads them in memory order. The subtree over primitives[begin, end) placed at slot owns the slots [slot, slot + 2 (end - begin) - 1),
+// so that subtrees can be built concurrently and still land at the same place every time.
+struct BvhBuilder {
+  std::vector<BuildPrimitive> &primitives;
+  std::vector<BvhNode> &nodes;
+  const BvhOptions &options;
+  mystl::ThreadPool &pool;
+
+  void build(uint32_t slot, int begin, int end, int depth) {
+    int n = end - begin;
+    Aabb bounds, centroid_bounds;
+    computeBounds(begin, end, bounds, centroid_bounds);
+    auto makeLeaf = [&] {
+      nodes[slot] = {bounds.lo, static_cast<uint32_t>(begin), bounds.hi, static_cast<uint32_t>(n)};
+    };
+    if (n == 1) return makeLeaf();
+    int mid = -1;
+    // Halving adds at most one level more than the bit width of n.
+    if (depth + std::bit_width(static_cast<unsigned>(n)) + 1 < kMaxDepth) {
+      Binning binning(centroid_bounds, options.num_bins);
+      auto split = findSplit(begin, end, binning);
+      // A node test costs as much as a triangle test.
+      bool split_pays_off = split && 1.0f + split->cost / bounds.area() < static_cast<float>(n);
+      if (n <= options.max_leaf_size && !split_pays_off) return makeLeaf();
+      if (split) {
+        int axis = split->axis;
+        auto first = primitives.begin() + begin;
+        mid = static_cast<int>(std::partition(first, primitives.begin() + end, [&](const BuildPrimitive &primitive) {
+          return binning.bin(primitive.centroid, axis) <= split->bin;
+        }) - primitives.begin());
+      }
+    } else if (n <= options.max_leaf_size) {
+      return makeLeaf();
+    }
+    if (mid <= begin || mid >= end) mid = begin + n / 2;
+    uint32_t left = slot + 1;
+    uint32_t right = slot + 2 * static_cast<uint32_t>(mid - begin);
+    nodes[slot] = {bounds.lo, right, bounds.hi, 0};
+    if (n > kTaskSize) {
+      pool.submit([this, right, mid, end, depth] { build(right, mid, end, depth + 1); });
+      build(left, begin, mid, depth + 1);
+    } else {
+      build(left, begin, mid, depth + 1);
+      build(right, mid, end, depth + 1);
+    }
+  }
+
+ private:
+  struct Split {
+    int axis;
+    int bin;
+    float cost;
+  };
+
+  // Minimum and maximum are exact, so the bounds do not depend on how the range is chunked.
+  void computeBounds(int begin, int end, Aabb &bounds, Aabb &centroid_bounds) const {
+    if (end - begin <= kParallelBinningSize) {
+      for (int i = begin; i < end; i++) {
+        bounds.grow(primitives[i].bounds);
+        centroid_bounds.grow(primitives[i].centroid);
+      }
+      return;
+    }
+    int num_chunks = (end - begin + kParallelBinningSize - 1) / kParallelBinningSize;
+    std::vector<std::pair<Aabb, Aabb>> chunks(num_chunks);
+    mystl::parallel_for(0, num_chunks, [&](int c) {
+      int chunk_begin = begin + c * kParallelBinningSize;
+      int chunk_end = std::min(end, chunk_begin + kParallelBinningSize);
+      for (int i = chunk_begin; i < chunk_end; i++) {
+        chunks[c].first.grow(primitives[i].bounds);
+        chunks[c].second.grow(primitives[i].centroid);
+      }
+    }, options.num_threads, 1);
+    for (const auto &[b, cb] : chunks) {
+      bounds.grow(b);
+      centroid_bounds.grow(cb);
+    }
+  }
+
+  // Cheapest split of the three axes, as the sum of child areas times triangle counts.
+  [[nodiscard]] std::optional<Split> findSplit(int begin, int end, const Binning &binning) const {
+    int num_bins = options.num_bins;
+    std::vector<Bin> bins(3 * num_bins);
+    // One pass for all axes, the three bin updates do not depend on each other.
+    auto binRange = [&](int range_begin, int range_end, Bin *out) {
+      for (int i = range_begin; i < range_end; i++) {
+        const auto &primitive = primitives[i];
+        for (int axis = 0; axis < 3; axis++) {
+          auto &bin = out[axis * num_bins + binning.bin(primitive.centroid, axis)];
+          bin.bounds.grow(primitive.bounds);
+          bin.count++;
+        }
+      }
+    };
+    if (end - begin <= kParallelBinningSize) {
+      binRange(begin, end, bins.data());
+    } else {
+      int num_chunks = (end - begin + kParallelBinningSize - 1) / kParallelBinningSize;
+      int bins_per_chunk = 3 * num_bins;
+      std::vector<Bin> chunk_bins(static_cast<size_t>(num_chunks) * bins_per_chunk);
+      mystl::parallel_for(0, num_chunks, [&](int c) {
+        int chunk_begin = begin + c * kParallelBinningSize;
+        binRange(chunk_begin, std::min(end, chunk_begin + kParallelBinningSize), &chunk_bins[c * bins_per_chunk]);
+      }, options.num_threads, 1);
+      for (int c = 0; c < num_chunks; c++) {
+        for (int b = 0; b < bins_per_chunk; b++) {
+          bins[b].bounds.grow(chunk_bins[c * bins_per_chunk + b].bounds);
+          bins[b].count += chunk_bins[c * bins_per_chunk + b].count;
+        }
+      }
+    }
+    std::optional<Split> best;
+    std::array<float, kMaxBins> right_costs;
+    for (int axis = 0; axis < 3; axis++) {
+      if (!binning.hasBins(axis)) continue;
+      const Bin *axis_bins = &bins[axis * num_bins];
+      Aabb right;
+      int right_count = 0;
+      for (int b = num_bins - 1; b > 0; b--) {
+        right.grow(axis_bins[b].bounds);
+        right_count += axis_bins[b].count;
+        right_costs[b] = right.area() * static_cast<float>(right_count);
+      }
+      Aabb left;
+      int left_count = 0;
+      // Splitting after bin b.
+      for (int b = 0; b < num_bins - 1; b++) {
+        left.grow(axis_bins[b].bounds);
+        left_count += axis_bins[b].count;
+        if (left_count == 0 || left_count == end - begin) continue;
+        float cost = left.area() * static_cast<float>(left_count) + right_costs[b + 1];
+        if (!best || cost < best->cost) best = Split{axis, b, cost};
+      }
+    }
+    return best;
+  }
+};
+
+// Entry distance of the ray into the box, infinity on a miss.
+float intersectBox(const BvhNode &node, const glm::vec3 &origin, const glm::vec3 &inv_direction,
+                   float t_min, float t_max) {
+  auto t0 = (node.lo - origin) * inv_direction;
+  auto t1 = (node.hi - origin) * inv_direction;
+  auto entries = glm::min(t0, t1);
+  auto exits = glm::max(t0, t1);
+  float entry = std::max(std::max(entries.x, entries.y), std::max(entries.z, t_min));
+  float exit = std::min(std::min(exits.x, exits.y), std::min(exits.z, t_max));
+  return entry <= exit ? entry : std::numeric_limits<float>::infinity();
+}
+
+float squaredDistanceToBox(const BvhNode &node, const glm::vec3 &p) {
+  auto d = glm::max(glm::max(node.lo - p, p - node.hi), glm::vec3(0.0f));
+  return glm::dot(d, d);
+}
+
+// Depth-first, nearer child first. visit may lower t_max and returns false to stop.
+template<typename Visit>
+void traverse(const std::vector<BvhNode> &nodes, const Ray &ray, Visit &&visit) {
+  if (nodes.empty()) return;
+  auto inv_direction = 1.0f / ray.direction;
+  float t_max = ray.t_max;
+  if (std::isinf(intersectBox(nodes[0], ray.origin, inv_direction, ray.t_min, t_max))) return;
+  // Nodes to visit with their entry distance, which may have moved out of reach once they are popped.
+  std::array<std::pair<uint32_t, float>, kMaxDepth> stack;
+  int stack_size = 0;
+  uint32_t i = 0;
+  while (true) {
+    const auto &node = nodes[i];
+    if (node.count) {
+      if (!visit(node, t_max)) return;
+    } else {
+      uint32_t closer = i + 1, farther = node.index;
+      float t_closer = intersectBox(nodes[closer], ray.origin, inv_direction, ray.t_min, t_max);
+      float t_farther = intersectBox(nodes[farther], ray.origin, inv_direction, ray.t_min, t_max);
+      if (t_farther < t_closer) {
+        std::swap(closer, farther);
+        std::swap(t_closer, t_farther);
+      }
+      if (!std::isinf(t_closer)) {
+        if (!std::isinf(t_farther)) stack[stack_size++] = {farther, t_farther};
+        i = closer;
+        continue;
+      }
+    }
+    do {
+      if (stack_size == 0) return;
+      i = stack[--stack_size].first;
+    } while (stack[stack_size].second > t_max);
+  }
+}
+}
+
+// Möller-Trumbore.
+std::optional<RayHit> intersectTriangle(const BvhTriangle &triangle, const Ray &ray) {
+  auto e1 = triangle.v1 - triangle.v0;
+  auto e2 = triangle.v2 - triangle.v0;
+  auto p = glm::cross(ray.direction, e2);
+  float det = glm::dot(e1, p);
+  if (det == 0.0f) return std::nullopt;
+  float inv_det = 1.0f / det;
+  auto s = ray.origin - triangle.v0;
+  float u = glm::dot(s, p) * inv_det;
+  if (u < 0.0f || u > 1.0f) return std::nullopt;
+  auto q = glm::cross(s, e1);
+  float v = glm::dot(ray.direction, q) * inv_det;
+  if (v < 0.0f || u + v > 1.0f) return std::nullopt;
+  float t = glm::dot(e2, q) * inv_det;
+  if (t < ray.t_min || t > ray.t_max) return std::nullopt;
+  return RayHit{t, triangle.face, {u, v}};
+}
+
+// Ericson, Real-Time Collision Detection 5.1.5.
+glm::vec3 closestPointOnTriangle(const BvhTriangle &triangle, const glm::vec3 &p) {
+  const auto &a = triangle.v0, &b = triangle.v1, &c = triangle.v2;
+  auto ab = b - a, ac = c - a, ap = p - a;
+  float d1 = glm::dot(ab, ap), d2 = glm::dot(ac, ap);
+  if (d1 <= 0.0f && d2 <= 0.0f) return a;
+  auto bp = p - b;
+  float d3 = glm::dot(ab, bp), d4 = glm::dot(ac, bp);
+  if (d3 >= 0.0f && d4 <= d3) return b;
+  float vc = d1 * d4 - d3 * d2;
+  if (vc <= 0.0f && d1 >= 0.0f && d3 <= 0.0f) return a + ab * (d1 / (d1 - d3));
+  auto cp = p - c;
+  float d5 = glm::dot(ab, cp), d6 = glm::dot(ac, cp);
+  if (d6 >= 0.0f && d5 <= d6) return c;
+  float vb = d5 * d2 - d1 * d6;
+  if (vb <= 0.0f && d2 >= 0.0f && d6 <= 0.0f) return a + ac * (d2 / (d2 - d6));
+  float va = d3 * d6 - d5 * d4;
+  if (va <= 0.0f && d4 - d3 >= 0.0f && d5 - d6 >= 0.0f)
+    return b + (c - b) * ((d4 - d3) / ((d4 - d3) + (d5 - d6)));
+  float denom = 1.0f / (va + vb + vc);
+  return a + ab * (vb * denom) + ac * (vc * denom);
+}
+
+FaceBvh::FaceBvh(const GeometryMesh &mesh, const BvhOptions &options) {
+  int num_faces = static_cast<int>(mesh.numFaces());
+  if (num_faces == 0) return;
+  std::vector<BuildPrimitive> primitives(num_faces);
+  std::vector<BvhTriangle> face_triangles(num_faces);
+  mystl::parallel_for(0, num_faces, [&](int i) {
+    auto h = mesh.face(i)->halfEdge();
+    auto &triangle = face_triangles[i];
+    triangle = {mesh.pos(h->tail), mesh.pos(h->tip), mesh.pos(h->next->tip), i};
+    auto &primitive = primitives[i];
+    primitive.bounds.grow(triangle.v0);
+    primitive.bounds.grow(triangle.v1);
+    primitive.bounds.grow(triangle.v2);
+    primitive.centroid = (primitive.bounds.lo + primitive.bounds.hi) * 0.5f;
+    primitive.face = i;
+  }, options.num_threads);
+  std::vector<BvhNode> slots(2 * num_faces - 1);
+  {
+    mystl::ThreadPool pool(options.num_threads);
+    auto build_options = options;
+    build_options.num_bins = std::clamp(options.num_bins, 2, kMaxBins);
+    BvhBuilder builder{primitives, slots, build_options, pool};
+    pool.submit([&] { builder.build(0, 0, num_faces, 0); });
+    pool.wait();
+  }
+  // Depth-first order drops the unused slots and puts every left child right after its parent.
+  nodes.reserve(slots.size());
+  auto emit = [&](auto &&self, uint32_t slot) -> uint32_t {
+    auto i = static_cast<uint32_t>(nodes.size());
+    nodes.push_back(slots[slot]);
+    if (!slots[slot].count) {
+      self(self, slot + 1);
+      nodes[i].index = self(self, slots[slot].index);
+    }
+    return i;
+  };
+  emit(emit, 0);
+  nodes.shrink_to_fit();
+  triangles.resize(num_faces);
+  mystl::parallel_for(0, num_faces, [&](int i) {
+    triangles[i] = face_triangles[primitives[i].face];
+  }, options.num_threads);
+}
+
+std::optional<RayHit> FaceBvh::intersect(const Ray &ray) const {
+  std::optional<RayHit> closest;
+  auto clipped = ray;
+  traverse(nodes, ray, [&](const BvhNode &leaf, float &t_max) {
+    for (uint32_t k = leaf.index; k < leaf.index + leaf.count; k++) {
+      if (auto hit = intersectTriangle(triangles[k], clipped)) {
+        t_max = clipped.t_max = hit->t;
+        closest = hit;
+      }
+    }
+    return true;
+  });
+  return closest;
+}
+
+bool FaceBvh::occluded(const Ray &ray) const {
+  bool hit = false;
+  traverse(nodes, ray, [&](const BvhNode &leaf, float &) {
+    for (uint32_t k = leaf.index; k < leaf.index + leaf.count && !hit; k++)
+      hit = intersectTriangle(triangles[k], ray).has_value();
+    return !hit;
+  });
+  return hit;
+}
+
+std::optional<ClosestPoint> FaceBvh::closestPoint(const glm::vec3 &p, float max_distance) const {
+  if (nodes.empty()) return std::nullopt;
+  std::optional<ClosestPoint> closest;
+  float best = max_distance * max_distance;
+  std::array<std::pair<uint32_t, float>, kMaxDepth> stack;
+  int stack_size = 0;
+  uint32_t i = 0;
+  if (squaredDistanceToBox(nodes[0], p) > best) return std::nullopt;
+  while (true) {
+    const auto &node = nodes[i];
+    if (node.count) {
+      for (uint32_t k = node.index; k < node.index + node.count; k++) {
+        auto q = closestPointOnTriangle(triangles[k], p);
+        float d = glm::dot(q - p, q - p);
+        if (d <= best && (!closest || d < best)) {
+          best = d;
+          closest = ClosestPoint{q, 0.0f, triangles[k].face};
+        }
+      }
+    } else {
+      uint32_t closer = i + 1, farther = node.index;
+      float d_closer = squaredDistanceToBox(nodes[closer], p);
+      float d_farther = squaredDistanceToBox(nodes[farther], p);
+      if (d_farther < d_closer) {
+        std::swap(closer, farther);
+        std::swap(d_closer, d_farther);
+      }
+      if (d_closer <= best) {
+        if (d_farther <= best) stack[stack_size++] = {farther, d_farther};
+        i = closer;
+        continue;
+      }
+    }
+    do {
+      if (stack_size == 0) {
+        if (closest) closest->distance = std::sqrt(best);
+        return closest;
+      }
+      i = stack[--stack_size].first;
+    } while (stack[stack_size].second > best);
+  }
+}
+
+float FaceBvh::sahCost() const {
+  if (nodes.empty()) return 0.0f;
+  auto area = [](const BvhNode &node) {
+    return Aabb{node.lo, node.hi}.area();
+  };
+  double cost = 0.0;
+  for (const auto &node : nodes)
+    cost += static_cast<double>(area(node)) * (node.count ? node.count : 1);
+  return static_cast<float>(cost / area(nodes[0]));
+}
+}
@@ -0,0 +1,212 @@
+//
+// Created by creeper on 10/16/26.
+//
+#include <meshark/connected-components.h>
+#include <mystl/parallel-for.h>
+#include <algorithm>
+#include <atomic>
+#include <iostream>
+
+namespace meshark {
+
+namespace {
+// Roots are linked below smaller roots and paths are halved towards them, so parent[x] <= x only ever
+// decreases and every value read, however stale, is an ancestor of x. That is why relaxed atomics are
+// enough and the root of a set is always its smallest element.
+int findRoot(std::vector<int> &parent, int x) {
+  while (true) {
+    int p = std::atomic_ref(parent[x]).load(std::memory_order_relaxed);
+    if (p == x) return x;
+    int grandparent = std::atomic_ref(parent[p]).load(std::memory_order_relaxed);
+    if (grandparent != p)
+      std::atomic_ref(parent[x]).compare_exchange_weak(p, grandparent, std::memory_order_relaxed);
+    x = grandparent;
+  }
+}
+
+void unite(std::vector<int> &parent, int a, int b) {
+  while (true) {
+    a = findRoot(parent, a);
+    b = findRoot(parent, b);
+    if (a == b) return;
+    if (a < b) std::swap(a, b);
+    // Fails if a stopped being a root in the meantime.
+    int expected = a;
+    if (std::atomic_ref(parent[a]).compare_exchange_strong(expected, b, std::memory_order_relaxed)) return;
+  }
+}
+
+// Stable counting sort of [0, keys.size()) by key, offsets receiving the start of every key.
+std::vector<int> sortByKey(const std::vector<int> &keys, int num_keys, std::vector<int> &offsets) {
+  offsets.assign(num_keys + 1, 0);
+  for (int key : keys)
+    if (key >= 0) offsets[key + 1]++;
+  for (int k = 0; k < num_keys; k++)
+    offsets[k + 1] += offsets[k];
+  std::vector<int> sorted(offsets[num_keys]);
+  std::vector<int> next(offsets.begin(), offsets.end() - 1);
+  for (int i = 0; i < static_cast<int>(keys.size()); i++)
+    if (keys[i] >= 0) sorted[next[keys[i]]++] = i;
+  return sorted;
+}
+}
+
+FaceComponents findConnectedComponents(const GeometryMesh &mesh, int num_threads) {
+  int num_faces = static_cast<int>(mesh.numFaces());
+  std::vector<int> parent(num_faces);
+  mystl::parallel_for(0, num_faces, [&](int f) {
+    parent[f] = f;
+  }, num_threads, 4096);
+  // Every interior edge once, from the face with the larger index.
+  mystl::parallel_for(0, num_faces, [&](int f) {
+    auto start = mesh.face(f)->halfEdge();
+    auto h = start;
+    do {
+      if (h->twin) {
+        int g = mesh.index(h->twin->face);
+        if (g < f) unite(parent, f, g);
+      }
+      h = h->next;
+    } while (h != start);
+  }, num_threads, 1024);
+  FaceComponents components;
+  components.labels.resize(num_faces);
+  mystl::parallel_for(0, num_faces, [&](int f) {
+    components.labels[f] = findRoot(parent, f);
+  }, num_threads, 4096);
+  // Roots are the first faces of their components.
+  for (int f = 0; f < num_faces; f++) {
+    int root = components.labels[f];
+    if (root == f) {
+      parent[f] = components.numComponents();
+      components.sizes.push_back(0);
+    }
+    components.labels[f] = parent[root];
+    components.sizes[parent[root]]++;
+  }
+  return components;
+}
+
+std::vector<std::unique_ptr<GeometryMesh>> splitComponents(const GeometryMesh &mesh, const FaceComponents &components,
+                                                           int min_faces, int num_threads) {
+  if (mesh.numHalfEdges() != 3 * mesh.numFaces()) {
+    std::cerr << "Splitting into components needs a triangle mesh" << std::endl;
+    return {};
+  }
+  int num_components = components.numComponents();
+  int num_faces = static_cast<int>(mesh.numFaces());
+  int num_vertices = static_cast<int>(mesh.numVertices());
+  const auto &labels = components.labels;
+  // Faces, edges and vertices of every component, in their order in mesh. Faces keep their first half-edge,
+  // so half-edge k of the i-th face of a component becomes half-edge 3 i + k of its mesh.
+  std::vector<int> face_offsets;
+  auto faces = sortByKey(labels, num_components, face_offsets);
+  std::vector<int> half_edge_codes(mesh.numHalfEdges());
+  mystl::parallel_for(0, num_faces, [&](int i) {
+    int c = labels[faces[i]];
+    auto h = mesh.face(faces[i])->halfEdge();
+    for (int k = 0; k < 3; k++, h = h->next)
+      half_edge_codes[mesh.index(h)] = 3 * (i - face_offsets[c]) + k;
+  }, num_threads, 1024);
+  std::vector<int> edge_labels(mesh.numEdges());
+  mystl::parallel_for(0, static_cast<int>(mesh.numEdges()), [&](int e) {
+    edge_labels[e] = labels[mesh.index(mesh.edge(e)->halfEdge()->face)];
+  }, num_threads, 4096);
+  std::vector<int> edge_offsets;
+  auto edges = sortByKey(edge_labels, num_components, edge_offsets);
+  std::vector<int> local_edges(mesh.numEdges());
+  for (int i = 0; i < static_cast<int>(edges.size()); i++)
+    local_edges[edges[i]] = i - edge_offsets[edge_labels[edges[i]]];
+  // Component of every vertex, -1 if it has no face and -2 if it is shared by several components.
+  std::vector<int> vertex_labels(num_vertices, -1);
+  mystl::parallel_for(0, num_faces, [&](int f) {
+    auto h = mesh.face(f)->halfEdge();
+    for (int k = 0; k < 3; k++, h = h->next) {
+      int expected = -1;
+      std::atomic_ref label(vertex_labels[mesh.index(h->tail)]);
+      if (!label.compare_exchange_strong(expected, labels[f], std::memory_order_relaxed) && expected != labels[f])
+        label.store(-2, std::memory_order_relaxed);
+    }
+  }, num_threads, 1024);
+  std::vector<int> vertex_offsets;
+  auto vertices = sortByKey(vertex_labels, num_components, vertex_offsets);
+  std::vector<int> local_vertices(num_vertices, -1);
+  for (int i = 0; i < static_cast<int>(vertices.size()); i++)
+    local_vertices[vertices[i]] = i - vertex_offsets[vertex_labels[vertices[i]]];
+
+  auto build = [&](int c, int threads) {
+    int component_faces = face_offsets[c + 1] - face_offsets[c];
+    // Shared vertices come after the others, in the order of their indices.
+    std::vector<int> shared;
+    for (int i = face_offsets[c]; i < face_offsets[c + 1]; i++) {
+      auto h = mesh.face(faces[i])->halfEdge();
+      for (int k = 0; k < 3; k++, h = h->next)
+        if (vertex_labels[mesh.index(h->tail)] == -2) shared.push_back(mesh.index(h->tail));
+    }
+    std::ranges::sort(shared);
+    shared.erase(std::unique(shared.begin(), shared.end()), shared.end());
+    int num_owned = vertex_offsets[c + 1] - vertex_offsets[c];
+    auto localVertex = [&](Vertex v) {
+      int i = mesh.index(v);
+      if (vertex_labels[i] != -2) return local_vertices[i];
+      return num_owned + static_cast<int>(std::ranges::lower_bound(shared, i) - shared.begin());
+    };
+    auto out = std::make_unique<GeometryMesh>();
+    int num_edges = edge_offsets[c + 1] - edge_offsets[c];
+    out->allocateElements(num_owned + static_cast<int>(shared.size()), num_edges, component_faces,
+                          3 * component_faces, threads);
+    mystl::parallel_for(0, component_faces, [&](int i) {
+      auto h = mesh.face(faces[face_offsets[c] + i])->halfEdge();
+      for (int k = 0; k < 3; k++, h = h->next) {
+        auto x = out->halfEdge(3 * i + k);
+        x->tail = out->vertex(localVertex(h->tail));
+        x->tip = out->vertex(localVertex(h->tip));
+        x->next = out->halfEdge(3 * i + (k + 1) % 3);
+        x->twin = h->twin ? out->halfEdge(half_edge_codes[mesh.index(h->twin)]) : HalfEdge();
+        x->face = out->face(i);
+        x->edge = out->edge(local_edges[mesh.index(h->edge)]);
+      }
+      out->face(i)->halfEdge() = out->halfEdge(3 * i);
+    }, threads, 1024);
+    mystl::parallel_for(0, num_edges, [&](int i) {
+      auto h = mesh.edge(edges[edge_offsets[c] + i])->halfEdge();
+      out->edge(i)->halfEdge() = out->halfEdge(half_edge_codes[mesh.index(h)]);
+    }, threads, 4096);
+    // Vertices keep their half-edge, which is in the component unless the vertex is shared.
+    std::vector<glm::vec3> positions(out->numVertices());
+    mystl::parallel_for(0, num_owned, [&](int i) {
+      auto v = mesh.vertex(vertices[vertex_offsets[c] + i]);
+      out->vertex(i)->halfEdge() = out->halfEdge(half_edge_codes[mesh.index(v->halfEdge())]);
+      positions[i] = mesh.pos(v);
+    }, threads, 4096);
+    for (size_t i = 0; i < shared.size(); i++)
+      positions[num_owned + i] = mesh.pos(mesh.vertex(shared[i]));
+    if (!shared.empty()) {
+      for (int i = 0; i < component_faces; i++) {
+        auto h = mesh.face(faces[face_offsets[c] + i])->halfEdge();
+        for (int k = 0; k < 3; k++, h = h->next)
+          if (vertex_labels[mesh.index(h->tail)] == -2) {
+            auto x = out->halfEdge(3 * i + k);
+            x->tail->halfEdge() = x;
+          }
+      }
+    }
+    out->setVertexPositions(positions, threads);
+    return out;
+  };
+  // Allocating the elements dominates, so large components get all threads and the others one each.
+  constexpr int kLargeComponentFaces = 1 << 16;
+  std::vector<std::unique_ptr<GeometryMesh>> meshes(num_components);
+  std::vector<int> small;
+  for (int c = 0; c < num_components; c++) {
+    int component_faces = face_offsets[c + 1] - face_offsets[c];
+    if (component_faces < min_faces) continue;
+    if (component_faces >= kLargeComponentFaces) meshes[c] = build(c, num_threads);
+    else small.push_back(c);
+  }
+  mystl::parallel_for(0, static_cast<int>(small.size()), [&](int i) {
+    meshes[small[i]] = build(small[i], 1);
+  }, num_threads, 1);
+  return meshes;
+}
+}
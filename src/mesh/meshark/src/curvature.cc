@@ -0,0 +1,152 @@
+//
+// Created by creeper on 10/16/26.
+//
+#include <meshark/curvature.h>
+#include <mystl/parallel-for.h>
+#include <cmath>
+#include <iostream>
+#include <numbers>
+#include <vector>
+
+namespace meshark {
+
+namespace {
+// Area of the triangle (p, q, r) that belongs to p in the mixed Voronoi region: the Voronoi part for a
+// non-obtuse triangle, otherwise half or a quarter of the triangle depending on where the obtuse angle is.
+float mixedArea(const glm::vec3 &pq, const glm::vec3 &pr, float double_area, float cot_p, float cot_q, float cot_r) {
+  if (cot_p < 0.0f) return double_area * 0.25f;
+  if (cot_q < 0.0f || cot_r < 0.0f) return double_area * 0.125f;
+  return (glm::dot(pr, pr) * cot_q + glm::dot(pq, pq) * cot_r) * 0.125f;
+}
+}
+
+std::optional<VertexCurvatures> computeCurvatures(const GeometryMesh &mesh, int num_threads) {
+  bool closed = mesh.numHalfEdges() == 3 * mesh.numFaces();
+  for (auto h : mesh.halfEdges())
+    closed = closed && h->twin;
+  if (!closed) {
+    std::cerr << "Curvatures need a closed triangle mesh" << std::endl;
+    return std::nullopt;
+  }
+  int n = static_cast<int>(mesh.numVertices());
+  int num_faces = static_cast<int>(mesh.numFaces());
+  // Chasing the half-edges of every one-ring costs far more than the arithmetic, so the rings are read
+  // from a table of face corners and a copy of the positions, both gathered in memory order.
+  std::vector<glm::vec3> positions(n);
+  mystl::parallel_for(0, n, [&](int i) {
+    positions[i] = mesh.pos(mesh.vertex(i));
+  }, num_threads, 4096);
+  std::vector<int> corner_vertices(3 * num_faces);
+  mystl::parallel_for(0, num_faces, [&](int f) {
+    auto h = mesh.face(f)->halfEdge();
+    for (int k = 0; k < 3; k++, h = h->next)
+      corner_vertices[3 * f + k] = mesh.index(h->tail);
+  }, num_threads, 1024);
+  // Corners around every vertex, in increasing order.
+  std::vector<int> corner_offsets(n + 1);
+  for (int v : corner_vertices)
+    corner_offsets[v + 1]++;
+  for (int i = 0; i < n; i++)
+    corner_offsets[i + 1] += corner_offsets[i];
+  std::vector<int> vertex_corners(3 * num_faces);
+  std::vector<int> next(corner_offsets.begin(), corner_offsets.end() - 1);
+  for (int c = 0; c < 3 * num_faces; c++)
+    vertex_corners[next[corner_vertices[c]]++] = c;
+
+  VertexCurvatures curvatures{VertexData<float>(n), VertexData<float>(n), VertexData<float>(n),
+                              VertexData<float>(n), VertexData<glm::vec3>(n), VertexData<glm::vec3>(n)};
+  mystl::parallel_for(0, n, [&](int i) {
+    auto v = mesh.vertex(i);
+    // A vertex without faces has no ring to estimate anything from.
+    if (corner_offsets[i] == corner_offsets[i + 1]) {
+      curvatures.mean(v) = curvatures.gaussian(v) = 0.0f;
+      curvatures.max_curvature(v) = curvatures.min_curvature(v) = 0.0f;
+      curvatures.max_direction(v) = curvatures.min_direction(v) = glm::vec3(0.0f);
+      return;
+    }
+    auto p = positions[i];
+    float area = 0.0f;
+    float angle_sum = 0.0f;
+    // Twice the mean curvature normal times the area, and the area-weighted normal.
+    glm::vec3 laplacian(0.0f);
+    glm::vec3 normal(0.0f);
+    // The face of corner c is (p, q, r), with q at the next corner.
+    auto ring = [&](int c, glm::vec3 &q, glm::vec3 &r) {
+      int first = c - c % 3;
+      q = positions[corner_vertices[first + (c + 1) % 3]];
+      r = positions[corner_vertices[first + (c + 2) % 3]];
+    };
+    for (int k = corner_offsets[i]; k < corner_offsets[i + 1]; k++) {
+      glm::vec3 q, r;
+      ring(vertex_corners[k], q, r);
+      auto pq = q - p;
+      auto pr = r - p;
+      auto qr = r - q;
+      // The cross product at every corner is the same, twice the area times the face normal.
+      auto cross = glm::cross(pq, pr);
+      float double_area = glm::length(cross);
+      if (double_area == 0.0f) continue;
+      float cot_p = glm::dot(pq, pr) / double_area;
+      float cot_q = -glm::dot(pq, qr) / double_area;
+      float cot_r = glm::dot(pr, qr) / double_area;
+      area += mixedArea(pq, pr, double_area, cot_p, cot_q, cot_r);
+      angle_sum += std::atan2(double_area, glm::dot(pq, pr));
+      laplacian -= cot_r * pq + cot_q * pr;
+      normal += cross;
+    }
+    float normal_length = glm::length(normal);
+    normal = normal_length > 0.0f ? normal / normal_length : glm::vec3(0.0f);
+    float mean = area > 0.0f ? 0.25f * glm::length(laplacian) / area : 0.0f;
+    if (glm::dot(laplacian, normal) < 0.0f) mean = -mean;
+    float gaussian = area > 0.0f ? (2.0f * std::numbers::pi_v<float> - angle_sum) / area : 0.0f;
+    float deviation = std::sqrt(std::max(mean * mean - gaussian, 0.0f));
+
+    // Least-squares fit of k(x, y) = a x^2 + 2 b xy + c y^2 in a tangent basis (u, w) to the normal
+    // curvatures 2 n.(p - q) / |q - p|^2 towards the neighbours, through its 3x3 normal equations.
+    glm::vec3 first, unused;
+    ring(vertex_corners[corner_offsets[i]], first, unused);
+    auto u = first - p - normal * glm::dot(first - p, normal);
+    float u_length = glm::length(u);
+    u = u_length > 0.0f ? u / u_length : glm::vec3(0.0f);
+    auto w = glm::cross(normal, u);
+    float m00 = 0.0f, m01 = 0.0f, m02 = 0.0f, m11 = 0.0f, m12 = 0.0f, m22 = 0.0f;
+    float r0 = 0.0f, r1 = 0.0f, r2 = 0.0f;
+    // Every neighbour is the next corner of exactly one corner of p.
+    for (int k = corner_offsets[i]; k < corner_offsets[i + 1]; k++) {
+      glm::vec3 q, r;
+      ring(vertex_corners[k], q, r);
+      auto e = q - p;
+      float squared_length = glm::dot(e, e);
+      if (squared_length == 0.0f) continue;
+      float curvature = -2.0f * glm::dot(normal, e) / squared_length;
+      float x = glm::dot(e, u);
+      float y = glm::dot(e, w);
+      float tangent_length = x * x + y * y;
+      if (tangent_length == 0.0f) continue;
+      float xx = x * x / tangent_length, xy = 2.0f * x * y / tangent_length, yy = y * y / tangent_length;
+      m00 += xx * xx, m01 += xx * xy, m02 += xx * yy;
+      m11 += xy * xy, m12 += xy * yy, m22 += yy * yy;
+      r0 += xx * curvature, r1 += xy * curvature, r2 += yy * curvature;
+    }
+    float c00 = m11 * m22 - m12 * m12, c01 = m02 * m12 - m01 * m22, c02 = m01 * m12 - m02 * m11;
+    float determinant = m00 * c00 + m01 * c01 + m02 * c02;
+    float angle = 0.0f;
+    if (std::abs(determinant) > 1e-12f) {
+      // Cramer's rule.
+      float a = (r0 * c00 + r1 * c01 + r2 * c02) / determinant;
+      float b = (m00 * (r1 * m22 - m12 * r2) - r0 * (m01 * m22 - m12 * m02) + m02 * (m01 * r2 - r1 * m02)) / determinant;
+      float c = (m00 * (m11 * r2 - r1 * m12) - m01 * (m01 * r2 - r1 * m02) + r0 * (m01 * m12 - m11 * m02)) / determinant;
+      // Eigenvector of [[a, b], [b, c]] with the larger eigenvalue.
+      angle = 0.5f * std::atan2(2.0f * b, a - c);
+    }
+    auto max_direction = std::cos(angle) * u + std::sin(angle) * w;
+    curvatures.mean(v) = mean;
+    curvatures.gaussian(v) = gaussian;
+    curvatures.max_curvature(v) = mean + deviation;
+    curvatures.min_curvature(v) = mean - deviation;
+    curvatures.max_direction(v) = max_direction;
+    curvatures.min_direction(v) = glm::cross(normal, max_direction);
+  }, num_threads, 1024);
+  return curvatures;
+}
+}
@@ -3,13 +3,40 @@
 //
 #include <meshark/geometry-mesh.h>
 #include <meshark/mesh-io.h>
+#include <mystl/parallel-for.h>
+#include <mystl/thread-pool.h>
+#include <bit>
+#include <cmath>
 #include <iostream>
 #include <fstream>
 #include <map>
+#include <numeric>
 #include <format>
 
 namespace meshark {
 
+namespace {
+// Indices of the set bits, in increasing order; the bits are cleared.
+std::vector<int> takeSetBits(std::vector<uint64_t> &bits) {
+  std::vector<int> indices;
+  for (size_t w = 0; w < bits.size(); w++) {
+    for (uint64_t word = bits[w]; word; word &= word - 1)
+      indices.push_back(static_cast<int>(w * 64 + std::countr_zero(word)));
+    bits[w] = 0;
+  }
+  return indices;
+}
+
+// parallel_for on pool when there is one, otherwise on num_threads threads of its own.
+template<typename Func>
+void parallelFor(mystl::ThreadPool *pool, int n, Func &&func, int num_threads, int grain_size) {
+  if (pool)
+    mystl::parallel_for(*pool, 0, n, func, grain_size);
+  else
+    mystl::parallel_for(0, n, func, num_threads, grain_size);
+}
+}
+
 void GeometryMesh::buildFromWavefrontObj(const WavefrontObj &obj) {
   for (auto v : obj.positions)
     createVertex(v);
@@ -51,15 +78,247 @@ void GeometryMesh::buildFromWavefrontObj(const WavefrontObj &obj) {
   }
 }
 
-void GeometryMesh::writeWavefrontObj(const std::filesystem::path &path) const {
+void GeometryMesh::setDeferredNormals(bool deferred) {
+  if (deferred == deferred_normals) return;
+  if (deferred) {
+    dirty_normals.assign((numFaces() + 63) / 64, 0);
+  } else {
+    flushNormals();
+    dirty_normals.clear();
+  }
+  deferred_normals = deferred;
+}
+
+void GeometryMesh::flushNormals(int num_threads) {
+  if (vertex_normal_weighting) flushVertexNormals(num_threads);
+  if (!deferred_normals) return;
+  updateFaceNormals(takeSetBits(dirty_normals), num_threads);
+}
+
+void GeometryMesh::flushNormals(mystl::ThreadPool &pool) {
+  if (vertex_normal_weighting) flushVertexNormals(0, &pool);
+  if (!deferred_normals) return;
+  updateFaceNormals(takeSetBits(dirty_normals), 0, &pool);
+}
+
+void GeometryMesh::setVertexPositions(const std::vector<glm::vec3> &positions, int num_threads) {
+  assert(positions.size() == numVertices());
+  int num_vertices = static_cast<int>(numVertices());
+  mystl::parallel_for(0, num_vertices, [&](int i) {
+    position(vertex(i)) = positions[i];
+  }, num_threads, 4096);
+  std::vector<int> faces(numFaces());
+  std::iota(faces.begin(), faces.end(), 0);
+  updateFaceNormals(faces, num_threads);
+  if (deferred_normals) std::fill(dirty_normals.begin(), dirty_normals.end(), 0);
+  if (vertex_normal_weighting) enableVertexNormals(*vertex_normal_weighting, num_threads);
+}
+
+Vertex GeometryMesh::splitEdge(Edge e, const glm::vec3 &pos) {
+  // e runs from a to b between the triangles (a, b, c) and (b, a, d), which become (a, m, c), (m, b, c),
+  // (b, m, d) and (m, a, d).
+  auto h = e->halfEdge();
+  auto t = h->twin;
+  auto h1 = h->next;
+  auto h2 = h1->next;
+  auto t1 = t->next;
+  auto t2 = t1->next;
+  auto a = h->tail;
+  auto b = h->tip;
+  auto c = h2->tail;
+  auto d = t2->tail;
+  auto fh = h->face;
+  auto ft = t->face;
+  auto m = createVertex(pos);
+  auto g1 = createFace(glm::vec3());
+  auto g2 = createFace(glm::vec3());
+  auto e1 = createEdge();
+  auto e2 = createEdge();
+  auto e3 = createEdge();
+  std::array<HalfEdge, 6> n{};
+  for (auto &x : n)
+    x = createHalfEdge();
+  auto wire = [](HalfEdge x, Vertex tail, Vertex tip, HalfEdge next, HalfEdge twin, Face f, Edge edge) {
+    x->tail = tail;
+    x->tip = tip;
+    x->next = next;
+    x->twin = twin;
+    x->face = f;
+    x->edge = edge;
+  };
+  wire(h, a, m, n[0], n[4], fh, e);
+  wire(n[0], m, c, h2, n[2], fh, e2);
+  wire(n[1], m, b, h1, t, g1, e1);
+  wire(h1, b, c, n[2], h1->twin, g1, h1->edge);
+  wire(n[2], c, m, n[1], n[0], g1, e2);
+  wire(t, b, m, n[3], n[1], ft, e1);
+  wire(n[3], m, d, t2, n[5], ft, e3);
+  wire(n[4], m, a, t1, h, g2, e);
+  wire(t1, a, d, n[5], t1->twin, g2, t1->edge);
+  wire(n[5], d, m, n[4], n[3], g2, e3);
+  e->halfEdge() = h;
+  e1->halfEdge() = t;
+  e2->halfEdge() = n[0];
+  e3->halfEdge() = n[3];
+  fh->halfEdge() = h;
+  ft->halfEdge() = t;
+  g1->halfEdge() = n[1];
+  g2->halfEdge() = n[4];
+  m->halfEdge() = n[1];
+  // Every changed face is around m, every changed vertex normal is m's or a neighbour's.
+  setVertexPos(m, pos);
+  return m;
+}
+
+void GeometryMesh::flipEdge(Edge e) {
+  rewireEdgeFlip(e);
+  auto h = e->halfEdge();
+  for (auto f : {h->face, h->twin->face}) {
+    if (deferred_normals)
+      markNormalDirty(f);
+    else
+      normals(f) = computeFaceNormal(f);
+  }
+  if (!vertex_normal_weighting) return;
+  for (auto v : {h->tail, h->tip, h->next->tip, h->twin->next->tip}) {
+    if (deferred_normals)
+      setBit(dirty_vertex_normals, index(v));
+    else
+      updateVertexNormal(v);
+  }
+}
+
+void GeometryMesh::updateFaceNormals(const std::vector<int> &dirty, int num_threads, mystl::ThreadPool *pool) {
+  // Blocks of faces are gathered into structure-of-arrays form, so that the cross products and
+  // normalizations vectorize. The operations are those of computeFaceNormal, in the same order, so
+  // the results are bit-identical to eager updates.
+  constexpr int kBlock = 256;
+  int num_blocks = static_cast<int>((dirty.size() + kBlock - 1) / kBlock);
+  parallelFor(pool, num_blocks, [&](int b) {
+    int begin = b * kBlock;
+    int n = std::min(kBlock, static_cast<int>(dirty.size()) - begin);
+    float e1x[kBlock], e1y[kBlock], e1z[kBlock], e2x[kBlock], e2y[kBlock], e2z[kBlock];
+    float nx[kBlock], ny[kBlock], nz[kBlock];
+    for (int k = 0; k < n; k++) {
+      auto h = face(dirty[begin + k])->halfEdge();
+      auto v0 = pos(h->tail);
+      auto e1 = pos(h->tip) - v0;
+      auto e2 = pos(h->next->tip) - v0;
+      e1x[k] = e1.x, e1y[k] = e1.y, e1z[k] = e1.z;
+      e2x[k] = e2.x, e2y[k] = e2.y, e2z[k] = e2.z;
+    }
+    for (int k = 0; k < n; k++) {
+      float cx = e1y[k] * e2z[k] - e2y[k] * e1z[k];
+      float cy = e1z[k] * e2x[k] - e2z[k] * e1x[k];
+      float cz = e1x[k] * e2y[k] - e2x[k] * e1y[k];
+      float inv_length = 1.0f / std::sqrt(cx * cx + cy * cy + cz * cz);
+      nx[k] = cx * inv_length;
+      ny[k] = cy * inv_length;
+      nz[k] = cz * inv_length;
+    }
+    for (int k = 0; k < n; k++)
+      normals(face(dirty[begin + k])) = {nx[k], ny[k], nz[k]};
+  }, num_threads, 4);
+}
+
+glm::vec3 GeometryMesh::computeVertexNormal(Vertex v, VertexNormalWeighting weighting) const {
+  auto p = pos(v);
+  glm::vec3 sum{};
+  for (auto h : v->outgoingHalfEdges()) {
+    auto e1 = pos(h->tip) - p;
+    auto e2 = pos(h->next->tip) - p;
+    // Twice the area times the face normal.
+    auto c = glm::cross(e1, e2);
+    if (weighting == VertexNormalWeighting::kAngle) {
+      float length = glm::length(c);
+      c *= length > 0.0f ? std::atan2(length, glm::dot(e1, e2)) / length : 0.0f;
+    }
+    sum += c;
+  }
+  float length = glm::length(sum);
+  return length > 0.0f ? sum / length : glm::vec3(0.0f);
+}
+
+void GeometryMesh::enableVertexNormals(VertexNormalWeighting weighting, int num_threads) {
+  vertex_normal_weighting = weighting;
+  vertex_normals = VertexData<glm::vec3>(static_cast<int>(numVertices()));
+  dirty_vertex_normals.assign((numVertices() + 63) / 64, 0);
+  // Walking the fans of all vertices chases twice as many pointers as walking the faces in memory
+  // order, so the weighted face normals are first computed per corner, in blocks of faces gathered
+  // into structure-of-arrays form that vectorize like flushNormals. The vertices then only sum their
+  // corners, in the same order and with the same operations as computeVertexNormal.
+  std::vector<glm::vec3> corner_normals(numHalfEdges());
+  constexpr int kBlock = 256;
+  int num_faces = static_cast<int>(numFaces());
+  mystl::parallel_for(0, (num_faces + kBlock - 1) / kBlock, [&](int b) {
+    int begin = b * kBlock;
+    int n = std::min(kBlock, num_faces - begin);
+    float e1x[3 * kBlock], e1y[3 * kBlock], e1z[3 * kBlock], e2x[3 * kBlock], e2y[3 * kBlock], e2z[3 * kBlock];
+    float cx[3 * kBlock], cy[3 * kBlock], cz[3 * kBlock];
+    int corners[3 * kBlock];
+    for (int k = 0; k < n; k++) {
+      auto h = face(begin + k)->halfEdge();
+      std::array<HalfEdge, 3> hs{h, h->next, h->next->next};
+      std::array<glm::vec3, 3> p{pos(hs[0]->tail), pos(hs[1]->tail), pos(hs[2]->tail)};
+      for (int j = 0; j < 3; j++) {
+        int c = 3 * k + j;
+        auto e1 = p[(j + 1) % 3] - p[j];
+        auto e2 = p[(j + 2) % 3] - p[j];
+        e1x[c] = e1.x, e1y[c] = e1.y, e1z[c] = e1.z;
+        e2x[c] = e2.x, e2y[c] = e2.y, e2z[c] = e2.z;
+        corners[c] = index(hs[j]);
+      }
+    }
+    for (int c = 0; c < 3 * n; c++) {
+      cx[c] = e1y[c] * e2z[c] - e2y[c] * e1z[c];
+      cy[c] = e1z[c] * e2x[c] - e2z[c] * e1x[c];
+      cz[c] = e1x[c] * e2y[c] - e2x[c] * e1y[c];
+    }
+    if (weighting == VertexNormalWeighting::kAngle) {
+      for (int c = 0; c < 3 * n; c++) {
+        glm::vec3 cross(cx[c], cy[c], cz[c]);
+        float length = glm::length(cross);
+        float dot = glm::dot(glm::vec3(e1x[c], e1y[c], e1z[c]), glm::vec3(e2x[c], e2y[c], e2z[c]));
+        float scale = length > 0.0f ? std::atan2(length, dot) / length : 0.0f;
+        cx[c] *= scale, cy[c] *= scale, cz[c] *= scale;
+      }
+    }
+    for (int c = 0; c < 3 * n; c++)
+      corner_normals[corners[c]] = {cx[c], cy[c], cz[c]};
+  }, num_threads, 4);
+  mystl::parallel_for(0, static_cast<int>(numVertices()), [&](int i) {
+    auto v = vertex(i);
+    glm::vec3 sum{};
+    for (auto h : v->outgoingHalfEdges())
+      sum += corner_normals[index(h)];
+    float length = glm::length(sum);
+    vertex_normals(v) = length > 0.0f ? sum / length : glm::vec3(0.0f);
+  }, num_threads, 1024);
+}
+
+void GeometryMesh::disableVertexNormals() {
+  vertex_normal_weighting.reset();
+  vertex_normals = {};
+  dirty_vertex_normals.clear();
+}
+
+void GeometryMesh::flushVertexNormals(int num_threads, mystl::ThreadPool *pool) {
+  auto dirty = takeSetBits(dirty_vertex_normals);
+  parallelFor(pool, static_cast<int>(dirty.size()), [&](int i) {
+    auto v = vertex(dirty[i]);
+    vertex_normals(v) = computeVertexNormal(v, *vertex_normal_weighting);
+  }, num_threads, 1024);
+}
+
+bool GeometryMesh::writeWavefrontObj(const std::filesystem::path &path) const {
   std::ofstream file(path);
   if (!file.is_open()) {
     std::cerr << "Failed to open file: " << path << std::endl;
-    return;
+    return false;
   }
   for (auto v : vertices()) {
     auto p = position(v);
-    file << std::format("v {} {} {}", p.x, p.y, p.z) << std::endl;
+    file << std::format("v {} {} {}\n", p.x, p.y, p.z);
   }
   for (auto f : faces()) {
     file << "f ";
@@ -70,5 +329,29 @@ void GeometryMesh::writeWavefrontObj(const std::filesystem::path &path) const {
     file << "\n";
   }
   file.close();
+  if (!file) {
+    std::cerr << "Failed to write file: " << path << std::endl;
+    return false;
+  }
+  return true;
+}
+
+std::unique_ptr<WavefrontObj> GeometryMesh::toWavefrontObj() const {
+  auto obj = std::make_unique<WavefrontObj>();
+  obj->positions.reserve(numVertices());
+  for (auto v : vertices())
+    obj->positions.push_back(position(v));
+  obj->face_splits.reserve(numFaces() + 1);
+  obj->face_vertices.reserve(3 * numFaces());
+  for (auto f : faces()) {
+    obj->face_splits.push_back(static_cast<int>(obj->face_vertices.size()));
+    for (auto h : f->boundaryHalfEdges()) {
+      WavefrontObj::FaceVertex fv;
+      fv.v = index(h->tail);
+      obj->face_vertices.push_back(fv);
+    }
+  }
+  obj->face_splits.push_back(static_cast<int>(obj->face_vertices.size()));
+  return obj;
 }
 }
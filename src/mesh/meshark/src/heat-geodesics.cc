@@ -0,0 +1,141 @@
+//
+// Created by creeper on 10/16/26.
+//
+#include <meshark/heat-geodesics.h>
+#include <meshark/laplacian.h>
+#include <mystl/parallel-for.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+
+namespace meshark {
+
+namespace {
+template<typename Func>
+double timeIt(Func &&func) {
+  auto start = std::chrono::steady_clock::now();
+  func();
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Relative shift of the diagonal that makes L definite. The right-hand side of the Poisson problem sums
+// to zero, so it barely moves the solution.
+constexpr double kPoissonShift = 1e-8;
+}
+
+std::unique_ptr<HeatGeodesics> buildHeatGeodesics(const GeometryMesh &mesh, const HeatGeodesicOptions &options) {
+  int num_threads = options.num_threads;
+  auto laplacian = buildLaplacian(mesh, LaplacianWeighting::kCotangent, num_threads);
+  if (laplacian.rows() != static_cast<int>(mesh.numVertices())) return nullptr;
+  int n = static_cast<int>(mesh.numVertices());
+  int num_faces = static_cast<int>(mesh.numFaces());
+  auto geodesics = std::make_unique<HeatGeodesics>();
+  geodesics->num_threads = num_threads;
+  geodesics->positions.resize(n);
+  mystl::parallel_for(0, n, [&](int i) {
+    geodesics->positions[i] = glm::dvec3(mesh.pos(mesh.vertex(i)));
+  }, num_threads, 4096);
+  const auto &positions = geodesics->positions;
+  geodesics->faces.resize(num_faces);
+  mystl::parallel_for(0, num_faces, [&](int f) {
+    auto &face = geodesics->faces[f];
+    auto h = mesh.face(f)->halfEdge();
+    for (int k = 0; k < 3; k++, h = h->next)
+      face.vertices[k] = mesh.index(h->tail);
+    for (int k = 0; k < 3; k++) {
+      auto u = positions[face.vertices[(k + 1) % 3]] - positions[face.vertices[k]];
+      auto v = positions[face.vertices[(k + 2) % 3]] - positions[face.vertices[k]];
+      double sine = glm::length(glm::cross(u, v));
+      face.cotangents[k] = sine > 0.0 ? glm::dot(u, v) / sine : 0.0;
+    }
+  }, num_threads, 1024);
+  geodesics->corner_offsets.assign(n + 1, 0);
+  for (const auto &face : geodesics->faces)
+    for (int v : face.vertices)
+      geodesics->corner_offsets[v + 1]++;
+  for (int i = 0; i < n; i++)
+    geodesics->corner_offsets[i + 1] += geodesics->corner_offsets[i];
+  geodesics->vertex_corners.resize(3 * num_faces);
+  std::vector<int> next(geodesics->corner_offsets.begin(), geodesics->corner_offsets.end() - 1);
+  for (int c = 0; c < 3 * num_faces; c++)
+    geodesics->vertex_corners[next[geodesics->faces[c / 3].vertices[c % 3]]++] = c;
+
+  double length_sum = 0.0;
+  for (auto e : mesh.edges()) {
+    auto h = e->halfEdge();
+    length_sum += glm::length(positions[mesh.index(h->tip)] - positions[mesh.index(h->tail)]);
+  }
+  double mean_length = mesh.numEdges() ? length_sum / static_cast<double>(mesh.numEdges()) : 0.0;
+  double time = options.time_scale * mean_length * mean_length;
+  auto mass = buildLumpedMass(mesh, num_threads);
+  CsrMatrix heat = laplacian;
+  mystl::parallel_for(0, n, [&](int i) {
+    for (int k = heat.row_offsets[i]; k < heat.row_offsets[i + 1]; k++) {
+      bool diagonal = heat.columns[k] == i;
+      heat.values[k] = heat.values[k] * time + (diagonal ? mass[i] : 0.0);
+      if (diagonal) laplacian.values[k] *= 1.0 + kPoissonShift;
+    }
+  }, num_threads, 4096);
+  geodesics->heat_factor = factorCholesky(heat);
+  geodesics->poisson_factor = factorCholesky(laplacian);
+  if (!geodesics->heat_factor || !geodesics->poisson_factor) return nullptr;
+  return geodesics;
+}
+
+std::optional<GeodesicDistances> HeatGeodesics::distances(const std::vector<int> &sources) const {
+  int n = static_cast<int>(positions.size());
+  if (sources.empty() || std::ranges::any_of(sources, [n](int s) { return s < 0 || s >= n; })) {
+    std::cerr << "Geodesic distances need a non-empty set of valid source vertices" << std::endl;
+    return std::nullopt;
+  }
+  GeodesicDistances result;
+  std::vector<double> u;
+  result.heat_seconds = timeIt([&] {
+    std::vector<double> b(n);
+    for (int s : sources)
+      b[s] = 1.0;
+    heat_factor->solve(b, u);
+  });
+  std::vector<double> divergence(n);
+  result.divergence_seconds = timeIt([&] {
+    // Integrated divergence of X = -grad u / |grad u| at every corner, then summed around the vertices.
+    int num_faces = static_cast<int>(faces.size());
+    std::vector<double> corners(3 * num_faces);
+    mystl::parallel_for(0, num_faces, [&](int f) {
+      const auto &face = faces[f];
+      std::array<glm::dvec3, 3> p;
+      for (int k = 0; k < 3; k++)
+        p[k] = positions[face.vertices[k]];
+      auto normal = glm::cross(p[1] - p[0], p[2] - p[0]);
+      glm::dvec3 gradient(0.0);
+      for (int k = 0; k < 3; k++)
+        gradient += u[face.vertices[k]] * glm::cross(normal, p[(k + 2) % 3] - p[(k + 1) % 3]);
+      double length = glm::length(gradient);
+      auto x = length > 0.0 ? -gradient / length : glm::dvec3(0.0);
+      for (int k = 0; k < 3; k++) {
+        auto e1 = p[(k + 1) % 3] - p[k];
+        auto e2 = p[(k + 2) % 3] - p[k];
+        corners[3 * f + k] = 0.5 * (face.cotangents[(k + 2) % 3] * glm::dot(e1, x) +
+                                    face.cotangents[(k + 1) % 3] * glm::dot(e2, x));
+      }
+    }, num_threads, 1024);
+    mystl::parallel_for(0, n, [&](int i) {
+      double sum = 0.0;
+      for (int k = corner_offsets[i]; k < corner_offsets[i + 1]; k++)
+        sum += corners[vertex_corners[k]];
+      // L is positive semidefinite, the negative of the cotangent Laplace operator.
+      divergence[i] = -sum;
+    }, num_threads, 4096);
+  });
+  result.poisson_seconds = timeIt([&] {
+    poisson_factor->solve(divergence, result.distances);
+    double shift = result.distances[sources.front()];
+    for (int s : sources)
+      shift = std::min(shift, result.distances[s]);
+    for (double &d : result.distances)
+      d -= shift;
+  });
+  return result;
+}
+}
@@ -0,0 +1,248 @@
+//
+// Created by creeper on 10/16/26.
+//
+#include <meshark/isotropic-remesher.h>
+#include <meshark/bvh.h>
+#include <mystl/parallel-for.h>
+#include <chrono>
+#include <algorithm>
+#include <iostream>
+#include <numeric>
+
+namespace meshark {
+
+namespace {
+template<typename Func>
+double timeIt(Func &&func) {
+  auto start = std::chrono::steady_clock::now();
+  func();
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+float squaredLength(const GeometryMesh &mesh, Edge e) {
+  auto h = e->halfEdge();
+  auto d = mesh.pos(h->tip) - mesh.pos(h->tail);
+  return glm::dot(d, d);
+}
+
+glm::vec3 midpoint(const GeometryMesh &mesh, Edge e) {
+  auto h = e->halfEdge();
+  return (mesh.pos(h->tail) + mesh.pos(h->tip)) * 0.5f;
+}
+
+// Passes over the edges until none is too long. Edges created by a split wait for the next pass:
+// splitting them right away keeps adding spokes to the same vertices and need not end.
+int splitLongEdges(GeometryMesh &mesh, float high) {
+  int splits = 0;
+  while (true) {
+    int pass_splits = 0;
+    int num_edges = static_cast<int>(mesh.numEdges());
+    for (int i = 0; i < num_edges; i++) {
+      auto e = mesh.edge(i);
+      if (squaredLength(mesh, e) <= high * high) continue;
+      mesh.splitEdge(e, midpoint(mesh, e));
+      pass_splits++;
+    }
+    if (pass_splits == 0) return splits;
+    splits += pass_splits;
+  }
+}
+
+// Collapsing to p must keep the mesh manifold, create no edge longer than high and flip no face.
+bool canCollapse(const GeometryMesh &mesh, Edge e, const glm::vec3 &p, float high) {
+  auto h = e->halfEdge();
+  for (auto v : {h->tail, h->tip}) {
+    for (auto o : v->outgoingHalfEdges()) {
+      auto d = mesh.pos(o->tip) - p;
+      if (glm::dot(d, d) > high * high) return false;
+      if (o->face == h->face || o->face == h->twin->face) continue;
+      auto n = glm::cross(mesh.pos(o->tip) - p, mesh.pos(o->next->tip) - p);
+      if (glm::dot(n, mesh.normal(o->face)) <= 0.0f) return false;
+    }
+  }
+  return mesh.isCollapsable(e);
+}
+
+void removeCollapsedElements(GeometryMesh &mesh, const EdgeCollapseRecord &record) {
+  for (auto e : record.removed_edges)
+    mesh.removeEdge(e);
+  mesh.removeVertex(record.removed_vertex);
+  for (auto f : record.removed_faces)
+    mesh.removeFace(f);
+  for (auto h : record.removed_half_edges)
+    mesh.removeHalfEdge(h);
+}
+
+int collapseShortEdges(GeometryMesh &mesh, float low, float high) {
+  int collapses = 0;
+  for (int i = 0; i < static_cast<int>(mesh.numEdges());) {
+    auto e = mesh.edge(i);
+    auto p = midpoint(mesh, e);
+    if (squaredLength(mesh, e) >= low * low || !canCollapse(mesh, e, p, high)) {
+      i++;
+      continue;
+    }
+    auto record = mesh.rewireEdgeCollapse(e);
+    removeCollapsedElements(mesh, record);
+    mesh.setVertexPos(record.kept_vertex, p);
+    collapses++;
+    // Another edge has been swapped into slot i.
+  }
+  return collapses;
+}
+
+// Squared deviation from valence 6 summed over the four vertices of the two triangles must drop, and
+// the new triangles must face the same side as the old ones.
+bool improvesValence(const GeometryMesh &mesh, Edge e, const std::vector<int> &valence) {
+  auto h = e->halfEdge();
+  auto a = h->tail;
+  auto b = h->tip;
+  auto c = h->next->tip;
+  auto d = h->twin->next->tip;
+  auto deviation = [&](Vertex v, int change) {
+    int x = valence[mesh.index(v)] + change - 6;
+    return x * x;
+  };
+  int before = deviation(a, 0) + deviation(b, 0) + deviation(c, 0) + deviation(d, 0);
+  int after = deviation(a, -1) + deviation(b, -1) + deviation(c, 1) + deviation(d, 1);
+  if (after >= before) return false;
+  auto n = mesh.normal(h->face) + mesh.normal(h->twin->face);
+  auto pa = mesh.pos(a), pb = mesh.pos(b), pc = mesh.pos(c), pd = mesh.pos(d);
+  if (glm::dot(glm::cross(pd - pa, pc - pa), n) <= 0.0f || glm::dot(glm::cross(pb - pd, pc - pd), n) <= 0.0f)
+    return false;
+  return mesh.isFlippable(e);
+}
+
+// Each round evaluates the candidate edges in parallel, picks improving flips with disjoint vertices in
+// edge order and applies them in parallel. Valences are exact for every flip of a batch, so every flip
+// lowers the total deviation and the rounds end. Only edges of the triangles around flipped vertices,
+// and improving ones that were blocked, are candidates again.
+int flipTowardsValence(GeometryMesh &mesh, int num_threads) {
+  int num_vertices = static_cast<int>(mesh.numVertices());
+  int num_edges = static_cast<int>(mesh.numEdges());
+  std::vector<int> valence(num_vertices);
+  mystl::parallel_for(0, num_vertices, [&](int i) {
+    valence[i] = mesh.vertex(i)->degree();
+  }, num_threads, 1024);
+  std::vector<int> candidates(num_edges);
+  std::iota(candidates.begin(), candidates.end(), 0);
+  std::vector<char> improves;
+  std::vector<char> locked(num_vertices);
+  std::vector<char> queued(num_edges);
+  std::vector<std::array<Vertex, 4>> batch;
+  std::vector<Edge> batch_edges;
+  int flips = 0;
+  while (!candidates.empty()) {
+    improves.resize(candidates.size());
+    mystl::parallel_for(0, static_cast<int>(candidates.size()), [&](int i) {
+      improves[i] = improvesValence(mesh, mesh.edge(candidates[i]), valence);
+    }, num_threads, 1024);
+    batch.clear();
+    batch_edges.clear();
+    std::vector<int> next;
+    auto enqueue = [&](Edge e) {
+      if (queued[mesh.index(e)]) return;
+      queued[mesh.index(e)] = 1;
+      next.push_back(mesh.index(e));
+    };
+    for (size_t i = 0; i < candidates.size(); i++) {
+      if (!improves[i]) continue;
+      auto e = mesh.edge(candidates[i]);
+      auto h = e->halfEdge();
+      std::array<Vertex, 4> vertices{h->tail, h->tip, h->next->tip, h->twin->next->tip};
+      if (std::ranges::any_of(vertices, [&](Vertex v) { return locked[mesh.index(v)]; })) {
+        enqueue(e);
+        continue;
+      }
+      for (auto v : vertices)
+        locked[mesh.index(v)] = 1;
+      batch.push_back(vertices);
+      batch_edges.push_back(e);
+    }
+    mystl::parallel_for(0, static_cast<int>(batch_edges.size()), [&](int i) {
+      mesh.flipEdge(batch_edges[i]);
+    }, num_threads, 256);
+    flips += static_cast<int>(batch.size());
+    for (const auto &[a, b, c, d] : batch) {
+      valence[mesh.index(a)]--;
+      valence[mesh.index(b)]--;
+      valence[mesh.index(c)]++;
+      valence[mesh.index(d)]++;
+      for (auto v : {a, b, c, d}) {
+        locked[mesh.index(v)] = 0;
+        for (auto h : v->outgoingHalfEdges()) {
+          enqueue(h->edge);
+          enqueue(h->next->edge);
+        }
+      }
+    }
+    std::ranges::sort(next);
+    for (int i : next)
+      queued[i] = 0;
+    candidates = std::move(next);
+  }
+  return flips;
+}
+
+// Jacobi update: every vertex moves in its tangent plane towards the centroid of its neighbours, from
+// the positions before the pass, then optionally onto the closest point of the input surface.
+void smoothTangentially(GeometryMesh &mesh, const FaceBvh *surface, int num_threads) {
+  int num_vertices = static_cast<int>(mesh.numVertices());
+  std::vector<glm::vec3> positions(num_vertices);
+  mystl::parallel_for(0, num_vertices, [&](int i) {
+    auto v = mesh.vertex(i);
+    auto p = mesh.pos(v);
+    glm::vec3 centroid(0.0f);
+    int n = 0;
+    for (auto h : v->outgoingHalfEdges()) {
+      centroid += mesh.pos(h->tip);
+      n++;
+    }
+    auto u = centroid / static_cast<float>(n) - p;
+    auto normal = mesh.normal(v);
+    auto q = p + u - normal * glm::dot(normal, u);
+    if (surface)
+      if (auto closest = surface->closestPoint(q)) q = closest->point;
+    positions[i] = q;
+  }, num_threads, 256);
+  mesh.setVertexPositions(positions, num_threads);
+}
+}
+
+std::optional<RemeshStats> remeshIsotropic(GeometryMesh &mesh, const RemeshOptions &options) {
+  bool closed = mesh.numHalfEdges() == 3 * mesh.numFaces();
+  for (auto h : mesh.halfEdges())
+    closed = closed && h->twin;
+  if (!closed) {
+    std::cerr << "Isotropic remeshing needs a closed triangle mesh" << std::endl;
+    return std::nullopt;
+  }
+  RemeshStats stats;
+  if (mesh.numEdges() == 0) return stats;
+  stats.target_edge_length = options.target_edge_length;
+  if (stats.target_edge_length <= 0.0f) {
+    double sum = 0.0;
+    for (auto e : mesh.edges())
+      sum += std::sqrt(squaredLength(mesh, e));
+    stats.target_edge_length = static_cast<float>(sum / static_cast<double>(mesh.numEdges()));
+  }
+  float low = stats.target_edge_length * 4.0f / 5.0f;
+  float high = stats.target_edge_length * 4.0f / 3.0f;
+  std::unique_ptr<FaceBvh> surface;
+  if (options.project) {
+    BvhOptions bvh_options;
+    bvh_options.num_threads = options.num_threads;
+    surface = std::make_unique<FaceBvh>(mesh, bvh_options);
+  }
+  for (int i = 0; i < options.num_iterations; i++) {
+    RemeshIterationStats iteration;
+    iteration.split_seconds = timeIt([&] { iteration.splits = splitLongEdges(mesh, high); });
+    iteration.collapse_seconds = timeIt([&] { iteration.collapses = collapseShortEdges(mesh, low, high); });
+    iteration.flip_seconds = timeIt([&] { iteration.flips = flipTowardsValence(mesh, options.num_threads); });
+    iteration.smooth_seconds = timeIt([&] { smoothTangentially(mesh, surface.get(), options.num_threads); });
+    iteration.num_faces = mesh.numFaces();
+    stats.iterations.push_back(iteration);
+  }
+  return stats;
+}
+}
@@ -0,0 +1,299 @@
+//
+// Created by creeper on 10/16/26.
+//
+#include <meshark/laplacian.h>
+#include <mystl/parallel-for.h>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <memory>
+
+namespace meshark {
+
+namespace {
+template<typename Func>
+double timeIt(Func &&func) {
+  auto start = std::chrono::steady_clock::now();
+  func();
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+bool isClosedTriangleMesh(const GeometryMesh &mesh) {
+  if (mesh.numHalfEdges() != 3 * mesh.numFaces()) return false;
+  for (auto h : mesh.halfEdges())
+    if (!h->twin) return false;
+  return true;
+}
+
+int nextCorner(int c) {
+  return c % 3 == 2 ? c - 2 : c + 1;
+}
+
+// Corner c = 3f + k is the tail of the k-th half-edge of face f. Gathered face by face, in memory
+// order, instead of walking the one-ring of every vertex.
+struct Corners {
+  std::vector<int> vertices;
+  // Corner of the twin of the half-edge leaving corner c.
+  std::vector<int> twins;
+  // Cotangent of the angle opposite the half-edge leaving corner c, if asked for.
+  std::vector<double> cotangents;
+};
+
+Corners gatherCorners(const GeometryMesh &mesh, bool cotangents, int num_threads) {
+  int num_faces = static_cast<int>(mesh.numFaces());
+  Corners corners;
+  corners.vertices.resize(3 * num_faces);
+  corners.twins.resize(3 * num_faces);
+  if (cotangents) corners.cotangents.resize(3 * num_faces);
+  std::vector<int> codes(mesh.numHalfEdges());
+  mystl::parallel_for(0, num_faces, [&](int f) {
+    auto h = mesh.face(f)->halfEdge();
+    std::array<glm::dvec3, 3> p;
+    for (int k = 0; k < 3; k++, h = h->next) {
+      codes[mesh.index(h)] = 3 * f + k;
+      corners.vertices[3 * f + k] = mesh.index(h->tail);
+      p[k] = glm::dvec3(mesh.pos(h->tail));
+    }
+    if (!cotangents) return;
+    for (int k = 0; k < 3; k++) {
+      auto u = p[k] - p[(k + 2) % 3];
+      auto v = p[(k + 1) % 3] - p[(k + 2) % 3];
+      double sine = glm::length(glm::cross(u, v));
+      corners.cotangents[3 * f + k] = sine > 0.0 ? glm::dot(u, v) / sine : 0.0;
+    }
+  }, num_threads, 1024);
+  mystl::parallel_for(0, num_faces, [&](int f) {
+    auto h = mesh.face(f)->halfEdge();
+    for (int k = 0; k < 3; k++, h = h->next)
+      corners.twins[3 * f + k] = codes[mesh.index(h->twin)];
+  }, num_threads, 1024);
+  return corners;
+}
+
+// Sorts the entries of a row by column. Rows are short, insertion sort is enough.
+void sortRow(int *columns, double *values, int n) {
+  for (int i = 1; i < n; i++) {
+    int column = columns[i];
+    double value = values[i];
+    int j = i;
+    for (; j > 0 && columns[j - 1] > column; j--) {
+      columns[j] = columns[j - 1];
+      values[j] = values[j - 1];
+    }
+    columns[j] = column;
+    values[j] = value;
+  }
+}
+
+double meanSquaredEdgeLength(const GeometryMesh &mesh) {
+  double sum = 0.0;
+  for (auto e : mesh.edges()) {
+    auto h = e->halfEdge();
+    auto d = glm::dvec3(mesh.pos(h->tip)) - glm::dvec3(mesh.pos(h->tail));
+    sum += glm::dot(d, d);
+  }
+  return mesh.numEdges() ? sum / static_cast<double>(mesh.numEdges()) : 0.0;
+}
+
+std::vector<double> coordinates(const GeometryMesh &mesh, int axis) {
+  std::vector<double> x(mesh.numVertices());
+  for (int i = 0; i < static_cast<int>(x.size()); i++)
+    x[i] = mesh.pos(mesh.vertex(i))[axis];
+  return x;
+}
+
+void setCoordinates(GeometryMesh &mesh, const std::array<std::vector<double>, 3> &x, int num_threads) {
+  std::vector<glm::vec3> positions(mesh.numVertices());
+  for (size_t i = 0; i < positions.size(); i++)
+    positions[i] = glm::vec3(x[0][i], x[1][i], x[2][i]);
+  mesh.setVertexPositions(positions, num_threads);
+}
+}
+
+CsrMatrix buildLaplacian(const GeometryMesh &mesh, LaplacianWeighting weighting, int num_threads) {
+  CsrMatrix laplacian;
+  if (!isClosedTriangleMesh(mesh)) {
+    std::cerr << "The Laplacian needs a closed triangle mesh" << std::endl;
+    return laplacian;
+  }
+  int n = static_cast<int>(mesh.numVertices());
+  auto corners = gatherCorners(mesh, weighting == LaplacianWeighting::kCotangent, num_threads);
+  int num_corners = static_cast<int>(corners.vertices.size());
+  // Every vertex of a closed mesh has as many corners as neighbours, plus the diagonal entry.
+  laplacian.row_offsets.assign(n + 1, 1);
+  laplacian.row_offsets[0] = 0;
+  for (int c = 0; c < num_corners; c++)
+    laplacian.row_offsets[corners.vertices[c] + 1]++;
+  for (int i = 0; i < n; i++)
+    laplacian.row_offsets[i + 1] += laplacian.row_offsets[i];
+  laplacian.columns.resize(laplacian.row_offsets[n]);
+  laplacian.values.resize(laplacian.row_offsets[n]);
+  std::vector<int> cursors(laplacian.row_offsets.begin(), laplacian.row_offsets.end() - 1);
+  mystl::parallel_for(0, n, [&](int i) {
+    laplacian.columns[cursors[i]++] = i;
+  }, num_threads, 4096);
+  // Entries land in any order, the rows are sorted afterwards. Both corners of an edge give the same
+  // weight, so the matrix is exactly symmetric.
+  mystl::parallel_for(0, num_corners, [&](int c) {
+    int slot = std::atomic_ref(cursors[corners.vertices[c]]).fetch_add(1, std::memory_order_relaxed);
+    laplacian.columns[slot] = corners.vertices[nextCorner(c)];
+    laplacian.values[slot] = weighting == LaplacianWeighting::kUniform
+                             ? -1.0 : -0.5 * (corners.cotangents[c] + corners.cotangents[corners.twins[c]]);
+  }, num_threads, 4096);
+  mystl::parallel_for(0, n, [&](int i) {
+    int begin = laplacian.row_offsets[i];
+    int end = laplacian.row_offsets[i + 1];
+    int *columns = laplacian.columns.data() + begin;
+    double *values = laplacian.values.data() + begin;
+    for (int k = begin; k < end; k++)
+      if (laplacian.columns[k] == i) laplacian.values[k] = 0.0;
+    sortRow(columns, values, end - begin);
+    double diagonal = 0.0;
+    int diagonal_slot = begin;
+    for (int k = begin; k < end; k++) {
+      diagonal -= laplacian.values[k];
+      if (laplacian.columns[k] == i) diagonal_slot = k;
+    }
+    laplacian.values[diagonal_slot] = diagonal;
+  }, num_threads, 1024);
+  return laplacian;
+}
+
+std::vector<double> buildLumpedMass(const GeometryMesh &mesh, int num_threads) {
+  int num_faces = static_cast<int>(mesh.numFaces());
+  std::vector<std::array<int, 3>> faces(num_faces);
+  std::vector<double> thirds(num_faces);
+  mystl::parallel_for(0, num_faces, [&](int f) {
+    auto h = mesh.face(f)->halfEdge();
+    glm::dvec3 a(mesh.pos(h->tail)), b(mesh.pos(h->tip)), c(mesh.pos(h->next->tip));
+    faces[f] = {mesh.index(h->tail), mesh.index(h->tip), mesh.index(h->next->tip)};
+    thirds[f] = glm::length(glm::cross(b - a, c - a)) / 6.0;
+  }, num_threads, 1024);
+  // Summed in face order, so the masses do not depend on the number of threads.
+  std::vector<double> mass(mesh.numVertices());
+  for (int f = 0; f < num_faces; f++)
+    for (int v : faces[f])
+      mass[v] += thirds[f];
+  return mass;
+}
+
+std::optional<LaplacianSolveStats> smoothImplicitly(GeometryMesh &mesh, const ImplicitSmoothingOptions &options) {
+  if (!isClosedTriangleMesh(mesh)) {
+    std::cerr << "Implicit smoothing needs a closed triangle mesh" << std::endl;
+    return std::nullopt;
+  }
+  int num_threads = options.solver.num_threads;
+  LaplacianSolveStats stats;
+  // On a regular mesh with edge length l the lumped area is sqrt(3)/2 l^2 and the cotangent weights are
+  // 1/sqrt(3) times the uniform ones, so M^-1 L matches D^-1 L of the uniform weights for t l^2 / 4.
+  double time_step = options.time_step;
+  if (options.weighting == LaplacianWeighting::kCotangent) time_step *= meanSquaredEdgeLength(mesh) / 4.0;
+  for (int step = 0; step < options.num_steps; step++) {
+    CsrMatrix a;
+    std::vector<double> mass;
+    stats.build_seconds += timeIt([&] {
+      a = buildLaplacian(mesh, options.weighting, num_threads);
+      if (options.weighting == LaplacianWeighting::kUniform)
+        mass = a.diagonal();
+      else
+        mass = buildLumpedMass(mesh, num_threads);
+      // A = M + t L.
+      mystl::parallel_for(0, a.rows(), [&](int i) {
+        for (int k = a.row_offsets[i]; k < a.row_offsets[i + 1]; k++)
+          a.values[k] = a.values[k] * time_step + (a.columns[k] == i ? mass[i] : 0.0);
+      }, num_threads, 4096);
+    });
+    std::unique_ptr<ConjugateGradientSolver> solver;
+    stats.build_seconds += timeIt([&] {
+      solver = std::make_unique<ConjugateGradientSolver>(std::move(a), options.solver);
+    });
+    std::array<std::vector<double>, 3> x;
+    stats.solve_seconds += timeIt([&] {
+      for (int axis = 0; axis < 3; axis++) {
+        x[axis] = coordinates(mesh, axis);
+        std::vector<double> b(x[axis].size());
+        for (size_t i = 0; i < b.size(); i++)
+          b[i] = mass[i] * x[axis][i];
+        auto result = solver->solve(b, x[axis]);
+        stats.iterations += result.iterations;
+        stats.converged = stats.converged && result.converged;
+      }
+    });
+    setCoordinates(mesh, x, num_threads);
+  }
+  return stats;
+}
+
+std::optional<LaplacianSolveStats> fairMesh(GeometryMesh &mesh, const std::vector<char> &fixed,
+                                            const FairingOptions &options) {
+  if (!isClosedTriangleMesh(mesh)) {
+    std::cerr << "Fairing needs a closed triangle mesh" << std::endl;
+    return std::nullopt;
+  }
+  int num_threads = options.solver.num_threads;
+  int n = static_cast<int>(mesh.numVertices());
+  LaplacianSolveStats stats;
+  // Rows and columns of the free vertices, in vertex order so that the rows stay sorted.
+  std::vector<int> free_index(n, -1);
+  std::vector<int> free_vertices;
+  for (int i = 0; i < n; i++) {
+    if (fixed[i]) continue;
+    free_index[i] = static_cast<int>(free_vertices.size());
+    free_vertices.push_back(i);
+  }
+  int num_free = static_cast<int>(free_vertices.size());
+  CsrMatrix a;
+  std::unique_ptr<ConjugateGradientSolver> solver;
+  std::array<std::vector<double>, 3> b;
+  stats.build_seconds = timeIt([&] {
+    auto laplacian = buildLaplacian(mesh, options.weighting, num_threads);
+    a.row_offsets.assign(num_free + 1, 0);
+    mystl::parallel_for(0, num_free, [&](int r) {
+      int i = free_vertices[r];
+      for (int k = laplacian.row_offsets[i]; k < laplacian.row_offsets[i + 1]; k++)
+        a.row_offsets[r + 1] += free_index[laplacian.columns[k]] >= 0;
+    }, num_threads, 4096);
+    for (int r = 0; r < num_free; r++)
+      a.row_offsets[r + 1] += a.row_offsets[r];
+    a.columns.resize(a.row_offsets[num_free]);
+    a.values.resize(a.row_offsets[num_free]);
+    for (auto &rhs : b)
+      rhs.assign(num_free, 0.0);
+    // Fixed neighbours move to the right-hand side.
+    mystl::parallel_for(0, num_free, [&](int r) {
+      int i = free_vertices[r];
+      int out = a.row_offsets[r];
+      for (int k = laplacian.row_offsets[i]; k < laplacian.row_offsets[i + 1]; k++) {
+        int j = laplacian.columns[k];
+        if (free_index[j] >= 0) {
+          a.columns[out] = free_index[j];
+          a.values[out++] = laplacian.values[k];
+        } else {
+          auto p = mesh.pos(mesh.vertex(j));
+          for (int axis = 0; axis < 3; axis++)
+            b[axis][r] -= laplacian.values[k] * p[axis];
+        }
+      }
+    }, num_threads, 1024);
+    solver = std::make_unique<ConjugateGradientSolver>(std::move(a), options.solver);
+  });
+  std::array<std::vector<double>, 3> x;
+  stats.solve_seconds = timeIt([&] {
+    for (int axis = 0; axis < 3; axis++) {
+      x[axis] = coordinates(mesh, axis);
+      std::vector<double> free_x(num_free);
+      for (int r = 0; r < num_free; r++)
+        free_x[r] = x[axis][free_vertices[r]];
+      auto result = solver->solve(b[axis], free_x);
+      stats.iterations += result.iterations;
+      stats.converged = stats.converged && result.converged;
+      for (int r = 0; r < num_free; r++)
+        x[axis][free_vertices[r]] = free_x[r];
+    }
+  });
+  setCoordinates(mesh, x, num_threads);
+  return stats;
+}
+}
@@ -0,0 +1,131 @@
+//
+// Created by creeper on 10/16/26.
+//
+#include <meshark/mesh-distance.h>
+#include <mystl/parallel-for.h>
+#include <algorithm>
+#include <cmath>
+
+namespace meshark {
+
+namespace {
+// Faces or vertices per chunk of partial sums. Chunks are fixed, so the sums do not depend on the
+// number of threads.
+constexpr int kChunkSize = 1024;
+
+struct DistanceSums {
+  double max{};
+  double sum{};
+  double squared_sum{};
+
+  void add(double d) {
+    max = std::max(max, d);
+    sum += d;
+    squared_sum += d * d;
+  }
+  void merge(const DistanceSums &other) {
+    max = std::max(max, other.max);
+    sum += other.sum;
+    squared_sum += other.squared_sum;
+  }
+};
+
+uint64_t splitmix64(uint64_t x) {
+  x += 0x9e3779b97f4a7c15ull;
+  x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+  x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+  return x ^ (x >> 31);
+}
+
+float unitFloat(uint64_t bits) {
+  return static_cast<float>(bits >> 40) * 0x1.0p-24f;
+}
+
+// Samples lie on or near the other surface, where closest-point queries are cheap.
+float distanceTo(const FaceBvh &bvh, const glm::vec3 &p) {
+  auto closest = bvh.closestPoint(p);
+  return closest ? closest->distance : 0.0f;
+}
+}
+
+SurfaceDistance measureSurfaceDistance(const GeometryMesh &from, const FaceBvh &to,
+                                       const MeshDistanceOptions &options) {
+  SurfaceDistance result;
+  int num_faces = static_cast<int>(from.numFaces());
+  if (num_faces == 0 || to.nodes.empty()) return result;
+  auto corners = [&](int i) {
+    auto h = from.face(i)->halfEdge();
+    return std::array<glm::vec3, 3>{from.pos(h->tail), from.pos(h->tip), from.pos(h->next->tip)};
+  };
+  // Face i gets floor(c_i) - floor(c_{i-1}) samples, with c the cumulative area times the density, so
+  // that the counts add up exactly and only depend on the areas. The total is pinned to num_samples, as
+  // the rounded product can land just below it.
+  std::vector<double> cumulative(num_faces + 1);
+  mystl::parallel_for(0, num_faces, [&](int i) {
+    auto [a, b, c] = corners(i);
+    cumulative[i + 1] = 0.5 * glm::length(glm::cross(glm::dvec3(b - a), glm::dvec3(c - a)));
+  }, options.num_threads);
+  for (int i = 0; i < num_faces; i++)
+    cumulative[i + 1] += cumulative[i];
+  double density = cumulative.back() > 0.0 ? static_cast<double>(options.num_samples) / cumulative.back() : 0.0;
+  auto firstSample = [&](int i) {
+    if (i == num_faces && density > 0.0) return static_cast<int64_t>(options.num_samples);
+    return static_cast<int64_t>(std::floor(std::min(cumulative[i] * density, static_cast<double>(options.num_samples))));
+  };
+
+  int num_chunks = (num_faces + kChunkSize - 1) / kChunkSize;
+  std::vector<DistanceSums> area_sums(num_chunks);
+  mystl::parallel_for(0, num_chunks, [&](int chunk) {
+    int end = std::min(num_faces, (chunk + 1) * kChunkSize);
+    for (int i = chunk * kChunkSize; i < end; i++) {
+      auto [a, b, c] = corners(i);
+      for (int64_t s = firstSample(i); s < firstSample(i + 1); s++) {
+        // Uniform over the triangle, keyed by the global sample index.
+        uint64_t bits = splitmix64(options.seed ^ splitmix64(static_cast<uint64_t>(s)));
+        float r = std::sqrt(unitFloat(bits));
+        float t = unitFloat(splitmix64(bits));
+        auto p = a * (1.0f - r) + b * (r * (1.0f - t)) + c * (r * t);
+        area_sums[chunk].add(distanceTo(to, p));
+      }
+    }
+  }, options.num_threads, 1);
+  DistanceSums area;
+  for (const auto &sums : area_sums)
+    area.merge(sums);
+  result.num_area_samples = firstSample(num_faces);
+  result.max = area.max;
+  if (result.num_area_samples) {
+    result.mean = area.sum / static_cast<double>(result.num_area_samples);
+    result.rms = std::sqrt(area.squared_sum / static_cast<double>(result.num_area_samples));
+  }
+
+  if (!options.sample_vertices) return result;
+  int num_vertices = static_cast<int>(from.numVertices());
+  int num_vertex_chunks = (num_vertices + kChunkSize - 1) / kChunkSize;
+  std::vector<double> vertex_max(num_vertex_chunks);
+  mystl::parallel_for(0, num_vertex_chunks, [&](int chunk) {
+    int end = std::min(num_vertices, (chunk + 1) * kChunkSize);
+    for (int i = chunk * kChunkSize; i < end; i++)
+      vertex_max[chunk] = std::max(vertex_max[chunk], static_cast<double>(distanceTo(to, from.pos(from.vertex(i)))));
+  }, options.num_threads, 1);
+  for (double d : vertex_max)
+    result.max = std::max(result.max, d);
+  result.num_vertex_samples = num_vertices;
+  return result;
+}
+
+MeshDistance measureMeshDistance(const GeometryMesh &a, const GeometryMesh &b, const MeshDistanceOptions &options) {
+  BvhOptions bvh_options;
+  bvh_options.num_threads = options.num_threads;
+  MeshDistance distance;
+  distance.forward = measureSurfaceDistance(a, FaceBvh(b, bvh_options), options);
+  distance.backward = measureSurfaceDistance(b, FaceBvh(a, bvh_options), options);
+  glm::vec3 lo(std::numeric_limits<float>::max()), hi(std::numeric_limits<float>::lowest());
+  for (auto v : a.vertices()) {
+    lo = glm::min(lo, a.pos(v));
+    hi = glm::max(hi, a.pos(v));
+  }
+  distance.diagonal = a.numVertices() ? glm::length(glm::dvec3(hi - lo)) : 0.0;
+  return distance;
+}
+}
@@ -3,9 +3,12 @@
 //
 #include <meshark/mesh-io.h>
 #include <algorithm>
+#include <cstdlib>
 #include <fstream>
 #include <iostream>
 #include <sstream>
+#include <unordered_map>
+#include <format>
 
 namespace meshark {
 
@@ -16,6 +19,10 @@ std::unique_ptr<WavefrontObj> readWavefrontObj(const std::filesystem::path &path
     return {};
   }
 
+  // Negative indices count back from the last element read so far, 0 is invalid.
+  auto resolve = [](int index, size_t num_read) {
+    return index < 0 ? static_cast<int>(num_read) + index : index - 1;
+  };
   std::string line;
   auto obj = std::make_unique<WavefrontObj>();
   std::string face_vertex;
@@ -39,21 +46,31 @@ std::unique_ptr<WavefrontObj> readWavefrontObj(const std::filesystem::path &path
     } else if (prefix == "f") {
       obj->face_splits.push_back(obj->face_vertices.size());
       while (iss >> face_vertex) {
+        // v, v/vt, v//vn or v/vt/vn.
         WavefrontObj::FaceVertex fv;
-        std::replace(face_vertex.begin(), face_vertex.end(), '/', ' ');
         std::istringstream vertex_stream(face_vertex);
-        int v_index, vt_index = -1, vn_index = -1;
-        vertex_stream >> v_index;
-        if (vertex_stream.peek() != EOF) vertex_stream >> vt_index;
-        if (vertex_stream.peek() != EOF) vertex_stream >> vn_index;
-        fv.v = v_index - 1;
-        if (vt_index != -1) fv.vt = vt_index - 1;
-        if (vn_index != -1) fv.vn = vn_index - 1;
+        std::string v_index, vt_index, vn_index;
+        std::getline(vertex_stream, v_index, '/');
+        std::getline(vertex_stream, vt_index, '/');
+        std::getline(vertex_stream, vn_index, '/');
+        fv.v = resolve(std::atoi(v_index.c_str()), obj->positions.size());
+        if (!vt_index.empty()) fv.vt = resolve(std::atoi(vt_index.c_str()), obj->uvs.size());
+        if (!vn_index.empty()) fv.vn = resolve(std::atoi(vn_index.c_str()), obj->normals.size());
         obj->face_vertices.push_back(fv);
       }
     }
   }
   obj->face_splits.push_back(obj->face_vertices.size());
+  auto outOfRange = [](const std::optional<int> &index, size_t size) {
+    return index && (*index < 0 || *index >= static_cast<int>(size));
+  };
+  for (const auto &fv : obj->face_vertices) {
+    if (outOfRange(fv.v, obj->positions.size()) || outOfRange(fv.vt, obj->uvs.size()) ||
+        outOfRange(fv.vn, obj->normals.size())) {
+      std::cerr << "Face index out of range in file: " << path << std::endl;
+      return {};
+    }
+  }
   return obj;
 }
 
@@ -64,4 +81,84 @@ std::unique_ptr<GeometryMesh> readGeometryMeshFromWavefrontObj(const std::filesy
   mesh->buildFromWavefrontObj(*obj);
   return mesh;
 }
-}
\ No newline at end of file
+
+std::unique_ptr<GeometryMesh> readClosedManifoldFromWavefrontObj(const std::filesystem::path &path) {
+  auto obj = readWavefrontObj(path);
+  if (!obj) return {};
+  bool triangles = obj->face_splits.size() > 1;
+  for (size_t i = 0; triangles && i + 1 < obj->face_splits.size(); i++)
+    triangles = obj->face_splits[i + 1] - obj->face_splits[i] == 3;
+  if (!triangles || !isClosedManifold(*obj)) {
+    std::cerr << path << " is not a closed manifold triangle mesh" << std::endl;
+    return {};
+  }
+  auto mesh = std::make_unique<GeometryMesh>();
+  mesh->buildFromWavefrontObj(*obj);
+  return mesh;
+}
+
+bool writeWavefrontObj(const WavefrontObj &obj, const std::filesystem::path &path) {
+  std::ofstream file(path);
+  if (!file.is_open()) {
+    std::cerr << "Failed to open file: " << path << std::endl;
+    return false;
+  }
+  for (auto p : obj.positions)
+    file << std::format("v {} {} {}\n", p.x, p.y, p.z);
+  for (size_t i = 0; i + 1 < obj.face_splits.size(); i++) {
+    file << "f ";
+    for (int j = obj.face_splits[i]; j < obj.face_splits[i + 1]; j++)
+      file << obj.face_vertices[j].v + 1 << " ";
+    file << "\n";
+  }
+  file.close();
+  if (!file) {
+    std::cerr << "Failed to write file: " << path << std::endl;
+    return false;
+  }
+  return true;
+}
+
+bool isClosedManifold(const WavefrontObj &obj) {
+  auto key = [](int u, int v) {
+    return static_cast<uint64_t>(static_cast<uint32_t>(u)) << 32 | static_cast<uint32_t>(v);
+  };
+  // For every directed edge u->v, the vertex preceding u in its face: walking u->prev
+  // and then taking the twin gives the next outgoing edge of u around its fan.
+  std::unordered_map<uint64_t, int> prev_of_tail;
+  std::vector<int> num_outgoing(obj.positions.size(), 0);
+  for (size_t i = 0; i + 1 < obj.face_splits.size(); i++) {
+    int start = obj.face_splits[i], end = obj.face_splits[i + 1];
+    if (end - start < 3) return false;
+    for (int j = start; j < end; j++) {
+      int u = obj.face_vertices[j].v;
+      int v = obj.face_vertices[j == end - 1 ? start : j + 1].v;
+      int w = obj.face_vertices[j == start ? end - 1 : j - 1].v;
+      if (u < 0 || u >= static_cast<int>(obj.positions.size())) return false;
+      if (u == v || !prev_of_tail.emplace(key(u, v), w).second)
+        return false;
+      num_outgoing[u]++;
+    }
+  }
+  std::vector<char> visited_vertex(obj.positions.size(), 0);
+  for (auto [uv, w] : prev_of_tail) {
+    int u = static_cast<int>(uv >> 32);
+    int v = static_cast<int>(uv & 0xffffffffu);
+    if (!prev_of_tail.contains(key(v, u)))
+      return false;
+    if (visited_vertex[u]) continue;
+    visited_vertex[u] = 1;
+    int fan_size = 0;
+    int cur = v;
+    do {
+      fan_size++;
+      auto it = prev_of_tail.find(key(u, cur));
+      if (it == prev_of_tail.end()) return false;
+      cur = it->second;
+    } while (cur != v && fan_size <= num_outgoing[u]);
+    if (fan_size != num_outgoing[u])
+      return false;
+  }
+  return true;
+}
+}
@@ -2,73 +2,1095 @@
 // Created by creeper on 7/20/24.
 //
 #include <meshark/mesh-simplifier.h>
-#include <format>
+#include <mystl/parallel-for.h>
+#include <mystl/parallel-sort.h>
+#include <mystl/thread-pool.h>
+#include <mystl/morton.h>
+#include <cmath>
+#include <algorithm>
+#include <iostream>
 
 namespace meshark {
 
-Vertex MeshSimplifier::collapseEdge(Edge e) {
-  // TODO: Implement this function
-  return Vertex();
+namespace {
+Real evaluateQuadric(const glm::dmat4 &q, const glm::vec3 &p) {
+  glm::dvec4 v(p, 1.0);
+  return glm::dot(v, q * v);
 }
 
-MeshSimplifier::MinCostEdgeCollapsingResult MeshSimplifier::collapseMinCostEdge() {
-  auto min_cost_edge = cost_edge_map.begin()->second;
-  // TODO: finish this function
-  return {Edge(), false};
+std::vector<Real> sortedDescending(std::span<const Real> alphas) {
+  std::vector<Real> sorted(alphas.begin(), alphas.end());
+  std::sort(sorted.begin(), sorted.end(), std::greater<>());
+  return sorted;
+}
+
+// Linear constraints a.v = b on the placement of a collapsed vertex, added in order of priority as in
+// Lindstrom and Turk: a constraint is only kept if it is not (almost) implied by the ones before.
+struct PlacementConstraints {
+  // Minimum angle between a new constraint normal and the span of the accepted ones.
+  static constexpr Real kMinSin2 = 3.0462e-4;  // sin^2(1 deg)
+
+  void add(const glm::dvec3 &a, Real b) {
+    if (count == 3) return;
+    // Gram-Schmidt against the accepted normals to measure the angle to their span.
+    glm::dvec3 r = a;
+    for (int i = 0; i < count; i++)
+      r -= glm::dot(r, basis[i]) * basis[i];
+    Real a2 = glm::dot(a, a), r2 = glm::dot(r, r);
+    if (!(a2 > 0) || r2 <= kMinSin2 * a2) return;
+    basis[count] = r / std::sqrt(r2);
+    rows[count] = a;
+    rhs[count] = b;
+    count++;
+  }
+
+  // Adds the constraints that make the gradient of v^T H v - 2 c^T v vanish in the directions the
+  // accepted constraints leave free.
+  void addMinimizer(const glm::dmat3 &H, const glm::dvec3 &c) {
+    std::array<glm::dvec3, 3> free;
+    int num_free = 0;
+    if (count == 0) {
+      free = {glm::dvec3(1, 0, 0), glm::dvec3(0, 1, 0), glm::dvec3(0, 0, 1)};
+      num_free = 3;
+    } else if (count == 1) {
+      auto u = basis[0];
+      auto t = std::abs(u.x) < 0.9 ? glm::dvec3(1, 0, 0) : glm::dvec3(0, 1, 0);
+      free[0] = glm::normalize(glm::cross(u, t));
+      free[1] = glm::cross(u, free[0]);
+      num_free = 2;
+    } else if (count == 2) {
+      free[0] = glm::normalize(glm::cross(basis[0], basis[1]));
+      num_free = 1;
+    }
+    for (int i = 0; i < num_free; i++)
+      add(H * free[i], glm::dot(free[i], c));
+  }
+
+  [[nodiscard]] std::optional<glm::dvec3> solve() const {
+    if (count < 3) return std::nullopt;
+    // Rows of the system are the columns of the transpose.
+    glm::dmat3 At(rows[0], rows[1], rows[2]);
+    auto A = glm::transpose(At);
+    if (glm::determinant(A) == 0) return std::nullopt;
+    return glm::inverse(A) * rhs;
+  }
+
+  std::array<glm::dvec3, 3> basis{};
+  std::array<glm::dvec3, 3> rows{};
+  glm::dvec3 rhs{};
+  int count{};
+};
+
+// Assigns every vertex to one of num_clusters spatially coherent clusters of about the same size by
+// cutting the vertices, sorted along a Morton curve, into contiguous runs. Halving num_clusters
+// merges pairs of neighbouring runs, so the levels of the clustered simplifier nest.
+void partitionVertices(const GeometryMesh &mesh, int num_clusters, int num_threads, std::vector<int> &cluster_of) {
+  int num_vertices = static_cast<int>(mesh.numVertices());
+  glm::vec3 lo(std::numeric_limits<float>::max()), hi(std::numeric_limits<float>::lowest());
+  for (auto v : mesh.vertices()) {
+    lo = glm::min(lo, mesh.pos(v));
+    hi = glm::max(hi, mesh.pos(v));
+  }
+  constexpr double kMaxCoord = (1 << 21) - 1;
+  double extent = std::max({hi.x - lo.x, hi.y - lo.y, hi.z - lo.z, 1e-30f});
+  std::vector<std::pair<uint64_t, int>> keyed_vertices(num_vertices);
+  mystl::parallel_for(0, num_vertices, [&](int i) {
+    auto c = glm::u64vec3((glm::dvec3(mesh.pos(mesh.vertex(i))) - glm::dvec3(lo)) / extent * kMaxCoord);
+    keyed_vertices[i] = {mystl::morton_code(c.x, c.y, c.z), i};
+  }, num_threads);
+  mystl::parallel_sort(keyed_vertices.begin(), keyed_vertices.end(), std::less<>{}, num_threads);
+  cluster_of.resize(num_vertices);
+  for (int i = 0; i < num_vertices; i++)
+    cluster_of[keyed_vertices[i].second] = static_cast<int>(static_cast<int64_t>(i) * num_clusters / num_vertices);
+}
+
+// Throttles the progress reports of one run and keeps its counters.
+struct ProgressMeter {
+  using Clock = std::chrono::steady_clock;
+
+  ProgressMeter(const MeshSimplifier::ProgressCallback &callback, std::chrono::milliseconds interval,
+                const SimplifyStoppingPolicy &policy)
+      : callback(callback), interval(interval), time_budget(policy.time_budget),
+        timed(callback || policy.time_budget) {}
+
+  // Reports if the interval has passed, and returns whether the time budget is used up. Reads the
+  // clock only when there is a callback or a budget.
+  bool tick(size_t remaining_edges, Real min_cost) {
+    if (!timed) return false;
+    auto now = Clock::now();
+    if (now - last_report >= interval)
+      report(now, remaining_edges, min_cost);
+    return time_budget && now - start >= *time_budget;
+  }
+
+  void report(Clock::time_point now, size_t remaining_edges, Real min_cost) {
+    last_report = now;
+    if (!callback) return;
+    std::chrono::duration<double> elapsed = now - start;
+    callback({.collapses = collapses,
+              .skipped_edges = skipped_edges,
+              .remaining_edges = remaining_edges,
+              .min_cost = min_cost,
+              .collapses_per_second = elapsed.count() > 0 ? static_cast<double>(collapses) / elapsed.count() : 0.0,
+              .elapsed = elapsed,
+              .recost = recost});
+  }
+
+  const MeshSimplifier::ProgressCallback &callback;
+  std::chrono::milliseconds interval;
+  std::optional<std::chrono::milliseconds> time_budget;
+  bool timed;
+  Clock::time_point start{Clock::now()};
+  Clock::time_point last_report{start};
+  int64_t collapses{};
+  int64_t skipped_edges{};
+  SimplifyRecostStats recost;
+};
+
+// Adds the time until the end of the scope to a phase, if phase timing is enabled.
+struct PhaseScope {
+  using Clock = std::chrono::steady_clock;
+
+  PhaseScope(std::optional<SimplifyPhaseTimes> &times, std::chrono::duration<double> SimplifyPhaseTimes::*phase)
+      : elapsed(times ? &(*times.*phase) : nullptr) {
+    if (elapsed) start = Clock::now();
+  }
+  ~PhaseScope() {
+    if (elapsed) *elapsed += Clock::now() - start;
+  }
+  PhaseScope(const PhaseScope &) = delete;
+  PhaseScope &operator=(const PhaseScope &) = delete;
+
+  std::chrono::duration<double> *elapsed;
+  Clock::time_point start;
+};
+
+// Puts the mesh into deferred normal mode until the end of the scope.
+struct DeferredNormalsScope {
+  explicit DeferredNormalsScope(GeometryMesh &mesh) : mesh(mesh), previous(mesh.deferredNormals()) {
+    mesh.setDeferredNormals(true);
+  }
+  ~DeferredNormalsScope() {
+    mesh.setDeferredNormals(previous);
+  }
+  DeferredNormalsScope(const DeferredNormalsScope &) = delete;
+  DeferredNormalsScope &operator=(const DeferredNormalsScope &) = delete;
+
+  GeometryMesh &mesh;
+  bool previous;
+};
+
+// removed_half_edges[2] and [5] end at the collapsed edge and start at the opposite vertices, their
+// tails are left alone by the rewiring.
+std::array<Vertex, 2> oppositeVertices(const EdgeCollapseRecord &record) {
+  return {record.removed_half_edges[2]->tail, record.removed_half_edges[5]->tail};
+}
+}
+
+void MeshSimplifier::collapseEdge(Edge e, const glm::vec3 &pos, SimplifyRecostStats &stats) {
+  EdgeCollapseRecord record;
+  {
+    PhaseScope scope(phase_times, &SimplifyPhaseTimes::collapse);
+    record = mesh.rewireEdgeCollapse(e);
+    if (recording)
+      collapse_records.push_back(makeVertexSplitRecord(record, pos));
+    retractRemovedPlanes(record);
+    removeCollapsedElements(record);
+  }
+  updated_costs.clear();
+  {
+    PhaseScope scope(phase_times, &SimplifyPhaseTimes::recost);
+    updateVertexPos(record.kept_vertex, pos, stats, [&](Edge f) {
+      updated_costs.emplace_back(f, computeEdgeCost(f));
+    });
+  }
+  PhaseScope scope(phase_times, &SimplifyPhaseTimes::queue);
+  for (auto [f, cost] : updated_costs)
+    updateEdgeCost(f, cost);
+}
+
+MeshSimplifier::MeshSimplifier(GeometryMesh &mesh, const SimplifierCheckpoint &checkpoint)
+    : MeshSimplifier(mesh, checkpoint.cost_model) {
+  num_original_edges = checkpoint.num_original_edges;
+  accumulated_error = checkpoint.accumulated_error;
+  if (!checkpoint.edge_costs.empty()) {
+    initialized = true;
+    for (size_t i = 0; i < checkpoint.edge_half_edges.size(); i++) {
+      auto e = SimplifierCheckpoint::halfEdgeFromCode(mesh, checkpoint.edge_half_edges[i])->edge;
+      edge_collapse_cost(e) = checkpoint.edge_costs[i];
+      edge_id(e) = checkpoint.edge_ids[i];
+    }
+    if (cost_model == SimplifyCostModel::kQuadricError)
+      for (auto v : mesh.vertices())
+        Q(v) = checkpoint.quadrics[mesh.index(v)];
+  }
+  if (checkpoint.recording) {
+    recording = true;
+    num_recorded_vertices = checkpoint.num_recorded_vertices;
+    num_recorded_faces = checkpoint.num_recorded_faces;
+    vertex_id = VertexData<int>(static_cast<int>(mesh.numVertices()));
+    face_id = FaceData<int>(static_cast<int>(mesh.numFaces()));
+    for (auto v : mesh.vertices())
+      vertex_id(v) = checkpoint.vertex_ids[mesh.index(v)];
+    for (auto f : mesh.faces())
+      face_id(f) = checkpoint.face_ids[mesh.index(f)];
+    collapse_records = checkpoint.collapse_records;
+  }
+}
+
+void MeshSimplifier::resizeCheckpoint(SimplifierCheckpoint &checkpoint) const {
+  bool quadrics = initialized && cost_model == SimplifyCostModel::kQuadricError;
+  auto num_vertices = mesh.numVertices(), num_edges = mesh.numEdges(), num_faces = mesh.numFaces();
+  checkpoint.positions.resize(num_vertices);
+  checkpoint.vertex_half_edges.resize(num_vertices);
+  checkpoint.quadrics.resize(quadrics ? num_vertices : 0);
+  checkpoint.vertex_ids.resize(recording ? num_vertices : 0);
+  checkpoint.face_vertices.resize(3 * num_faces);
+  checkpoint.face_ids.resize(recording ? num_faces : 0);
+  checkpoint.edge_half_edges.resize(num_edges);
+  checkpoint.edge_costs.resize(initialized ? num_edges : 0);
+  checkpoint.edge_ids.resize(initialized ? num_edges : 0);
+}
+
+void MeshSimplifier::encodeVertex(SimplifierCheckpoint &checkpoint, int i) const {
+  auto v = mesh.vertex(i);
+  checkpoint.positions[i] = mesh.pos(v);
+  checkpoint.vertex_half_edges[i] = SimplifierCheckpoint::halfEdgeCode(mesh, v->halfEdge());
+  if (!checkpoint.quadrics.empty()) checkpoint.quadrics[i] = Q(v);
+  if (recording) checkpoint.vertex_ids[i] = vertex_id(v);
+}
+
+void MeshSimplifier::encodeEdge(SimplifierCheckpoint &checkpoint, int i) const {
+  auto e = mesh.edge(i);
+  checkpoint.edge_half_edges[i] = SimplifierCheckpoint::halfEdgeCode(mesh, e->halfEdge());
+  if (!initialized) return;
+  checkpoint.edge_costs[i] = edge_collapse_cost(e);
+  checkpoint.edge_ids[i] = edge_id(e);
+}
+
+void MeshSimplifier::encodeFace(SimplifierCheckpoint &checkpoint, int i) const {
+  auto f = mesh.face(i);
+  int corner = 3 * i;
+  for (auto h : f->boundaryHalfEdges())
+    checkpoint.face_vertices[corner++] = mesh.index(h->tail);
+  if (recording) checkpoint.face_ids[i] = face_id(f);
+}
+
+SimplifierCheckpoint MeshSimplifier::checkpoint() const {
+  SimplifierCheckpoint checkpoint{
+      .cost_model = cost_model,
+      .num_original_edges = num_original_edges,
+      .accumulated_error = accumulated_error,
+      .recording = recording,
+      .num_recorded_vertices = num_recorded_vertices,
+      .num_recorded_faces = num_recorded_faces,
+  };
+  resizeCheckpoint(checkpoint);
+  // One pass per element type, as walking the mesh is what stalls the run.
+  for (int i = 0; i < static_cast<int>(mesh.numVertices()); i++)
+    encodeVertex(checkpoint, i);
+  for (int i = 0; i < static_cast<int>(mesh.numFaces()); i++)
+    encodeFace(checkpoint, i);
+  for (int i = 0; i < static_cast<int>(mesh.numEdges()); i++)
+    encodeEdge(checkpoint, i);
+  if (recording) checkpoint.collapse_records = collapse_records;
+  return checkpoint;
+}
+
+void MeshSimplifier::syncCheckpointMirror() {
+  if (pending_checkpoint.valid()) pending_checkpoint.get();
+  if (!checkpoint_mirror) checkpoint_mirror = std::make_unique<CheckpointMirror>();
+  auto &mirror = *checkpoint_mirror;
+  auto &snapshot = mirror.snapshot;
+  int num_vertices = static_cast<int>(mesh.numVertices());
+  int num_edges = static_cast<int>(mesh.numEdges());
+  int num_faces = static_cast<int>(mesh.numFaces());
+  if (!mirror.valid) {
+    snapshot = checkpoint();
+    // Collapses only remove elements, so no slot beyond these is ever marked.
+    mirror.vertex_marks.assign(num_vertices, 0);
+    mirror.edge_marks.assign(num_edges, 0);
+    mirror.face_marks.assign(num_faces, 0);
+    mirror.dirty_vertices.clear();
+    mirror.dirty_edges.clear();
+    mirror.dirty_faces.clear();
+    mirror.moved_vertices.clear();
+    mirror.moved_faces.clear();
+    mirror.valid = true;
+    return;
+  }
+  for (int i : mirror.moved_vertices) {
+    if (i >= num_vertices) continue;
+    for (auto h : mesh.vertex(i)->outgoingHalfEdges())
+      CheckpointMirror::mark(mirror.face_marks, mirror.dirty_faces, mesh.index(h->face));
+  }
+  for (int i : mirror.moved_faces) {
+    if (i >= num_faces) continue;
+    for (auto h : mesh.face(i)->boundaryHalfEdges()) {
+      CheckpointMirror::mark(mirror.vertex_marks, mirror.dirty_vertices, mesh.index(h->tail));
+      CheckpointMirror::mark(mirror.edge_marks, mirror.dirty_edges, mesh.index(h->edge));
+    }
+  }
+  resizeCheckpoint(snapshot);
+  auto encode = [&](std::vector<int> &dirty, std::vector<char> &marks, int size, auto &&encodeSlot) {
+    for (int i : dirty) {
+      if (i < size) encodeSlot(i);
+      marks[i] = 0;
+    }
+    dirty.clear();
+  };
+  encode(mirror.dirty_vertices, mirror.vertex_marks, num_vertices, [&](int i) { encodeVertex(snapshot, i); });
+  encode(mirror.dirty_edges, mirror.edge_marks, num_edges, [&](int i) { encodeEdge(snapshot, i); });
+  encode(mirror.dirty_faces, mirror.face_marks, num_faces, [&](int i) { encodeFace(snapshot, i); });
+  mirror.moved_vertices.clear();
+  mirror.moved_faces.clear();
+  snapshot.accumulated_error = accumulated_error;
+  if (recording)
+    snapshot.collapse_records.insert(snapshot.collapse_records.end(),
+                                     collapse_records.begin() + static_cast<std::ptrdiff_t>(snapshot.collapse_records.size()),
+                                     collapse_records.end());
+}
+
+void MeshSimplifier::prepareCheckpoints() {
+  if (checkpoint_path && !trackedCheckpointMirror()) syncCheckpointMirror();
+}
+
+void MeshSimplifier::markCollapsedRing(Vertex v) {
+  auto &mirror = *checkpoint_mirror;
+  CheckpointMirror::mark(mirror.vertex_marks, mirror.dirty_vertices, mesh.index(v));
+  for (auto h : v->outgoingHalfEdges()) {
+    CheckpointMirror::mark(mirror.face_marks, mirror.dirty_faces, mesh.index(h->face));
+    for (auto g : h->face->boundaryHalfEdges()) {
+      CheckpointMirror::mark(mirror.vertex_marks, mirror.dirty_vertices, mesh.index(g->tail));
+      CheckpointMirror::mark(mirror.edge_marks, mirror.dirty_edges, mesh.index(g->edge));
+    }
+  }
+}
+
+void MeshSimplifier::writeCheckpointInBackground() {
+  if (pending_checkpoint.valid()) {
+    // Never queue up behind a slow disk, the next interval takes a fresher one.
+    if (pending_checkpoint.wait_for(std::chrono::seconds(0)) != std::future_status::ready) return;
+    pending_checkpoint.get();
+  }
+  syncCheckpointMirror();
+  pending_checkpoint = std::async(std::launch::async, [&snapshot = checkpoint_mirror->snapshot,
+                                                       path = *checkpoint_path] {
+    auto partial = path;
+    partial += ".partial";
+    if (!writeSimplifierCheckpoint(snapshot, partial)) return;
+    std::error_code error;
+    std::filesystem::rename(partial, path, error);
+    if (error)
+      std::cerr << "Failed to move checkpoint to " << path << ": " << error.message() << std::endl;
+  });
+}
+
+void MeshSimplifier::checkpointIfDue(std::chrono::steady_clock::time_point &last_checkpoint) {
+  auto now = std::chrono::steady_clock::now();
+  if (now - last_checkpoint < checkpoint_interval) return;
+  writeCheckpointInBackground();
+  last_checkpoint = now;
+}
+
+void MeshSimplifier::enableCollapseRecording() {
+  recording = true;
+  // The mirror has no ids yet.
+  if (checkpoint_mirror) checkpoint_mirror->valid = false;
+  num_recorded_vertices = static_cast<int>(mesh.numVertices());
+  num_recorded_faces = static_cast<int>(mesh.numFaces());
+  vertex_id = VertexData<int>(num_recorded_vertices);
+  face_id = FaceData<int>(num_recorded_faces);
+  for (auto v : mesh.vertices())
+    vertex_id(v) = mesh.index(v);
+  for (auto f : mesh.faces())
+    face_id(f) = mesh.index(f);
+  collapse_records.clear();
+}
+
+ProgressiveMesh MeshSimplifier::progressiveMesh() const {
+  return {
+      .num_base_vertices = num_recorded_vertices,
+      .num_base_faces = num_recorded_faces,
+      .records = collapse_records,
+  };
+}
+
+VertexSplitRecord MeshSimplifier::makeVertexSplitRecord(const EdgeCollapseRecord &record, const glm::vec3 &pos) const {
+  auto opposite = oppositeVertices(record);
+  return {
+      .kept_vertex = vertex_id(record.kept_vertex),
+      .removed_vertex = vertex_id(record.removed_vertex),
+      .left_vertex = vertex_id(opposite[0]),
+      .right_vertex = vertex_id(opposite[1]),
+      .removed_faces = {face_id(record.removed_faces[0]), face_id(record.removed_faces[1])},
+      .new_position = pos,
+      .kept_position = mesh.pos(record.kept_vertex),
+      .removed_position = mesh.pos(record.removed_vertex),
+  };
+}
+
+void MeshSimplifier::removeCollapsedElements(const EdgeCollapseRecord &record) {
+  // Removing an element moves the last one into its slot.
+  auto mirror = trackedCheckpointMirror();
+  for (auto e : record.removed_edges) {
+    if (mirror) CheckpointMirror::mark(mirror->edge_marks, mirror->dirty_edges, mesh.index(e));
+    if (queued) eraseEdgeMapping(e);
+    edge_collapse_cost.removeEdgeData(e);
+    edge_id.removeEdgeData(e);
+    mesh.removeEdge(e);
+  }
+  if (cost_model == SimplifyCostModel::kQuadricError)
+    Q.removeVertexData(record.removed_vertex);
+  if (recording) vertex_id.removeVertexData(record.removed_vertex);
+  if (mirror) {
+    int i = mesh.index(record.removed_vertex);
+    CheckpointMirror::mark(mirror->vertex_marks, mirror->dirty_vertices, i);
+    mirror->moved_vertices.push_back(i);
+  }
+  mesh.removeVertex(record.removed_vertex);
+  for (auto f : record.removed_faces) {
+    if (recording) face_id.removeFaceData(f);
+    if (mirror) {
+      int i = mesh.index(f);
+      CheckpointMirror::mark(mirror->face_marks, mirror->dirty_faces, i);
+      mirror->moved_faces.push_back(i);
+    }
+    mesh.removeFace(f);
+  }
+  for (auto h : record.removed_half_edges)
+    mesh.removeHalfEdge(h);
+  if (mirror) markCollapsedRing(record.kept_vertex);
+}
+
+MeshSimplifier::MinCostEdgeCollapsingResult MeshSimplifier::collapseMinCostEdge(SimplifyRecostStats &stats) {
+  Edge min_cost_edge;
+  {
+    PhaseScope scope(phase_times, &SimplifyPhaseTimes::queue);
+    min_cost_edge = cost_edge_map.begin()->second;
+  }
+  {
+    PhaseScope scope(phase_times, &SimplifyPhaseTimes::link_check);
+    if (!mesh.isCollapsable(min_cost_edge))
+      return {min_cost_edge, false};
+  }
+  accumulated_error += edge_collapse_cost(min_cost_edge);
+  glm::vec3 pos;
+  {
+    PhaseScope scope(phase_times, &SimplifyPhaseTimes::recost);
+    pos = computeOptimalCollapsePosition(min_cost_edge);
+  }
+  collapseEdge(min_cost_edge, pos, stats);
+  return {nullEdge(), true};
 }
 
 Real MeshSimplifier::computeEdgeCost(Edge e) const {
-  // TODO: Implement this function
- return 0.0;
+  Real cost;
+  if (cost_model == SimplifyCostModel::kMemoryless) {
+    cost = computeMemorylessCollapse(e).cost;
+  } else {
+    glm::dmat4 q(Q(e->firstVertex()) + Q(e->secondVertex()));
+    cost = evaluateQuadric(q, computeOptimalCollapsePosition(e));
+  }
+  // Degenerate faces give NaN normals, never let them poison the ordering of the queue.
+  if (std::isnan(cost)) return std::numeric_limits<Real>::infinity();
+  return std::max(cost, 0.0);
+}
+
+void MeshSimplifier::initializeCosts(int num_threads, bool build_queue) {
+  if (!initialized) {
+    PhaseScope scope(phase_times, &SimplifyPhaseTimes::setup);
+    initialized = true;
+    if (checkpoint_mirror) checkpoint_mirror->valid = false;
+    if (cost_model == SimplifyCostModel::kQuadricError) {
+      mystl::parallel_for(0, static_cast<int>(mesh.numVertices()), [&](int i) {
+        auto v = mesh.vertex(i);
+        Q(v) = computeQuadricMatrix(v);
+      }, num_threads);
+    }
+    mystl::parallel_for(0, static_cast<int>(mesh.numEdges()), [&](int i) {
+      auto e = mesh.edge(i);
+      edge_id(e) = i;
+      edge_collapse_cost(e) = computeEdgeCost(e);
+    }, num_threads);
+  }
+  if (queued || !build_queue) return;
+  PhaseScope scope(phase_times, &SimplifyPhaseTimes::queue);
+  queued = true;
+  for (auto e : mesh.edges())
+    cost_edge_map.emplace(CostKey{edge_collapse_cost(e), edge_id(e)}, e);
+}
+
+std::optional<Real> MeshSimplifier::remainingCollapses(const SimplifyStoppingPolicy &policy) const {
+  std::optional<Real> remaining;
+  // Every collapse removes three edges and two faces.
+  if (policy.edge_ratio)
+    remaining = (static_cast<Real>(mesh.numEdges()) - *policy.edge_ratio * num_original_edges) / 3;
+  if (policy.max_faces) {
+    Real by_faces = (static_cast<Real>(mesh.numFaces()) - static_cast<Real>(*policy.max_faces)) / 2;
+    remaining = remaining ? std::min(*remaining, by_faces) : by_faces;
+  }
+  return remaining;
+}
+
+std::optional<SimplifyStopReason> MeshSimplifier::checkCountTargets(const SimplifyStoppingPolicy &policy) const {
+  if (policy.edge_ratio && mesh.numEdges() <= *policy.edge_ratio * num_original_edges)
+    return SimplifyStopReason::kEdgeRatio;
+  if (policy.max_faces && mesh.numFaces() <= *policy.max_faces)
+    return SimplifyStopReason::kFaceBudget;
+  return std::nullopt;
 }
 
 void MeshSimplifier::runSimplify(Real alpha) {
-  for (auto v : mesh.vertices())
-    Q(v) = computeQuadricMatrix(v);
-  for (auto e : mesh.edges()) {
-    edge_collapse_cost(e) = computeEdgeCost(e);
-    cost_edge_map.insert({edge_collapse_cost(e), e});
-  }
-  int round = 0;
-  while (mesh.numEdges() > alpha * num_original_edges) {
-    auto result = collapseMinCostEdge();
-    round++;
-    std::cout << std::format("Round {}: ", round);
+  runSimplify(SimplifyStoppingPolicy{.edge_ratio = alpha});
+}
+
+SimplifyStopReason MeshSimplifier::runSimplify(const SimplifyStoppingPolicy &policy) {
+  // Collapses between two reads of the clock for checkpoints.
+  constexpr int kCheckpointCheckInterval = 64;
+  ProgressMeter meter(progress_callback, progress_interval, policy);
+  initializeCosts();
+  prepareCheckpoints();
+  auto last_checkpoint = ProgressMeter::Clock::now();
+  auto minCost = [&] {
+    return cost_edge_map.empty() ? std::numeric_limits<Real>::infinity() : cost_edge_map.begin()->first.first;
+  };
+  auto stop = [&](SimplifyStopReason reason) {
+    meter.report(ProgressMeter::Clock::now(), mesh.numEdges(), minCost());
+    return reason;
+  };
+  while (true) {
+    if (auto reason = checkCountTargets(policy))
+      return stop(*reason);
+    if (policy.stop_token.stop_requested())
+      return stop(SimplifyStopReason::kCancelled);
+    if (std::isinf(minCost()))
+      return stop(SimplifyStopReason::kNoCollapsableEdge);
+    if (policy.max_error && minCost() > *policy.max_error)
+      return stop(SimplifyStopReason::kErrorThreshold);
+    if (meter.tick(mesh.numEdges(), minCost()))
+      return stop(SimplifyStopReason::kTimeBudget);
+    if (checkpoint_path && meter.collapses % kCheckpointCheckInterval == 0)
+      checkpointIfDue(last_checkpoint);
+    auto result = collapseMinCostEdge(meter.recost);
     if (!result.is_collapsable) {
-      auto e = result.failed_edge;
+      PhaseScope scope(phase_times, &SimplifyPhaseTimes::queue);
+      updateEdgeCost(result.failed_edge, std::numeric_limits<Real>::infinity());
+      meter.skipped_edges++;
+      continue;
+    }
+    meter.collapses++;
+  }
+}
+
+void MeshSimplifier::runParallelSimplify(Real alpha, int num_threads) {
+  runParallelSimplify(SimplifyStoppingPolicy{.edge_ratio = alpha}, num_threads);
+}
+
+SimplifyStopReason MeshSimplifier::runParallelSimplify(const SimplifyStoppingPolicy &policy, int num_threads) {
+  // A round never takes more than this fraction of the collapses that are still needed,
+  // which keeps the batches close to the order the serial greedy loop would pick.
+  constexpr Real kRoundFraction = 0.25;
+  // Candidates scanned per round relative to the batch budget before giving up on the round.
+  constexpr int kScanFactor = 4;
+  // A round that re-costs more than this fraction of the edges rebuilds the queue instead of updating it.
+  constexpr Real kRebuildFraction = 0.25;
+  ProgressMeter meter(progress_callback, progress_interval, policy);
+  if (num_threads <= 0) num_threads = mystl::default_concurrency();
+  initializeCosts(num_threads);
+  prepareCheckpoints();
+  auto last_checkpoint = ProgressMeter::Clock::now();
+  auto minCost = [&] {
+    return cost_edge_map.empty() ? std::numeric_limits<Real>::infinity() : cost_edge_map.begin()->first.first;
+  };
+  auto stop = [&](SimplifyStopReason reason) {
+    meter.report(ProgressMeter::Clock::now(), mesh.numEdges(), minCost());
+    return reason;
+  };
+  // Batched collapses share faces between their fans, the normals are recomputed once per round instead.
+  DeferredNormalsScope deferred_normals(mesh);
+  // Every round runs several short loops, the workers are started once for all of them. The calling
+  // thread takes its share of every loop.
+  std::optional<mystl::ThreadPool> pool;
+  if (num_threads > 1) pool.emplace(num_threads - 1);
+  auto parallelFor = [&](int n, auto &&func, int grain_size) {
+    if (pool)
+      mystl::parallel_for(*pool, 0, n, func, grain_size);
+    else
+      mystl::parallel_for(0, n, func, 1, grain_size);
+  };
+  std::vector<char> locked;
+  std::vector<char> visited;
+  std::vector<Edge> batch;
+  std::vector<Edge> failed;
+  std::vector<EdgeCollapseRecord> records;
+  std::vector<VertexSplitRecord> split_records;
+  std::vector<Vertex> affected_vertices;
+  std::vector<Edge> affected_edges;
+  std::vector<Real> updated_costs;
+  std::vector<std::pair<CostKey, Edge>> keyed_edges;
+  while (true) {
+    if (auto reason = checkCountTargets(policy))
+      return stop(*reason);
+    if (policy.stop_token.stop_requested())
+      return stop(SimplifyStopReason::kCancelled);
+    if (meter.tick(mesh.numEdges(), minCost()))
+      return stop(SimplifyStopReason::kTimeBudget);
+    if (checkpoint_path) checkpointIfDue(last_checkpoint);
+    Real remaining_collapses = remainingCollapses(policy).value_or(static_cast<Real>(mesh.numFaces()) / 2);
+    int budget = std::max(1, static_cast<int>(std::ceil(remaining_collapses * kRoundFraction)));
+    auto isLocked = [&](Vertex v) {
+      if (locked[mesh.index(v)]) return true;
+      for (auto h : v->outgoingHalfEdges())
+        if (locked[mesh.index(h->tip)]) return true;
+      return false;
+    };
+    auto lock = [&](Vertex v) {
+      locked[mesh.index(v)] = 1;
+      for (auto h : v->outgoingHalfEdges())
+        locked[mesh.index(h->tip)] = 1;
+    };
+    locked.assign(mesh.numVertices(), 0);
+    batch.clear();
+    failed.clear();
+    bool error_bound_reached = false;
+    int scanned = 0;
+    for (auto it = cost_edge_map.begin(); it != cost_edge_map.end(); ++it) {
+      if (static_cast<int>(batch.size()) >= budget || scanned++ >= kScanFactor * budget || std::isinf(it->first.first))
+        break;
+      if (policy.max_error && it->first.first > *policy.max_error) {
+        error_bound_reached = true;
+        break;
+      }
+      auto e = it->second;
+      auto v0 = e->firstVertex();
+      auto v1 = e->secondVertex();
+      if (isLocked(v0) || isLocked(v1))
+        continue;
+      if (!mesh.isCollapsable(e)) {
+        failed.push_back(e);
+        continue;
+      }
+      lock(v0);
+      lock(v1);
+      batch.push_back(e);
+      accumulated_error += it->first.first;
+    }
+    for (auto e : failed)
       updateEdgeCost(e, std::numeric_limits<Real>::infinity());
-      std::cout << "Min-cost edge is not collapsable, skip\n";
+    meter.skipped_edges += static_cast<int64_t>(failed.size());
+    if (batch.empty()) {
+      if (!failed.empty()) continue;
+      return stop(error_bound_reached ? SimplifyStopReason::kErrorThreshold : SimplifyStopReason::kNoCollapsableEdge);
+    }
+
+    records.resize(batch.size());
+    split_records.resize(recording ? batch.size() : 0);
+    parallelFor(static_cast<int>(batch.size()), [&](int i) {
+      auto pos = computeOptimalCollapsePosition(batch[i]);
+      records[i] = mesh.rewireEdgeCollapse(batch[i]);
+      if (recording)
+        split_records[i] = makeVertexSplitRecord(records[i], pos);
+      mesh.setVertexPos(records[i].kept_vertex, pos);
+    }, 16);
+    collapse_records.insert(collapse_records.end(), split_records.begin(), split_records.end());
+    for (const auto &record : records)
+      removeCollapsedElements(record);
+    if (pool)
+      mesh.flushNormals(*pool);
+    else
+      mesh.flushNormals(1);
+
+    visited.assign(mesh.numVertices(), 0);
+    affected_vertices.clear();
+    auto visitVertex = [&](Vertex v) {
+      if (visited[mesh.index(v)]) return;
+      visited[mesh.index(v)] = 1;
+      affected_vertices.push_back(v);
+    };
+    for (const auto &record : records) {
+      visitVertex(record.kept_vertex);
+      for (auto h : record.kept_vertex->outgoingHalfEdges())
+        visitVertex(h->tip);
+    }
+    if (cost_model == SimplifyCostModel::kQuadricError) {
+      parallelFor(static_cast<int>(affected_vertices.size()), [&](int i) {
+        Q(affected_vertices[i]) = computeQuadricMatrix(affected_vertices[i]);
+      }, 64);
+      meter.recost.quadrics_recomputed += static_cast<int64_t>(affected_vertices.size());
+    }
+
+    visited.assign(mesh.numEdges(), 0);
+    affected_edges.clear();
+    for (auto v : affected_vertices) {
+      for (auto h : v->outgoingHalfEdges()) {
+        if (visited[mesh.index(h->edge)]) continue;
+        visited[mesh.index(h->edge)] = 1;
+        affected_edges.push_back(h->edge);
+      }
+    }
+    meter.recost.edges_recosted += static_cast<int64_t>(affected_edges.size());
+    updated_costs.resize(affected_edges.size());
+    parallelFor(static_cast<int>(affected_edges.size()), [&](int i) {
+      updated_costs[i] = computeEdgeCost(affected_edges[i]);
+    }, 64);
+    // The early rounds re-cost most edges. Rebuilding the queue from a sorted array then costs less
+    // than moving every changed entry through the tree on its own.
+    if (static_cast<Real>(affected_edges.size()) < kRebuildFraction * static_cast<Real>(mesh.numEdges())) {
+      for (size_t i = 0; i < affected_edges.size(); i++)
+        updateEdgeCost(affected_edges[i], updated_costs[i]);
+    } else {
+      auto mirror = trackedCheckpointMirror();
+      for (size_t i = 0; i < affected_edges.size(); i++) {
+        auto e = affected_edges[i];
+        if (edge_collapse_cost(e) == updated_costs[i]) continue;
+        edge_collapse_cost(e) = updated_costs[i];
+        if (mirror) CheckpointMirror::mark(mirror->edge_marks, mirror->dirty_edges, mesh.index(e));
+      }
+      keyed_edges.resize(mesh.numEdges());
+      parallelFor(static_cast<int>(mesh.numEdges()), [&](int i) {
+        auto e = mesh.edge(i);
+        keyed_edges[i] = {CostKey{edge_collapse_cost(e), edge_id(e)}, e};
+      }, 4096);
+      auto byKey = [](const auto &a, const auto &b) {
+        return a.first < b.first;
+      };
+      if (pool)
+        mystl::parallel_sort(*pool, keyed_edges.begin(), keyed_edges.end(), byKey);
+      else
+        std::sort(keyed_edges.begin(), keyed_edges.end(), byKey);
+      cost_edge_map.clear();
+      for (const auto &[key, e] : keyed_edges)
+        cost_edge_map.emplace_hint(cost_edge_map.end(), key, e);
+    }
+    meter.collapses += static_cast<int64_t>(batch.size());
+  }
+}
+
+void MeshSimplifier::runClusteredSimplify(Real alpha, int num_threads, int cluster_faces) {
+  runClusteredSimplify(SimplifyStoppingPolicy{.edge_ratio = alpha}, num_threads, cluster_faces);
+}
+
+SimplifyStopReason MeshSimplifier::runClusteredSimplify(const SimplifyStoppingPolicy &policy, int num_threads,
+                                                        int cluster_faces) {
+  if (checkpoint_path) {
+    std::cerr << "Clustered simplification cannot be checkpointed" << std::endl;
+    return SimplifyStopReason::kCancelled;
+  }
+  // Fraction of the remaining collapses done by every level before its clusters are merged.
+  constexpr Real kLevelFraction = 0.5;
+  using Clock = std::chrono::steady_clock;
+  auto start = Clock::now();
+  std::optional<Clock::time_point> deadline;
+  if (policy.time_budget) deadline = start + *policy.time_budget;
+  if (num_threads <= 0) num_threads = mystl::default_concurrency();
+  initializeCosts(num_threads, false);
+  if (queued) {
+    cost_edge_map.clear();
+    queued = false;
+  }
+  std::vector<int> cluster_of;
+  std::vector<char> interior, touched, dead_edges;
+  std::vector<std::vector<Edge>> cluster_edges;
+  std::vector<Real> candidate_costs;
+  std::vector<ClusterRun> runs;
+  int64_t collapses = 0;
+  SimplifyRecostStats recost;
+  int num_clusters = static_cast<int>(mesh.numFaces()) / std::max(cluster_faces, 1);
+  for (; num_clusters > 1; num_clusters = (num_clusters + 1) / 2) {
+    if (checkCountTargets(policy) || policy.stop_token.stop_requested() || (deadline && Clock::now() >= *deadline))
+      break;
+    Real remaining = remainingCollapses(policy).value_or(static_cast<Real>(mesh.numFaces()) / 2);
+    auto level_collapses = static_cast<size_t>(std::ceil(remaining * kLevelFraction));
+
+    partitionVertices(mesh, num_clusters, num_threads, cluster_of);
+    interior.assign(mesh.numVertices(), 0);
+    mystl::parallel_for(0, static_cast<int>(mesh.numVertices()), [&](int i) {
+      auto v = mesh.vertex(i);
+      interior[i] = 1;
+      for (auto h : v->outgoingHalfEdges())
+        if (cluster_of[mesh.index(h->tip)] != cluster_of[i]) interior[i] = 0;
+    }, num_threads);
+    cluster_edges.assign(num_clusters, {});
+    candidate_costs.clear();
+    for (auto e : mesh.edges()) {
+      int i0 = mesh.index(e->firstVertex()), i1 = mesh.index(e->secondVertex());
+      if (!interior[i0] || !interior[i1]) continue;
+      cluster_edges[cluster_of[i0]].push_back(e);
+      candidate_costs.push_back(edge_collapse_cost(e));
+    }
+    // Clusters collapse up to the cost the level's cheapest level_collapses candidates stay under, which
+    // spreads the work over the clusters roughly as a global greedy order would.
+    Real threshold = policy.max_error.value_or(std::numeric_limits<Real>::max());
+    if (level_collapses == 0 || candidate_costs.empty()) break;
+    if (level_collapses < candidate_costs.size()) {
+      auto nth = candidate_costs.begin() + static_cast<std::ptrdiff_t>(level_collapses - 1);
+      std::nth_element(candidate_costs.begin(), nth, candidate_costs.end());
+      threshold = std::min(threshold, *nth);
+    }
+
+    touched.assign(mesh.numVertices(), 0);
+    dead_edges.assign(mesh.numEdges(), 0);
+    runs.assign(num_clusters, {});
+    mystl::parallel_for(0, num_clusters, [&](int c) {
+      simplifyCluster(cluster_edges[c], threshold, std::numeric_limits<size_t>::max(), interior, touched, dead_edges,
+                      policy, deadline, runs[c]);
+    }, num_threads, 1);
+    // Edges that reach across a border were not re-costed by either cluster.
+    mystl::parallel_for(0, static_cast<int>(mesh.numEdges()), [&](int i) {
+      if (dead_edges[i]) return;
+      auto e = mesh.edge(i);
+      int i0 = mesh.index(e->firstVertex()), i1 = mesh.index(e->secondVertex());
+      if ((!interior[i0] || !interior[i1]) && (touched[i0] || touched[i1]))
+        edge_collapse_cost(e) = computeEdgeCost(e);
+    }, num_threads, 1024);
+
+    for (auto &run : runs) {
+      for (const auto &record : run.records)
+        removeCollapsedElements(record);
+      collapse_records.insert(collapse_records.end(), run.split_records.begin(), run.split_records.end());
+      accumulated_error += run.error;
+      collapses += static_cast<int64_t>(run.records.size());
+      recost += run.recost;
+    }
+    if (progress_callback) {
+      std::chrono::duration<double> elapsed = Clock::now() - start;
+      progress_callback({.collapses = collapses,
+                         .remaining_edges = mesh.numEdges(),
+                         .min_cost = threshold,
+                         .collapses_per_second = static_cast<double>(collapses) / elapsed.count(),
+                         .elapsed = elapsed,
+                         .recost = recost});
+    }
+  }
+  // The last level is the whole mesh, simplified serially with the time that is left.
+  auto rest = policy;
+  if (deadline)
+    rest.time_budget = std::max(std::chrono::duration_cast<std::chrono::milliseconds>(*deadline - Clock::now()),
+                                std::chrono::milliseconds(0));
+  initializeCosts(num_threads);
+  return runSimplify(rest);
+}
+
+void MeshSimplifier::simplifyCluster(std::span<const Edge> edges, Real threshold, size_t max_collapses,
+                                     const std::vector<char> &interior, std::vector<char> &touched,
+                                     std::vector<char> &dead_edges,
+                                     const SimplifyStoppingPolicy &policy,
+                                     std::optional<std::chrono::steady_clock::time_point> deadline, ClusterRun &run) {
+  // Collapses between two reads of the clock or the stop token.
+  constexpr int kCheckInterval = 64;
+  std::map<CostKey, Edge> queue;
+  size_t quota = 0;
+  for (auto e : edges) {
+    queue.emplace(CostKey{edge_collapse_cost(e), edge_id(e)}, e);
+    if (edge_collapse_cost(e) <= threshold) quota++;
+  }
+  quota = std::min(quota, max_collapses);
+  auto updateCost = [&](Edge e) {
+    if (!interior[mesh.index(e->firstVertex())] || !interior[mesh.index(e->secondVertex())]) return;
+    Real cost = computeEdgeCost(e);
+    if (cost == edge_collapse_cost(e)) return;
+    queue.erase({edge_collapse_cost(e), edge_id(e)});
+    edge_collapse_cost(e) = cost;
+    queue.emplace(CostKey{cost, edge_id(e)}, e);
+  };
+  for (size_t round = 0; run.records.size() < quota && !queue.empty(); round++) {
+    if (round % kCheckInterval == 0
+        && (policy.stop_token.stop_requested() || (deadline && std::chrono::steady_clock::now() >= *deadline)))
+      return;
+    auto [key, e] = *queue.begin();
+    if (key.first > threshold || std::isinf(key.first)) return;
+    if (!mesh.isCollapsable(e)) {
+      queue.erase(queue.begin());
+      edge_collapse_cost(e) = std::numeric_limits<Real>::infinity();
+      queue.emplace(CostKey{edge_collapse_cost(e), edge_id(e)}, e);
       continue;
     }
-    std::cout << std::format("{} edges left\n", mesh.numEdges());
+    auto pos = computeOptimalCollapsePosition(e);
+    auto record = mesh.rewireEdgeCollapse(e);
+    for (auto r : record.removed_edges) {
+      queue.erase({edge_collapse_cost(r), edge_id(r)});
+      dead_edges[mesh.index(r)] = 1;
+    }
+    if (recording)
+      run.split_records.push_back(makeVertexSplitRecord(record, pos));
+    run.records.push_back(record);
+    retractRemovedPlanes(record);
+    run.error += key.first;
+    run.max_cost = std::max(run.max_cost, key.first);
+    auto v = record.kept_vertex;
+    touched[mesh.index(v)] = 1;
+    for (auto h : v->outgoingHalfEdges())
+      touched[mesh.index(h->tip)] = 1;
+    updateVertexPos(v, pos, run.recost, updateCost);
+  }
+}
+
+void MeshSimplifier::runSimplify(std::span<const Real> alphas, const SnapshotCallback &callback) {
+  for (Real alpha : sortedDescending(alphas)) {
+    runSimplify(alpha);
+    callback(alpha, mesh.toWavefrontObj());
+  }
+}
+
+void MeshSimplifier::runParallelSimplify(std::span<const Real> alphas, const SnapshotCallback &callback,
+                                         int num_threads) {
+  for (Real alpha : sortedDescending(alphas)) {
+    runParallelSimplify(alpha, num_threads);
+    callback(alpha, mesh.toWavefrontObj());
   }
 }
 
 glm::vec3 MeshSimplifier::computeOptimalCollapsePosition(Edge e) const {
-  // TODO: implement this function
-  return glm::vec3(0.f);
+  if (cost_model == SimplifyCostModel::kMemoryless)
+    return computeMemorylessCollapse(e).position;
+  auto v0 = e->firstVertex();
+  auto v1 = e->secondVertex();
+  glm::dmat4 q(Q(v0) + Q(v1));
+  glm::dmat4 A = q;
+  A[0][3] = A[1][3] = A[2][3] = 0.0;
+  A[3][3] = 1.0;
+  if (std::abs(glm::determinant(A)) > 1e-12)
+    return glm::vec3(glm::inverse(A) * glm::dvec4(0.0, 0.0, 0.0, 1.0));
+  // Degenerate quadric (e.g. a flat neighbourhood), fall back to the best of the endpoints and the midpoint.
+  auto p0 = mesh.pos(v0);
+  auto p1 = mesh.pos(v1);
+  auto mid = 0.5f * (p0 + p1);
+  Real e0 = evaluateQuadric(q, p0), e1 = evaluateQuadric(q, p1), em = evaluateQuadric(q, mid);
+  if (em <= e0 && em <= e1) return mid;
+  return e0 <= e1 ? p0 : p1;
 }
 
-void MeshSimplifier::updateVertexPos(Vertex v, const glm::vec3 &pos) {
-  // TODO: implement this function
+void MeshSimplifier::retractRemovedPlanes(const EdgeCollapseRecord &record) {
+  if (cost_model != SimplifyCostModel::kQuadricError) return;
+  auto opposite = oppositeVertices(record);
+  for (int i = 0; i < 2; i++)
+    Q(opposite[i]) -= planeQuadric(record.removed_faces[i], opposite[i]);
+}
 
+template<typename UpdateCost>
+void MeshSimplifier::updateVertexPos(Vertex v, const glm::vec3 &pos, SimplifyRecostStats &stats,
+                                     UpdateCost &&update_cost) {
+  if (cost_model == SimplifyCostModel::kQuadricError) {
+    // Only the faces around v move. A neighbour keeps the planes of the rest of its fan summed and
+    // swaps the two it shares with v, the faces of the removed vertex included, as they still hold
+    // the normals its quadric was summed with.
+    for (auto h : v->outgoingHalfEdges()) {
+      Q(h->tip) -= planeQuadric(h->face, h->tip);
+      Q(h->next->tip) -= planeQuadric(h->face, h->next->tip);
+    }
+    mesh.setVertexPos(v, pos);
+    int64_t ring_planes = 0;
+    for (auto h : v->outgoingHalfEdges()) {
+      Q(h->tip) += planeQuadric(h->face, h->tip);
+      Q(h->next->tip) += planeQuadric(h->face, h->next->tip);
+      ring_planes += h->tip->degree();
+    }
+    Q(v) = computeQuadricMatrix(v);
+    auto degree = static_cast<int64_t>(v->degree());
+    stats.quadrics_recomputed++;
+    stats.quadrics_patched += degree;
+    // Each neighbour shares two faces with v, whose planes were taken out and summed back in, and
+    // the two opposite vertices also lost the plane of a removed face.
+    stats.planes_saved += ring_planes - 4 * degree - 2;
+  } else {
+    mesh.setVertexPos(v, pos);
+  }
+  // The edges of v, the edges of the ring, and the edges leading out of the ring. A ring edge is taken
+  // from both faces it shares with v, unless v and its ends form a separating triangle; the check
+  // below then lets such an edge through twice, which only re-costs it again. Memoryless costs of the
+  // edges leading out read the faces around v as well.
+  int64_t num_edges = 0;
+  auto recost = [&](Edge e) {
+    update_cost(e);
+    num_edges++;
+  };
+  for (auto h : v->outgoingHalfEdges()) {
+    recost(h->edge);
+    recost(h->next->edge);
+    for (auto g : h->tip->outgoingHalfEdges())
+      if (g->tip != v && g->next->tip != v && g->twin->next->tip != v) recost(g->edge);
+  }
+  stats.edges_recosted += num_edges;
+}
+
+MeshSimplifier::MemorylessCollapse MeshSimplifier::computeMemorylessCollapse(Edge e) const {
+  // Weight of the shape term in the cost. It only matters where the volume terms vanish, e.g. on
+  // flat regions, and keeps the triangles there well shaped.
+  constexpr Real kShapeWeight = 1e-3;
+  auto h = e->halfEdge();
+  auto v0 = h->tail;
+  auto v1 = h->tip;
+  // Visits every face of both stars once as (n, d), where n is twice the area weighted normal, so
+  // that (dot(n, v) - d) / 6 is the volume swept by moving a corner of the face to v.
+  auto forEachFace = [&](auto &&visit) {
+    auto visitFace = [&](HalfEdge g) {
+      glm::dvec3 p0(mesh.pos(g->tail)), p1(mesh.pos(g->tip)), p2(mesh.pos(g->next->tip));
+      auto n = glm::cross(p1 - p0, p2 - p0);
+      visit(n, glm::dot(n, p0));
+    };
+    for (auto g : v0->outgoingHalfEdges())
+      visitFace(g);
+    for (auto g : v1->outgoingHalfEdges())
+      if (g->face != h->face && g->face != h->twin->face) visitFace(g);
+  };
+  auto forEachNeighbour = [&](auto &&visit) {
+    for (auto g : v0->outgoingHalfEdges())
+      if (g->tip != v1) visit(glm::dvec3(mesh.pos(g->tip)));
+    for (auto g : v1->outgoingHalfEdges())
+      if (g->tip != v0) visit(glm::dvec3(mesh.pos(g->tip)));
+  };
+  // Volume preservation, then volume optimization, then shape optimization (the squared lengths of
+  // the edges to the neighbours), each only constraining what the previous ones left free.
+  glm::dvec3 volume_normal{};
+  Real volume_offset{};
+  glm::dmat3 volume_h(0.0);
+  glm::dvec3 volume_c{};
+  forEachFace([&](const glm::dvec3 &n, Real d) {
+    volume_normal += n;
+    volume_offset += d;
+    volume_h += glm::outerProduct(n, n);
+    volume_c += d * n;
+  });
+  Real num_neighbours{};
+  glm::dvec3 neighbour_sum{};
+  forEachNeighbour([&](const glm::dvec3 &p) {
+    num_neighbours++;
+    neighbour_sum += p;
+  });
+  PlacementConstraints constraints;
+  constraints.add(volume_normal, volume_offset);
+  constraints.addMinimizer(volume_h, volume_c);
+  constraints.addMinimizer(glm::dmat3(num_neighbours), neighbour_sum);
+  glm::dvec3 p0(mesh.pos(v0)), p1(mesh.pos(v1));
+  glm::dvec3 v = constraints.solve().value_or(0.5 * (p0 + p1));
+  Real volume_cost{}, shape_cost{};
+  forEachFace([&](const glm::dvec3 &n, Real d) {
+    Real swept = (glm::dot(n, v) - d) / 6;
+    volume_cost += swept * swept;
+  });
+  forEachNeighbour([&](const glm::dvec3 &p) {
+    shape_cost += glm::dot(v - p, v - p);
+  });
+  Real length2 = glm::dot(p1 - p0, p1 - p0);
+  return {glm::vec3(v), volume_cost + kShapeWeight * length2 * length2 * shape_cost};
 }
 
 glm::mat4 MeshSimplifier::computeQuadricMatrix(Vertex v) const {
- // TODO: implement this function
+  glm::mat4 q(0.0f);
+  for (auto h : v->outgoingHalfEdges())
+    q += planeQuadric(h->face, v);
+  return q;
+}
 
-  return glm::mat4(1.0f);
+glm::mat4 MeshSimplifier::planeQuadric(Face f, Vertex c) const {
+  auto n = mesh.normal(f);
+  glm::vec4 plane(n, -glm::dot(n, mesh.pos(c)));
+  return glm::outerProduct(plane, plane);
 }
 
 void MeshSimplifier::eraseEdgeMapping(Edge e) {
-  Real cost = edge_collapse_cost(e);
-  auto range = cost_edge_map.equal_range(cost);
-  assert(range.first != cost_edge_map.end());
-  for (auto it = range.first; it != range.second; ++it) {
-    if (it->second == e) {
-      cost_edge_map.erase(it);
-      break;
-    }
-  }
+  [[maybe_unused]] auto erased = cost_edge_map.erase({edge_collapse_cost(e), edge_id(e)});
+  assert(erased == 1);
+}
 }
-}
\ No newline at end of file
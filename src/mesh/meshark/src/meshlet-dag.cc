@@ -0,0 +1,673 @@
+//
+// Created by creeper on 10/16/26.
+//
+#include <meshark/meshlet-dag.h>
+#include <meshark/mesh-simplifier.h>
+#include <mystl/parallel-for.h>
+#include <mystl/parallel-sort.h>
+#include <mystl/morton.h>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <numeric>
+#include <queue>
+#include <span>
+#include <unordered_map>
+
+namespace meshark {
+
+namespace {
+struct MeshletDagHeader {
+  char magic[4]{'M', 'K', 'M', 'D'};
+  uint32_t version{1};
+  uint32_t num_positions{};
+  uint32_t num_indices{};
+  uint32_t num_clusters{};
+  uint32_t num_groups{};
+  uint32_t num_group_children{};
+};
+
+struct Meshlet {
+  std::vector<Face> faces;
+  uint32_t cluster;
+};
+
+std::vector<Face> mortonOrderedFaces(const GeometryMesh &mesh, int num_threads) {
+  int num_faces = static_cast<int>(mesh.numFaces());
+  glm::vec3 lo(std::numeric_limits<float>::max()), hi(std::numeric_limits<float>::lowest());
+  for (auto v : mesh.vertices()) {
+    lo = glm::min(lo, mesh.pos(v));
+    hi = glm::max(hi, mesh.pos(v));
+  }
+  constexpr double kMaxCoord = (1 << 21) - 1;
+  double extent = std::max({hi.x - lo.x, hi.y - lo.y, hi.z - lo.z, 1e-30f});
+  std::vector<std::pair<uint64_t, int>> keyed_faces(num_faces);
+  mystl::parallel_for(0, num_faces, [&](int i) {
+    auto h = mesh.face(i)->halfEdge();
+    auto centroid = (mesh.pos(h->tail) + mesh.pos(h->tip) + mesh.pos(h->next->tip)) / 3.0f;
+    auto c = glm::u64vec3((glm::dvec3(centroid) - glm::dvec3(lo)) / extent * kMaxCoord);
+    keyed_faces[i] = {mystl::morton_code(c.x, c.y, c.z), i};
+  }, num_threads);
+  mystl::parallel_sort(keyed_faces.begin(), keyed_faces.end(), std::less<>{}, num_threads);
+  std::vector<Face> faces(num_faces);
+  for (int i = 0; i < num_faces; i++)
+    faces[i] = mesh.face(keyed_faces[i].second);
+  return faces;
+}
+
+// Grows meshlets over the faces tagged with tag. Among the faces adjacent to a meshlet, the one adding
+// the fewest new vertices joins next, so meshlets stay compact and fill up to max_triangles before they
+// run out of vertices. Ties go to the face with the fewest free neighbours, which fills in corners
+// before they become islands, and then to the earliest candidate. Only the assigned flags of faces with
+// that tag are written, so disjoint tags can be split concurrently.
+class MeshletGrower {
+ public:
+  struct Candidate {
+    Face face;
+    int num_new;
+  };
+  struct Growth {
+    std::vector<Face> faces;
+    std::vector<Vertex> vertices;
+    std::vector<Candidate> candidates;
+  };
+
+  MeshletGrower(const GeometryMesh &mesh, const std::vector<int> &face_tag, int tag, std::vector<char> &assigned,
+                const MeshletDagOptions &options)
+      : mesh(mesh), face_tag(face_tag), tag(tag), assigned(assigned),
+        max_vertices(static_cast<size_t>(options.max_vertices)),
+        max_triangles(static_cast<size_t>(options.max_triangles)) {}
+
+  [[nodiscard]] bool isFree(Face f) const {
+    return face_tag[mesh.index(f)] == tag && !assigned[mesh.index(f)];
+  }
+  [[nodiscard]] int numFreeNeighbours(Face f) const {
+    int n = 0;
+    for (auto h : f->boundaryHalfEdges())
+      n += isFree(h->twin->face);
+    return n;
+  }
+  void start(Growth &growth, Face seed) const {
+    growth.faces.clear();
+    growth.vertices.clear();
+    growth.candidates.assign(1, {seed, 3});
+  }
+  // Adds the best candidate to the meshlet, false if it is full or no candidate fits.
+  bool grow(Growth &growth) const {
+    auto &[faces, vertices, candidates] = growth;
+    if (faces.size() >= max_triangles) return false;
+    std::erase_if(candidates, [&](const Candidate &c) { return assigned[mesh.index(c.face)]; });
+    int best = -1, best_free = 0;
+    for (int i = 0; i < static_cast<int>(candidates.size()); i++) {
+      const auto &c = candidates[i];
+      if (vertices.size() + c.num_new > max_vertices) continue;
+      if (best >= 0 && c.num_new > candidates[best].num_new) continue;
+      int num_free = numFreeNeighbours(c.face);
+      if (best < 0 || c.num_new < candidates[best].num_new || num_free < best_free) {
+        best = i;
+        best_free = num_free;
+      }
+    }
+    if (best < 0) return false;
+    auto f = candidates[best].face;
+    candidates.erase(candidates.begin() + best);
+    assigned[mesh.index(f)] = 1;
+    faces.push_back(f);
+    auto isNew = [&](Vertex v) { return std::find(vertices.begin(), vertices.end(), v) == vertices.end(); };
+    auto findCandidate = [&](Face g) {
+      return std::find_if(candidates.begin(), candidates.end(), [&](const Candidate &c) { return c.face == g; });
+    };
+    for (auto h : f->boundaryHalfEdges()) {
+      if (!isNew(h->tip)) continue;
+      vertices.push_back(h->tip);
+      for (auto g : h->tip->outgoingHalfEdges())
+        if (auto it = findCandidate(g->face); it != candidates.end()) it->num_new--;
+    }
+    for (auto h : f->boundaryHalfEdges()) {
+      auto g = h->twin->face;
+      if (!isFree(g) || findCandidate(g) != candidates.end()) continue;
+      int num_new = 0;
+      for (auto gh : g->boundaryHalfEdges())
+        num_new += isNew(gh->tip);
+      candidates.push_back({g, num_new});
+    }
+    return true;
+  }
+
+ private:
+  const GeometryMesh &mesh;
+  const std::vector<int> &face_tag;
+  int tag;
+  std::vector<char> &assigned;
+  size_t max_vertices;
+  size_t max_triangles;
+};
+
+// Splits the faces tagged with tag one meshlet after the other. The next meshlet is seeded on the border
+// of the previous one, at the face with the fewest free neighbours, so that no small islands are left
+// behind; the first unassigned face of faces seeds it when the border is used up.
+void splitIntoMeshlets(const GeometryMesh &mesh, std::span<const Face> faces, const std::vector<int> &face_tag,
+                       int tag, std::vector<char> &assigned, const MeshletDagOptions &options,
+                       std::vector<std::vector<Face>> &meshlets) {
+  MeshletGrower grower(mesh, face_tag, tag, assigned, options);
+  MeshletGrower::Growth growth;
+  size_t next_in_order = 0;
+  while (true) {
+    std::optional<Face> seed;
+    int seed_free = 0;
+    for (const auto &c : growth.candidates) {
+      if (!grower.isFree(c.face)) continue;
+      if (int n = grower.numFreeNeighbours(c.face); !seed || n < seed_free) {
+        seed = c.face;
+        seed_free = n;
+      }
+    }
+    while (!seed && next_in_order < faces.size())
+      if (auto f = faces[next_in_order++]; grower.isFree(f)) seed = f;
+    if (!seed) break;
+    grower.start(growth, *seed);
+    while (grower.grow(growth)) {}
+    meshlets.push_back(growth.faces);
+  }
+}
+
+// Picks k faces spread over the group by farthest-point sampling on face adjacency. Faces that cannot
+// be reached from the seeds picked so far count as farthest, so every component gets a seed first.
+std::vector<Face> spreadSeeds(const GeometryMesh &mesh, std::span<const Face> faces,
+                              const std::vector<int> &face_tag, int tag, size_t k) {
+  std::unordered_map<int, int> local;
+  for (size_t i = 0; i < faces.size(); i++)
+    local.emplace(mesh.index(faces[i]), static_cast<int>(i));
+  std::vector<int> distance(faces.size(), std::numeric_limits<int>::max());
+  std::vector<int> queue;
+  auto relax = [&](int source) {
+    distance[source] = 0;
+    queue.assign(1, source);
+    for (size_t head = 0; head < queue.size(); head++) {
+      int i = queue[head];
+      for (auto h : faces[i]->boundaryHalfEdges()) {
+        auto g = h->twin->face;
+        if (face_tag[mesh.index(g)] != tag) continue;
+        int j = local.at(mesh.index(g));
+        if (distance[j] <= distance[i] + 1) continue;
+        distance[j] = distance[i] + 1;
+        queue.push_back(j);
+      }
+    }
+  };
+  auto farthest = [&] {
+    return static_cast<int>(std::max_element(distance.begin(), distance.end()) - distance.begin());
+  };
+  // The face farthest from an arbitrary one lies on the rim of its component.
+  relax(0);
+  int first = farthest();
+  std::fill(distance.begin(), distance.end(), std::numeric_limits<int>::max());
+  std::vector<Face> seeds;
+  for (int next = first; seeds.size() < k; next = farthest()) {
+    seeds.push_back(faces[next]);
+    relax(next);
+  }
+  return seeds;
+}
+
+// Splits the faces of one simplified group into as few meshlets as possible. Growing them one after the
+// other leaves a small remainder next to full meshlets, so the group is instead partitioned into k
+// meshlets grown side by side from spread seeds, always growing the smallest one, which keeps them the
+// same size. k starts at the number of meshlets the triangle limit requires and goes up until every face
+// fits; the sequential split is kept if that never needs fewer meshlets.
+std::vector<std::vector<Face>> splitGroup(const GeometryMesh &mesh, std::span<const Face> faces,
+                                          const std::vector<int> &face_tag, int tag, std::vector<char> &assigned,
+                                          const MeshletDagOptions &options) {
+  std::vector<std::vector<Face>> meshlets;
+  splitIntoMeshlets(mesh, faces, face_tag, tag, assigned, options, meshlets);
+  MeshletGrower grower(mesh, face_tag, tag, assigned, options);
+  std::vector<MeshletGrower::Growth> growths;
+  auto max_triangles = static_cast<size_t>(options.max_triangles);
+  for (size_t k = (faces.size() + max_triangles - 1) / max_triangles; k < meshlets.size(); k++) {
+    for (auto f : faces)
+      assigned[mesh.index(f)] = 0;
+    auto seeds = spreadSeeds(mesh, faces, face_tag, tag, k);
+    growths.resize(k);
+    std::vector<int> open;
+    for (size_t i = 0; i < k; i++) {
+      grower.start(growths[i], seeds[i]);
+      if (grower.grow(growths[i])) open.push_back(static_cast<int>(i));
+    }
+    while (!open.empty()) {
+      auto smallest = std::min_element(open.begin(), open.end(), [&](int a, int b) {
+        return growths[a].faces.size() < growths[b].faces.size();
+      });
+      if (!grower.grow(growths[*smallest])) open.erase(smallest);
+    }
+    size_t num_assigned = 0;
+    for (const auto &growth : growths)
+      num_assigned += growth.faces.size();
+    if (num_assigned < faces.size()) continue;
+    meshlets.clear();
+    for (auto &growth : growths)
+      meshlets.push_back(std::move(growth.faces));
+    break;
+  }
+  // A failed attempt leaves its own flags behind, so they are set again for the split that is kept.
+  for (auto f : faces)
+    assigned[mesh.index(f)] = 0;
+  for (const auto &meshlet : meshlets)
+    for (auto f : meshlet)
+      assigned[mesh.index(f)] = 1;
+  return meshlets;
+}
+
+// Partitions the meshlets into groups of about group_size neighbours. Each group is seeded with the
+// ungrouped meshlet that has the fewest ungrouped neighbours, so that no meshlet is left surrounded
+// by full groups, and grows by the ungrouped neighbour sharing the most edges with it. Groups that
+// still end up with fewer than half of group_size meshlets are merged into the neighbouring group
+// they share the most edges with: their borders would otherwise stay locked on every level.
+std::vector<std::vector<int>> groupMeshlets(const GeometryMesh &mesh, const std::vector<Meshlet> &meshlets,
+                                            int group_size) {
+  int num_meshlets = static_cast<int>(meshlets.size());
+  std::vector<int> face_meshlet(mesh.numFaces(), -1);
+  for (int m = 0; m < num_meshlets; m++)
+    for (auto f : meshlets[m].faces)
+      face_meshlet[mesh.index(f)] = m;
+  // (neighbour, number of shared edges) per meshlet.
+  std::vector<std::vector<std::pair<int, int>>> adjacency(num_meshlets);
+  std::vector<int> neighbours;
+  for (int m = 0; m < num_meshlets; m++) {
+    neighbours.clear();
+    for (auto f : meshlets[m].faces)
+      for (auto h : f->boundaryHalfEdges())
+        if (int n = face_meshlet[mesh.index(h->twin->face)]; n != m) neighbours.push_back(n);
+    std::sort(neighbours.begin(), neighbours.end());
+    for (size_t i = 0; i < neighbours.size();) {
+      size_t j = i;
+      while (j < neighbours.size() && neighbours[j] == neighbours[i]) j++;
+      adjacency[m].emplace_back(neighbours[i], static_cast<int>(j - i));
+      i = j;
+    }
+  }
+
+  std::vector<int> group_of(num_meshlets, -1);
+  std::vector<int> num_free(num_meshlets);
+  // Min-heap on the number of ungrouped neighbours, with stale entries skipped when popped.
+  std::priority_queue<std::pair<int, int>, std::vector<std::pair<int, int>>, std::greater<>> seeds;
+  for (int m = 0; m < num_meshlets; m++) {
+    num_free[m] = static_cast<int>(adjacency[m].size());
+    seeds.emplace(num_free[m], m);
+  }
+  std::vector<int> shared(num_meshlets, 0);
+  std::vector<int> front;
+  std::vector<std::vector<int>> groups;
+  auto join = [&](int m, int g) {
+    group_of[m] = g;
+    groups[g].push_back(m);
+    for (auto [n, count] : adjacency[m]) {
+      if (group_of[n] >= 0) continue;
+      seeds.emplace(--num_free[n], n);
+      if (shared[n] == 0) front.push_back(n);
+      shared[n] += count;
+    }
+  };
+  while (!seeds.empty()) {
+    auto [count, seed] = seeds.top();
+    seeds.pop();
+    if (group_of[seed] >= 0 || count != num_free[seed]) continue;
+    int g = static_cast<int>(groups.size());
+    groups.emplace_back();
+    join(seed, g);
+    while (static_cast<int>(groups[g].size()) < group_size) {
+      int best = -1;
+      for (int n : front)
+        if (group_of[n] < 0 &&
+            (best < 0 || shared[n] > shared[best] || (shared[n] == shared[best] && num_free[n] < num_free[best])))
+          best = n;
+      if (best < 0) break;
+      join(best, g);
+    }
+    for (int n : front)
+      shared[n] = 0;
+    front.clear();
+  }
+
+  // Smallest groups first, so that they merge into full groups rather than into each other.
+  std::vector<int> order(groups.size());
+  std::iota(order.begin(), order.end(), 0);
+  std::stable_sort(order.begin(), order.end(), [&](int a, int b) { return groups[a].size() < groups[b].size(); });
+  std::vector<int> group_shared(groups.size(), 0);
+  for (int g : order) {
+    if (groups[g].empty() || static_cast<int>(groups[g].size()) * 2 >= group_size) continue;
+    std::vector<int> touched;
+    for (int m : groups[g])
+      for (auto [n, count] : adjacency[m])
+        if (int h = group_of[n]; h != g) {
+          if (group_shared[h] == 0) touched.push_back(h);
+          group_shared[h] += count;
+        }
+    int target = -1;
+    for (int h : touched)
+      if (target < 0 || group_shared[h] > group_shared[target]) target = h;
+    for (int h : touched)
+      group_shared[h] = 0;
+    if (target < 0) continue;
+    for (int m : groups[g]) {
+      group_of[m] = target;
+      groups[target].push_back(m);
+    }
+    groups[g].clear();
+  }
+  std::erase_if(groups, [](const auto &group) { return group.empty(); });
+  return groups;
+}
+
+// Colors the groups so that groups sharing a vertex get different colors. Groups of one color touch
+// disjoint parts of the mesh and can be simplified concurrently.
+std::vector<std::vector<int>> colorGroups(const GeometryMesh &mesh, const std::vector<int> &face_group, int num_groups) {
+  std::vector<std::vector<int>> adjacency(num_groups);
+  std::vector<int> around;
+  for (auto v : mesh.vertices()) {
+    around.clear();
+    for (auto h : v->outgoingHalfEdges())
+      around.push_back(face_group[mesh.index(h->face)]);
+    std::sort(around.begin(), around.end());
+    around.erase(std::unique(around.begin(), around.end()), around.end());
+    for (int a : around)
+      for (int b : around)
+        if (a != b) adjacency[a].push_back(b);
+  }
+  std::vector<int> color(num_groups, -1);
+  std::vector<std::vector<int>> colors;
+  std::vector<char> used;
+  for (int g = 0; g < num_groups; g++) {
+    used.assign(colors.size() + 1, 0);
+    for (int n : adjacency[g])
+      if (color[n] >= 0) used[color[n]] = 1;
+    int c = static_cast<int>(std::find(used.begin(), used.end(), 0) - used.begin());
+    if (c == static_cast<int>(colors.size())) colors.emplace_back();
+    colors[c].push_back(g);
+    color[g] = c;
+  }
+  return colors;
+}
+
+uint32_t emitCluster(const GeometryMesh &mesh, std::span<const Face> faces, uint16_t level, uint32_t group,
+                     float lod_error, MeshletDag &dag) {
+  MeshletCluster cluster{};
+  cluster.first_vertex = static_cast<uint32_t>(dag.positions.size());
+  cluster.first_triangle = static_cast<uint32_t>(dag.indices.size() / 3);
+  std::vector<Vertex> vertices;
+  glm::vec3 lo(std::numeric_limits<float>::max()), hi(std::numeric_limits<float>::lowest());
+  for (auto f : faces) {
+    for (auto h : f->boundaryHalfEdges()) {
+      auto it = std::find(vertices.begin(), vertices.end(), h->tip);
+      if (it == vertices.end()) {
+        vertices.push_back(h->tip);
+        dag.positions.push_back(mesh.pos(h->tip));
+        lo = glm::min(lo, mesh.pos(h->tip));
+        hi = glm::max(hi, mesh.pos(h->tip));
+        it = vertices.end() - 1;
+      }
+      dag.indices.push_back(static_cast<uint8_t>(it - vertices.begin()));
+    }
+  }
+  auto center = 0.5f * (lo + hi);
+  float radius = 0;
+  for (auto v : vertices)
+    radius = std::max(radius, glm::length(mesh.pos(v) - center));
+  cluster.num_vertices = static_cast<uint8_t>(vertices.size());
+  cluster.num_triangles = static_cast<uint8_t>(faces.size());
+  cluster.level = level;
+  cluster.group = group;
+  cluster.parent_group = MeshletDag::kNoGroup;
+  cluster.bounds = glm::vec4(center, radius);
+  cluster.lod_error = lod_error;
+  cluster.parent_error = std::numeric_limits<float>::infinity();
+  dag.clusters.push_back(cluster);
+  return static_cast<uint32_t>(dag.clusters.size()) - 1;
+}
+
+glm::vec4 enclosingSphere(std::span<const glm::vec4> spheres) {
+  glm::vec3 lo(std::numeric_limits<float>::max()), hi(std::numeric_limits<float>::lowest());
+  for (const auto &s : spheres) {
+    lo = glm::min(lo, glm::vec3(s) - s.w);
+    hi = glm::max(hi, glm::vec3(s) + s.w);
+  }
+  auto center = 0.5f * (lo + hi);
+  float radius = 0;
+  for (const auto &s : spheres)
+    radius = std::max(radius, glm::length(glm::vec3(s) - center) + s.w);
+  return {center, radius};
+}
+}
+
+std::unique_ptr<MeshletDag> MeshletDagBuilder::build(const MeshletDagOptions &options) {
+  int num_threads = options.num_threads > 0 ? options.num_threads : mystl::default_concurrency();
+  auto dag = std::make_unique<MeshletDag>();
+  MeshSimplifier simplifier(mesh);
+  simplifier.initializeCosts(num_threads, false);
+
+  std::vector<int> face_tag(mesh.numFaces(), 0);
+  std::vector<char> assigned(mesh.numFaces(), 0);
+  std::vector<std::vector<Face>> split;
+  splitIntoMeshlets(mesh, mortonOrderedFaces(mesh, num_threads), face_tag, 0, assigned, options, split);
+  std::vector<Meshlet> meshlets;
+  for (auto &faces : split) {
+    auto cluster = emitCluster(mesh, faces, 0, MeshletDag::kNoGroup, 0.0f, *dag);
+    meshlets.push_back({std::move(faces), cluster});
+  }
+
+  std::vector<int> face_group;
+  std::vector<char> interior, touched, dead_edges, dead_faces;
+  std::vector<glm::vec4> child_bounds;
+  for (uint16_t level = 1; meshlets.size() > 1; level++) {
+    auto groups = groupMeshlets(mesh, meshlets, options.group_size);
+    int num_groups = static_cast<int>(groups.size());
+    face_group.assign(mesh.numFaces(), -1);
+    std::vector<size_t> group_faces(num_groups);
+    for (int g = 0; g < num_groups; g++) {
+      for (int m : groups[g]) {
+        for (auto f : meshlets[m].faces)
+          face_group[mesh.index(f)] = g;
+        group_faces[g] += meshlets[m].faces.size();
+      }
+    }
+    // Only vertices with all their faces in one group may move, which locks the group borders.
+    interior.assign(mesh.numVertices(), 0);
+    mystl::parallel_for(0, static_cast<int>(mesh.numVertices()), [&](int i) {
+      auto v = mesh.vertex(i);
+      int g = face_group[mesh.index(v->halfEdge()->face)];
+      interior[i] = 1;
+      for (auto h : v->outgoingHalfEdges())
+        if (face_group[mesh.index(h->face)] != g) interior[i] = 0;
+    }, num_threads);
+    std::vector<std::vector<Edge>> group_edges(num_groups);
+    for (auto e : mesh.edges())
+      if (interior[mesh.index(e->firstVertex())] && interior[mesh.index(e->secondVertex())])
+        group_edges[face_group[mesh.index(e->halfEdge()->face)]].push_back(e);
+
+    touched.assign(mesh.numVertices(), 0);
+    dead_edges.assign(mesh.numEdges(), 0);
+    std::vector<MeshSimplifier::ClusterRun> runs(num_groups);
+    for (const auto &color : colorGroups(mesh, face_group, num_groups)) {
+      mystl::parallel_for(0, static_cast<int>(color.size()), [&](int i) {
+        int g = color[i];
+        // Every collapse removes two faces.
+        simplifier.simplifyCluster(group_edges[g], std::numeric_limits<Real>::infinity(), group_faces[g] / 4,
+                                   interior, touched, dead_edges, {}, std::nullopt, runs[g]);
+      }, num_threads, 1);
+    }
+    size_t num_collapses = 0;
+    for (const auto &run : runs)
+      num_collapses += run.records.size();
+    if (num_collapses == 0) break;
+
+    mystl::parallel_for(0, static_cast<int>(mesh.numEdges()), [&](int i) {
+      if (dead_edges[i]) return;
+      auto e = mesh.edge(i);
+      int i0 = mesh.index(e->firstVertex()), i1 = mesh.index(e->secondVertex());
+      if ((!interior[i0] || !interior[i1]) && (touched[i0] || touched[i1]))
+        simplifier.edge_collapse_cost(e) = simplifier.computeEdgeCost(e);
+    }, num_threads, 1024);
+    dead_faces.assign(mesh.numFaces(), 0);
+    for (const auto &run : runs)
+      for (const auto &record : run.records)
+        for (auto f : record.removed_faces)
+          dead_faces[mesh.index(f)] = 1;
+    std::vector<std::vector<Face>> live_faces(num_groups);
+    for (int g = 0; g < num_groups; g++)
+      for (int m : groups[g])
+        for (auto f : meshlets[m].faces)
+          if (!dead_faces[mesh.index(f)]) live_faces[g].push_back(f);
+    for (const auto &run : runs)
+      for (const auto &record : run.records)
+        simplifier.removeCollapsedElements(record);
+
+    face_tag.assign(mesh.numFaces(), -1);
+    for (int g = 0; g < num_groups; g++)
+      for (auto f : live_faces[g])
+        face_tag[mesh.index(f)] = g;
+    assigned.assign(mesh.numFaces(), 0);
+    std::vector<std::vector<std::vector<Face>>> group_split(num_groups);
+    mystl::parallel_for(0, num_groups, [&](int g) {
+      group_split[g] = splitGroup(mesh, live_faces[g], face_tag, g, assigned, options);
+    }, num_threads, 1);
+
+    std::vector<Meshlet> next;
+    for (int g = 0; g < num_groups; g++) {
+      auto group_index = static_cast<uint32_t>(dag->groups.size());
+      MeshletGroup group{};
+      group.first_child = static_cast<uint32_t>(dag->group_children.size());
+      group.num_children = static_cast<uint32_t>(groups[g].size());
+      // Errors only grow towards the root, so that a cut through the DAG is consistent.
+      float error = static_cast<float>(std::sqrt(runs[g].max_cost));
+      child_bounds.clear();
+      for (int m : groups[g]) {
+        const auto &child = dag->clusters[meshlets[m].cluster];
+        error = std::max(error, child.lod_error);
+        child_bounds.push_back(child.bounds);
+      }
+      group.error = error;
+      group.bounds = enclosingSphere(child_bounds);
+      for (int m : groups[g]) {
+        auto &child = dag->clusters[meshlets[m].cluster];
+        child.parent_group = group_index;
+        child.parent_error = error;
+        dag->group_children.push_back(meshlets[m].cluster);
+      }
+      group.first_cluster = static_cast<uint32_t>(dag->clusters.size());
+      for (auto &faces : group_split[g]) {
+        auto cluster = emitCluster(mesh, faces, level, group_index, error, *dag);
+        next.push_back({std::move(faces), cluster});
+      }
+      group.num_clusters = static_cast<uint32_t>(dag->clusters.size()) - group.first_cluster;
+      dag->groups.push_back(group);
+    }
+    meshlets = std::move(next);
+  }
+  return dag;
+}
+
+namespace {
+// Checks every range and index a renderer follows, so that a damaged file is rejected instead of
+// read out of bounds.
+const char *invalidMeshletDagReason(const MeshletDag &dag) {
+  if (dag.indices.size() % 3 != 0) return "index count is not a multiple of three";
+  for (const auto &cluster : dag.clusters) {
+    if (uint64_t(cluster.first_vertex) + cluster.num_vertices > dag.positions.size())
+      return "cluster vertices out of range";
+    if (3 * (uint64_t(cluster.first_triangle) + cluster.num_triangles) > dag.indices.size())
+      return "cluster triangles out of range";
+    for (uint32_t k = 0; k < 3u * cluster.num_triangles; k++)
+      if (dag.indices[3 * size_t(cluster.first_triangle) + k] >= cluster.num_vertices)
+        return "triangle index out of range";
+    if (cluster.group != MeshletDag::kNoGroup && cluster.group >= dag.groups.size())
+      return "cluster group out of range";
+    if (cluster.parent_group != MeshletDag::kNoGroup && cluster.parent_group >= dag.groups.size())
+      return "cluster parent group out of range";
+  }
+  for (const auto &group : dag.groups) {
+    if (uint64_t(group.first_child) + group.num_children > dag.group_children.size())
+      return "group children out of range";
+    if (uint64_t(group.first_cluster) + group.num_clusters > dag.clusters.size())
+      return "group clusters out of range";
+  }
+  for (uint32_t child : dag.group_children)
+    if (child >= dag.clusters.size()) return "group child out of range";
+  return nullptr;
+}
+}
+
+bool writeMeshletDag(const MeshletDag &dag, const std::filesystem::path &path) {
+  std::ofstream file(path, std::ios::binary);
+  if (!file.is_open()) {
+    std::cerr << "Failed to open file: " << path << std::endl;
+    return false;
+  }
+  MeshletDagHeader header;
+  header.num_positions = dag.positions.size();
+  header.num_indices = dag.indices.size();
+  header.num_clusters = dag.clusters.size();
+  header.num_groups = dag.groups.size();
+  header.num_group_children = dag.group_children.size();
+  auto write = [&](const auto &v) {
+    file.write(reinterpret_cast<const char *>(v.data()),
+               static_cast<std::streamsize>(v.size() * sizeof(v[0])));
+  };
+  file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+  write(dag.positions);
+  write(dag.indices);
+  write(dag.clusters);
+  write(dag.groups);
+  write(dag.group_children);
+  file.close();
+  if (!file) {
+    std::cerr << "Failed to write meshlet DAG: " << path << std::endl;
+    return false;
+  }
+  return true;
+}
+
+std::unique_ptr<MeshletDag> readMeshletDag(const std::filesystem::path &path) {
+  std::ifstream file(path, std::ios::binary);
+  if (!file.is_open()) {
+    std::cerr << "Failed to open file: " << path << std::endl;
+    return {};
+  }
+  MeshletDagHeader header, expected;
+  file.read(reinterpret_cast<char *>(&header), sizeof(header));
+  if (!file || std::memcmp(header.magic, expected.magic, 4) != 0 || header.version != expected.version) {
+    std::cerr << "Not a meshlet DAG file: " << path << std::endl;
+    return {};
+  }
+  // Sizes are checked against the file before anything is allocated for them.
+  uint64_t payload = uint64_t(header.num_positions) * sizeof(glm::vec3) + header.num_indices
+      + uint64_t(header.num_clusters) * sizeof(MeshletCluster) + uint64_t(header.num_groups) * sizeof(MeshletGroup)
+      + uint64_t(header.num_group_children) * sizeof(uint32_t);
+  std::error_code ec;
+  auto file_size = std::filesystem::file_size(path, ec);
+  if (ec || payload > file_size - sizeof(header)) {
+    std::cerr << "Truncated meshlet DAG file: " << path << std::endl;
+    return {};
+  }
+  auto dag = std::make_unique<MeshletDag>();
+  auto read = [&](auto &v, uint32_t size) {
+    v.resize(size);
+    file.read(reinterpret_cast<char *>(v.data()), static_cast<std::streamsize>(v.size() * sizeof(v[0])));
+  };
+  read(dag->positions, header.num_positions);
+  read(dag->indices, header.num_indices);
+  read(dag->clusters, header.num_clusters);
+  read(dag->groups, header.num_groups);
+  read(dag->group_children, header.num_group_children);
+  if (!file) {
+    std::cerr << "Truncated meshlet DAG file: " << path << std::endl;
+    return {};
+  }
+  if (auto reason = invalidMeshletDagReason(*dag)) {
+    std::cerr << "Invalid meshlet DAG file " << path << ": " << reason << std::endl;
+    return {};
+  }
+  return dag;
+}
+}
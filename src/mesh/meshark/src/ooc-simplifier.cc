@@ -0,0 +1,337 @@
+//
+// Created by creeper on 10/16/26.
+//
+#include <meshark/ooc-simplifier.h>
+#include <meshark/quadric.h>
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <unordered_map>
+#include <unordered_set>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace meshark {
+
+namespace {
+using CellKey = uint64_t;
+constexpr int kCoordBits = 21;
+constexpr int64_t kCoordRange = int64_t(1) << kCoordBits;
+constexpr int64_t kCoordOffset = kCoordRange / 2;
+
+CellKey packCell(const glm::i64vec3 &c) {
+  auto pack = [](int64_t x) {
+    return static_cast<uint64_t>(std::clamp<int64_t>(x + kCoordOffset, 0, kCoordRange - 1));
+  };
+  return pack(c.x) << (2 * kCoordBits) | pack(c.y) << kCoordBits | pack(c.z);
+}
+
+glm::i64vec3 unpackCell(CellKey key) {
+  auto unpack = [&](int shift) {
+    return static_cast<int64_t>((key >> shift) & (kCoordRange - 1)) - kCoordOffset;
+  };
+  return {unpack(2 * kCoordBits), unpack(kCoordBits), unpack(0)};
+}
+
+struct ClusterCell {
+  Quadric quadric;
+  glm::dvec3 position_sum{};
+  int64_t count{};
+};
+
+using ClusterTriangle = std::array<CellKey, 3>;
+
+struct ClusterTriangleHash {
+  size_t operator()(const ClusterTriangle &t) const {
+    size_t h = 0;
+    for (auto k : t)
+      h = (h ^ std::hash<CellKey>{}(k)) * 0x9e3779b97f4a7c15ull;
+    return h;
+  }
+};
+
+// Rotates t so that its smallest key comes first, which keeps the orientation.
+ClusterTriangle canonicalTriangle(const ClusterTriangle &t) {
+  int first = static_cast<int>(std::min_element(t.begin(), t.end()) - t.begin());
+  return {t[first], t[(first + 1) % 3], t[(first + 2) % 3]};
+}
+
+struct ClusterGrid {
+  static constexpr size_t kCellBytes = sizeof(std::pair<const CellKey, ClusterCell>) + 3 * sizeof(void *);
+  static constexpr size_t kTriangleBytes = sizeof(ClusterTriangle) + 3 * sizeof(void *);
+
+  explicit ClusterGrid(size_t memory_budget) : memory_budget(memory_budget) {}
+
+  void initialize(const glm::dvec3 &lo, const glm::dvec3 &hi) {
+    // A closed surface occupies roughly 4 * res^2 cells of a res^3 grid, and produces about
+    // two clustered triangles per cell.
+    size_t max_cells = std::max<size_t>(1, memory_budget / (kCellBytes + 2 * kTriangleBytes));
+    double res = std::clamp(std::floor(std::sqrt(max_cells / 4.0)), 1.0, static_cast<double>(kCoordOffset));
+    double extent = std::max({hi.x - lo.x, hi.y - lo.y, hi.z - lo.z});
+    origin = lo;
+    cell_size = extent > 0 ? extent / res : 1.0;
+    initialized = true;
+  }
+
+  [[nodiscard]] size_t bytes() const {
+    return cells.size() * kCellBytes + triangles.size() * kTriangleBytes;
+  }
+
+  [[nodiscard]] CellKey cellOf(const glm::dvec3 &p) const {
+    return packCell(glm::i64vec3(glm::floor((p - origin) / cell_size)));
+  }
+
+  void addTriangle(const glm::dvec3 &p0, const glm::dvec3 &p1, const glm::dvec3 &p2) {
+    glm::dvec3 n = glm::cross(p1 - p0, p2 - p0);
+    double len = glm::length(n);
+    ClusterTriangle t{cellOf(p0), cellOf(p1), cellOf(p2)};
+    Quadric q;
+    if (len > 0) {
+      n /= len;
+      q = Quadric::fromPlane(glm::dvec4(n, -glm::dot(n, p0)), 0.5 * len);
+    }
+    const glm::dvec3 *corners[3] = {&p0, &p1, &p2};
+    for (int i = 0; i < 3; i++) {
+      auto &cell = cells[t[i]];
+      cell.quadric += q;
+      cell.position_sum += *corners[i];
+      cell.count++;
+    }
+    if (t[0] != t[1] && t[1] != t[2] && t[0] != t[2])
+      triangles.insert(canonicalTriangle(t));
+    peak_bytes = std::max(peak_bytes, bytes());
+    while (bytes() > memory_budget && cells.size() > 1)
+      coarsen();
+  }
+
+  // Doubles the cell size, merging every 2x2x2 block of cells and dropping the triangles that collapse.
+  void coarsen() {
+    auto parent = [](CellKey key) {
+      auto c = unpackCell(key);
+      return packCell({c.x >> 1, c.y >> 1, c.z >> 1});
+    };
+    std::unordered_map<CellKey, ClusterCell> merged_cells;
+    for (auto &[key, cell] : cells) {
+      auto &merged = merged_cells[parent(key)];
+      merged.quadric += cell.quadric;
+      merged.position_sum += cell.position_sum;
+      merged.count += cell.count;
+    }
+    std::unordered_set<ClusterTriangle, ClusterTriangleHash> merged_triangles;
+    for (const auto &t : triangles) {
+      ClusterTriangle p{parent(t[0]), parent(t[1]), parent(t[2])};
+      if (p[0] != p[1] && p[1] != p[2] && p[0] != p[2])
+        merged_triangles.insert(canonicalTriangle(p));
+    }
+    cells = std::move(merged_cells);
+    triangles = std::move(merged_triangles);
+    cell_size *= 2;
+  }
+
+  [[nodiscard]] glm::dvec3 representative(CellKey key, const ClusterCell &cell) const {
+    glm::dvec3 mean = cell.position_sum / static_cast<double>(cell.count);
+    glm::dvec3 lo = origin + glm::dvec3(unpackCell(key)) * cell_size - 0.5 * cell_size;
+    return cell.quadric.boundedMinimizer(mean, lo, lo + 2.0 * cell_size);
+  }
+
+  size_t memory_budget;
+  bool initialized{false};
+  glm::dvec3 origin{};
+  double cell_size{1.0};
+  size_t peak_bytes{};
+  std::unordered_map<CellKey, ClusterCell> cells;
+  std::unordered_set<ClusterTriangle, ClusterTriangleHash> triangles;
+};
+
+// Vertex positions of the whole input, appended to an unlinked temporary file and mapped back once
+// complete. The kernel pages them in as faces reference them and drops them again under memory
+// pressure, so the table never has to fit in RAM. The file vanishes with the table.
+class PositionTable {
+ public:
+  PositionTable() = default;
+  PositionTable(const PositionTable &) = delete;
+  PositionTable &operator=(const PositionTable &) = delete;
+  ~PositionTable() {
+    if (data) munmap(data, bytes());
+    if (fd >= 0) close(fd);
+  }
+
+  bool create(const std::filesystem::path &directory) {
+    auto pattern = (directory / "meshark-positions-XXXXXX").string();
+    fd = mkstemp(pattern.data());
+    if (fd < 0) {
+      std::cerr << "Failed to create a temporary position file in " << directory << ": " << std::strerror(errno)
+                << std::endl;
+      return false;
+    }
+    unlink(pattern.c_str());
+    return true;
+  }
+
+  bool append(const glm::vec3 &p) {
+    buffer.push_back(p);
+    count++;
+    return buffer.size() < kBufferSize || flush();
+  }
+
+  // Flushes the pending positions and maps the file, after which the table is read-only.
+  bool map() {
+    if (!flush()) return false;
+    if (count == 0) return true;
+    void *mapped = mmap(nullptr, bytes(), PROT_READ, MAP_PRIVATE, fd, 0);
+    if (mapped == MAP_FAILED) {
+      std::cerr << "Failed to map the temporary position file: " << std::strerror(errno) << std::endl;
+      return false;
+    }
+    data = mapped;
+    return true;
+  }
+
+  [[nodiscard]] const glm::vec3 &operator[](size_t i) const {
+    return static_cast<const glm::vec3 *>(data)[i];
+  }
+  [[nodiscard]] size_t size() const { return count; }
+  [[nodiscard]] size_t bytes() const { return count * sizeof(glm::vec3); }
+
+ private:
+  static constexpr size_t kBufferSize = size_t(1) << 16;
+
+  bool flush() {
+    auto bytes = reinterpret_cast<const char *>(buffer.data());
+    size_t left = buffer.size() * sizeof(glm::vec3);
+    while (left > 0) {
+      auto written = write(fd, bytes, left);
+      if (written < 0) {
+        if (errno == EINTR) continue;
+        std::cerr << "Failed to write the temporary position file: " << std::strerror(errno) << std::endl;
+        return false;
+      }
+      bytes += written;
+      left -= static_cast<size_t>(written);
+    }
+    buffer.clear();
+    return true;
+  }
+
+  int fd{-1};
+  std::vector<glm::vec3> buffer;
+  size_t count{};
+  void *data{};
+};
+
+bool parseFloat(std::string_view &s, float &x) {
+  while (!s.empty() && (s.front() == ' ' || s.front() == '\t')) s.remove_prefix(1);
+  auto [ptr, ec] = std::from_chars(s.data(), s.data() + s.size(), x);
+  if (ec != std::errc()) return false;
+  s.remove_prefix(ptr - s.data());
+  return true;
+}
+
+// Parses a "v x y z" line. Both passes over the file skip the same malformed lines, so that face
+// indices resolve to the same positions.
+bool parsePosition(std::string_view s, glm::vec3 &p) {
+  if (!s.starts_with("v ")) return false;
+  s.remove_prefix(2);
+  return parseFloat(s, p.x) && parseFloat(s, p.y) && parseFloat(s, p.z);
+}
+
+// Parses the position index of the next "v/vt/vn" token of a face line.
+bool parseFaceVertex(std::string_view &s, int num_positions, int &index) {
+  while (!s.empty() && (s.front() == ' ' || s.front() == '\t')) s.remove_prefix(1);
+  if (s.empty()) return false;
+  int raw;
+  auto [ptr, ec] = std::from_chars(s.data(), s.data() + s.size(), raw);
+  if (ec != std::errc()) return false;
+  s.remove_prefix(ptr - s.data());
+  while (!s.empty() && s.front() != ' ' && s.front() != '\t') s.remove_prefix(1);
+  index = raw < 0 ? num_positions + raw : raw - 1;
+  return index >= 0 && index < num_positions;
+}
+}
+
+OutOfCoreSimplifyResult simplifyOutOfCore(const std::filesystem::path &path, const OutOfCoreSimplifyOptions &options) {
+  OutOfCoreSimplifyResult result;
+  std::ifstream file(path);
+  if (!file.is_open()) {
+    std::cerr << "Failed to open file: " << path << std::endl;
+    return result;
+  }
+  // The first pass spills the positions to disk and measures the bounding box, the second one
+  // streams the faces into a grid that covers all of them.
+  PositionTable positions;
+  std::error_code error;
+  auto spill_directory = options.spill_directory.empty() ? std::filesystem::temp_directory_path(error)
+                                                         : options.spill_directory;
+  if (error) {
+    std::cerr << "No temporary directory to spill positions to: " << error.message() << std::endl;
+    return result;
+  }
+  if (!positions.create(spill_directory)) return result;
+  glm::dvec3 lo(std::numeric_limits<double>::max()), hi(std::numeric_limits<double>::lowest());
+  std::string line;
+  glm::vec3 p;
+  while (std::getline(file, line)) {
+    if (!parsePosition(line, p)) continue;
+    if (!positions.append(p)) return result;
+    lo = glm::min(lo, glm::dvec3(p));
+    hi = glm::max(hi, glm::dvec3(p));
+  }
+  if (!positions.map()) return result;
+  file.clear();
+  file.seekg(0);
+
+  ClusterGrid grid(options.memory_budget);
+  if (positions.size() > 0) grid.initialize(lo, hi);
+  int num_positions = 0;
+  std::vector<int> polygon;
+  while (std::getline(file, line)) {
+    std::string_view s(line);
+    if (s.starts_with("v ")) {
+      num_positions += parsePosition(s, p);
+    } else if (s.starts_with("f ")) {
+      s.remove_prefix(2);
+      polygon.clear();
+      int index;
+      while (parseFaceVertex(s, num_positions, index))
+        polygon.push_back(index);
+      if (polygon.size() < 3) continue;
+      for (size_t i = 1; i + 1 < polygon.size(); i++) {
+        grid.addTriangle(positions[polygon[0]], positions[polygon[i]], positions[polygon[i + 1]]);
+        result.num_input_triangles++;
+      }
+    }
+  }
+  result.num_input_vertices = positions.size();
+  result.cell_size = grid.cell_size;
+  result.peak_grid_bytes = grid.peak_bytes;
+  result.position_bytes = positions.bytes();
+
+  std::vector<ClusterTriangle> triangles(grid.triangles.begin(), grid.triangles.end());
+  std::sort(triangles.begin(), triangles.end());
+  std::vector<CellKey> used_cells;
+  used_cells.reserve(3 * triangles.size());
+  for (const auto &t : triangles)
+    used_cells.insert(used_cells.end(), t.begin(), t.end());
+  std::sort(used_cells.begin(), used_cells.end());
+  used_cells.erase(std::unique(used_cells.begin(), used_cells.end()), used_cells.end());
+
+  auto obj = std::make_unique<WavefrontObj>();
+  obj->positions.reserve(used_cells.size());
+  for (auto key : used_cells)
+    obj->positions.emplace_back(grid.representative(key, grid.cells.at(key)));
+  for (const auto &t : triangles) {
+    obj->face_splits.push_back(static_cast<int>(obj->face_vertices.size()));
+    for (auto key : t) {
+      WavefrontObj::FaceVertex fv;
+      fv.v = static_cast<int>(std::lower_bound(used_cells.begin(), used_cells.end(), key) - used_cells.begin());
+      obj->face_vertices.push_back(fv);
+    }
+  }
+  obj->face_splits.push_back(static_cast<int>(obj->face_vertices.size()));
+  result.mesh = std::move(obj);
+  return result;
+}
+}
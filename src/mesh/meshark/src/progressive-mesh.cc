@@ -0,0 +1,134 @@
+//
+// Created by creeper on 10/16/26.
+//
+#include <meshark/progressive-mesh.h>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <utility>
+
+namespace meshark {
+
+namespace {
+struct ProgressiveMeshHeader {
+  char magic[4]{'M', 'K', 'P', 'M'};
+  uint32_t version{1};
+  uint32_t num_base_vertices{};
+  uint32_t num_base_faces{};
+  uint32_t num_records{};
+};
+}
+
+int ProgressiveMesh::numCollapsesForFaceRatio(double face_ratio) const {
+  // Every collapse removes exactly two faces.
+  double faces_to_remove = (1.0 - std::clamp(face_ratio, 0.0, 1.0)) * num_base_faces;
+  return std::min(static_cast<int>(records.size()), static_cast<int>(std::ceil(faces_to_remove / 2)));
+}
+
+bool writeProgressiveMesh(const ProgressiveMesh &pm, const std::filesystem::path &path) {
+  std::ofstream file(path, std::ios::binary);
+  if (!file.is_open()) {
+    std::cerr << "Failed to open file: " << path << std::endl;
+    return false;
+  }
+  ProgressiveMeshHeader header;
+  header.num_base_vertices = pm.num_base_vertices;
+  header.num_base_faces = pm.num_base_faces;
+  header.num_records = pm.records.size();
+  file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+  file.write(reinterpret_cast<const char *>(pm.records.data()),
+             static_cast<std::streamsize>(pm.records.size() * sizeof(VertexSplitRecord)));
+  file.close();
+  if (!file) {
+    std::cerr << "Failed to write progressive mesh: " << path << std::endl;
+    return false;
+  }
+  return true;
+}
+
+std::unique_ptr<ProgressiveMesh> readProgressiveMesh(const std::filesystem::path &path) {
+  std::ifstream file(path, std::ios::binary);
+  if (!file.is_open()) {
+    std::cerr << "Failed to open file: " << path << std::endl;
+    return {};
+  }
+  ProgressiveMeshHeader header, expected;
+  file.read(reinterpret_cast<char *>(&header), sizeof(header));
+  if (!file || std::memcmp(header.magic, expected.magic, 4) != 0 || header.version != expected.version) {
+    std::cerr << "Not a progressive mesh file: " << path << std::endl;
+    return {};
+  }
+  auto pm = std::make_unique<ProgressiveMesh>();
+  pm->num_base_vertices = static_cast<int>(header.num_base_vertices);
+  pm->num_base_faces = static_cast<int>(header.num_base_faces);
+  pm->records.resize(header.num_records);
+  file.read(reinterpret_cast<char *>(pm->records.data()),
+            static_cast<std::streamsize>(pm->records.size() * sizeof(VertexSplitRecord)));
+  if (!file) {
+    std::cerr << "Truncated progressive mesh file: " << path << std::endl;
+    return {};
+  }
+  return pm;
+}
+
+std::unique_ptr<WavefrontObj> extractLevelOfDetail(const WavefrontObj &base, const ProgressiveMesh &pm,
+                                                   int num_collapses) {
+  int num_faces = static_cast<int>(base.face_splits.size()) - 1;
+  if (static_cast<int>(base.positions.size()) != pm.num_base_vertices || num_faces != pm.num_base_faces) {
+    std::cerr << "Progressive mesh does not match its base mesh" << std::endl;
+    return {};
+  }
+  std::vector<glm::vec3> positions = base.positions;
+  // merged_into[v] == v for live vertices, otherwise the vertex v was collapsed into.
+  std::vector<int> merged_into(positions.size());
+  for (int i = 0; i < static_cast<int>(merged_into.size()); i++)
+    merged_into[i] = i;
+  std::vector<char> face_alive(num_faces, 1);
+  num_collapses = std::clamp(num_collapses, 0, static_cast<int>(pm.records.size()));
+  auto liveVertex = [&](int v) {
+    return v >= 0 && v < static_cast<int>(merged_into.size()) && merged_into[v] == v;
+  };
+  for (int i = 0; i < num_collapses; i++) {
+    const auto &record = pm.records[i];
+    // Collapsing anything but two distinct live vertices could link them into a cycle.
+    bool valid = liveVertex(record.kept_vertex) && liveVertex(record.removed_vertex)
+        && record.kept_vertex != record.removed_vertex;
+    for (int f : record.removed_faces)
+      valid = valid && f >= 0 && f < num_faces;
+    if (!valid) {
+      std::cerr << "Progressive mesh record " << i << " is not a collapse of its base mesh" << std::endl;
+      return {};
+    }
+    merged_into[record.removed_vertex] = record.kept_vertex;
+    positions[record.kept_vertex] = record.new_position;
+    for (int f : record.removed_faces)
+      face_alive[f] = 0;
+  }
+  auto find = [&](int v) {
+    int root = v;
+    while (merged_into[root] != root) root = merged_into[root];
+    while (merged_into[v] != root) v = std::exchange(merged_into[v], root);
+    return root;
+  };
+  auto obj = std::make_unique<WavefrontObj>();
+  std::vector<int> new_index(positions.size(), -1);
+  for (int v = 0; v < static_cast<int>(positions.size()); v++) {
+    if (merged_into[v] != v) continue;
+    new_index[v] = static_cast<int>(obj->positions.size());
+    obj->positions.push_back(positions[v]);
+  }
+  for (int f = 0; f < num_faces; f++) {
+    if (!face_alive[f]) continue;
+    obj->face_splits.push_back(static_cast<int>(obj->face_vertices.size()));
+    for (int j = base.face_splits[f]; j < base.face_splits[f + 1]; j++) {
+      WavefrontObj::FaceVertex fv;
+      fv.v = new_index[find(base.face_vertices[j].v)];
+      obj->face_vertices.push_back(fv);
+    }
+  }
+  obj->face_splits.push_back(static_cast<int>(obj->face_vertices.size()));
+  return obj;
+}
+}
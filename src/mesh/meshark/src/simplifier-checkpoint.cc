@@ -0,0 +1,215 @@
+//
+// Created by creeper on 10/16/26.
+//
+#include <meshark/mesh-simplifier.h>
+#include <meshark/mesh-io.h>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+namespace meshark {
+
+namespace {
+struct SimplifierCheckpointHeader {
+  char magic[4]{'M', 'K', 'C', 'P'};
+  uint32_t version{1};
+  uint32_t cost_model{};
+  uint32_t num_vertices{};
+  uint32_t num_faces{};
+  uint32_t num_edges{};
+  uint32_t num_original_edges{};
+  uint32_t initialized{};
+  uint32_t recording{};
+  uint32_t num_recorded_vertices{};
+  uint32_t num_recorded_faces{};
+  uint32_t num_collapse_records{};
+  double accumulated_error{};
+};
+
+// Checks everything restoreMesh and the resuming simplifier index with, so that a damaged file is
+// rejected instead of crashing them. The topology itself is left to restoreMesh.
+const char *invalidCheckpointReason(const SimplifierCheckpoint &checkpoint) {
+  if (checkpoint.cost_model != SimplifyCostModel::kQuadricError && checkpoint.cost_model != SimplifyCostModel::kMemoryless)
+    return "unknown cost model";
+  auto num_vertices = static_cast<int64_t>(checkpoint.positions.size());
+  auto num_codes = static_cast<int64_t>(checkpoint.face_vertices.size());
+  auto num_edges = static_cast<int64_t>(checkpoint.edge_half_edges.size());
+  for (int v : checkpoint.face_vertices)
+    if (v < 0 || v >= num_vertices) return "face vertex out of range";
+  for (int code : checkpoint.vertex_half_edges)
+    if (code < 0 || code >= num_codes) return "vertex half-edge out of range";
+  for (int code : checkpoint.edge_half_edges)
+    if (code < 0 || code >= num_codes) return "edge half-edge out of range";
+  if (checkpoint.num_original_edges < num_edges) return "more edges than the input had";
+  std::vector<char> used(checkpoint.num_original_edges, 0);
+  for (int id : checkpoint.edge_ids) {
+    if (id < 0 || id >= checkpoint.num_original_edges || used[id]) return "edge ids out of range or repeated";
+    used[id] = 1;
+  }
+  for (Real cost : checkpoint.edge_costs)
+    if (std::isnan(cost)) return "edge cost is not a number";
+  if (checkpoint.recording) {
+    if (checkpoint.num_recorded_vertices < num_vertices
+        || checkpoint.num_recorded_faces < static_cast<int64_t>(checkpoint.face_ids.size()))
+      return "more elements than recorded";
+    for (int id : checkpoint.vertex_ids)
+      if (id < 0 || id >= checkpoint.num_recorded_vertices) return "vertex id out of range";
+    for (int id : checkpoint.face_ids)
+      if (id < 0 || id >= checkpoint.num_recorded_faces) return "face id out of range";
+  }
+  return nullptr;
+}
+}
+
+int SimplifierCheckpoint::halfEdgeCode(const GeometryMesh &mesh, HalfEdge h) {
+  auto start = h->face->halfEdge();
+  int corner = h == start ? 0 : h == start->next ? 1 : 2;
+  return 3 * mesh.index(h->face) + corner;
+}
+
+HalfEdge SimplifierCheckpoint::halfEdgeFromCode(const GeometryMesh &mesh, int code) {
+  auto h = mesh.face(code / 3)->halfEdge();
+  for (int corner = code % 3; corner > 0; corner--)
+    h = h->next;
+  return h;
+}
+
+std::unique_ptr<GeometryMesh> SimplifierCheckpoint::restoreMesh() const {
+  WavefrontObj obj;
+  obj.positions = positions;
+  obj.face_vertices.reserve(face_vertices.size());
+  for (int v : face_vertices) {
+    WavefrontObj::FaceVertex fv;
+    fv.v = v;
+    obj.face_vertices.push_back(fv);
+  }
+  obj.face_splits.reserve(face_vertices.size() / 3 + 1);
+  for (size_t i = 0; i <= face_vertices.size(); i += 3)
+    obj.face_splits.push_back(static_cast<int>(i));
+  auto invalid = [](const char *reason) {
+    std::cerr << "Invalid simplifier checkpoint: " << reason << std::endl;
+    return std::unique_ptr<GeometryMesh>();
+  };
+  if (face_vertices.empty() || !isClosedManifold(obj)) return invalid("not a closed manifold");
+  auto mesh = std::make_unique<GeometryMesh>();
+  mesh->buildFromWavefrontObj(obj);
+  if (mesh->numVertices() != positions.size() || mesh->numEdges() != edge_half_edges.size()
+      || vertex_half_edges.size() != positions.size())
+    return invalid("element counts do not match the faces");
+  // Faces start at their first corner as before; fans and edge directions get their old half-edges back.
+  for (auto v : mesh->vertices()) {
+    auto h = halfEdgeFromCode(*mesh, vertex_half_edges[mesh->index(v)]);
+    if (h->tail != v) return invalid("vertex half-edge does not start at its vertex");
+    v->halfEdge() = h;
+  }
+  std::vector<char> restored(mesh->numEdges(), 0);
+  for (int code : edge_half_edges) {
+    auto h = halfEdgeFromCode(*mesh, code);
+    if (restored[mesh->index(h->edge)]) return invalid("edge half-edges repeat an edge");
+    restored[mesh->index(h->edge)] = 1;
+    h->edge->halfEdge() = h;
+  }
+  return mesh;
+}
+
+bool writeSimplifierCheckpoint(const SimplifierCheckpoint &checkpoint, const std::filesystem::path &path) {
+  std::ofstream file(path, std::ios::binary);
+  if (!file.is_open()) {
+    std::cerr << "Failed to open file: " << path << std::endl;
+    return false;
+  }
+  SimplifierCheckpointHeader header;
+  header.cost_model = static_cast<uint32_t>(checkpoint.cost_model);
+  header.num_vertices = checkpoint.positions.size();
+  header.num_faces = checkpoint.face_vertices.size() / 3;
+  header.num_edges = checkpoint.edge_half_edges.size();
+  header.num_original_edges = checkpoint.num_original_edges;
+  header.initialized = !checkpoint.edge_costs.empty();
+  header.recording = checkpoint.recording;
+  header.num_recorded_vertices = checkpoint.num_recorded_vertices;
+  header.num_recorded_faces = checkpoint.num_recorded_faces;
+  header.num_collapse_records = checkpoint.collapse_records.size();
+  header.accumulated_error = checkpoint.accumulated_error;
+  auto write = [&](const auto &v) {
+    file.write(reinterpret_cast<const char *>(v.data()),
+               static_cast<std::streamsize>(v.size() * sizeof(v[0])));
+  };
+  file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+  write(checkpoint.positions);
+  write(checkpoint.face_vertices);
+  write(checkpoint.vertex_half_edges);
+  write(checkpoint.edge_half_edges);
+  write(checkpoint.edge_costs);
+  write(checkpoint.edge_ids);
+  write(checkpoint.quadrics);
+  write(checkpoint.vertex_ids);
+  write(checkpoint.face_ids);
+  write(checkpoint.collapse_records);
+  file.close();
+  if (!file) {
+    std::cerr << "Failed to write checkpoint: " << path << std::endl;
+    return false;
+  }
+  return true;
+}
+
+std::unique_ptr<SimplifierCheckpoint> readSimplifierCheckpoint(const std::filesystem::path &path) {
+  std::ifstream file(path, std::ios::binary);
+  if (!file.is_open()) {
+    std::cerr << "Failed to open file: " << path << std::endl;
+    return {};
+  }
+  SimplifierCheckpointHeader header, expected;
+  file.read(reinterpret_cast<char *>(&header), sizeof(header));
+  if (!file || std::memcmp(header.magic, expected.magic, 4) != 0 || header.version != expected.version) {
+    std::cerr << "Not a simplifier checkpoint file: " << path << std::endl;
+    return {};
+  }
+  auto checkpoint = std::make_unique<SimplifierCheckpoint>();
+  checkpoint->cost_model = static_cast<SimplifyCostModel>(header.cost_model);
+  checkpoint->num_original_edges = static_cast<int>(header.num_original_edges);
+  checkpoint->accumulated_error = header.accumulated_error;
+  checkpoint->recording = header.recording;
+  checkpoint->num_recorded_vertices = static_cast<int>(header.num_recorded_vertices);
+  checkpoint->num_recorded_faces = static_cast<int>(header.num_recorded_faces);
+  bool quadrics = header.initialized && checkpoint->cost_model == SimplifyCostModel::kQuadricError;
+  uint64_t num_vertices = header.num_vertices, num_faces = header.num_faces, num_edges = header.num_edges;
+  uint64_t num_initialized = header.initialized ? num_edges : 0;
+  // Sizes are checked against the file before anything is allocated for them.
+  uint64_t payload = num_vertices * (sizeof(glm::vec3) + sizeof(int)) + 3 * num_faces * sizeof(int)
+      + num_edges * sizeof(int) + num_initialized * (sizeof(Real) + sizeof(int))
+      + (quadrics ? num_vertices * sizeof(glm::mat4) : 0)
+      + (header.recording ? (num_vertices + num_faces) * sizeof(int) : 0)
+      + uint64_t(header.num_collapse_records) * sizeof(VertexSplitRecord);
+  std::error_code ec;
+  auto file_size = std::filesystem::file_size(path, ec);
+  if (ec || file_size < sizeof(header) || payload > file_size - sizeof(header)) {
+    std::cerr << "Truncated simplifier checkpoint file: " << path << std::endl;
+    return {};
+  }
+  auto read = [&](auto &v, uint64_t size) {
+    v.resize(size);
+    file.read(reinterpret_cast<char *>(v.data()), static_cast<std::streamsize>(v.size() * sizeof(v[0])));
+  };
+  read(checkpoint->positions, num_vertices);
+  read(checkpoint->face_vertices, 3 * num_faces);
+  read(checkpoint->vertex_half_edges, num_vertices);
+  read(checkpoint->edge_half_edges, num_edges);
+  read(checkpoint->edge_costs, num_initialized);
+  read(checkpoint->edge_ids, num_initialized);
+  read(checkpoint->quadrics, quadrics ? num_vertices : 0);
+  read(checkpoint->vertex_ids, header.recording ? num_vertices : 0);
+  read(checkpoint->face_ids, header.recording ? num_faces : 0);
+  read(checkpoint->collapse_records, header.num_collapse_records);
+  if (!file) {
+    std::cerr << "Truncated simplifier checkpoint file: " << path << std::endl;
+    return {};
+  }
+  if (auto reason = invalidCheckpointReason(*checkpoint)) {
+    std::cerr << "Invalid simplifier checkpoint file " << path << ": " << reason << std::endl;
+    return {};
+  }
+  return checkpoint;
+}
+}
@@ -0,0 +1,441 @@
+//
+// Created by creeper on 10/16/26.
+//
+#include <meshark/sparse-matrix.h>
+#include <mystl/parallel-for.h>
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <iostream>
+#include <numeric>
+#include <utility>
+
+namespace meshark {
+
+namespace {
+// Rows per chunk of the parallel loops. Chunks are fixed, so partial sums do not depend on the number
+// of threads.
+constexpr int kChunkSize = 4096;
+
+int numChunks(int n) {
+  return (n + kChunkSize - 1) / kChunkSize;
+}
+
+template<typename Func>
+void forEachChunk(int n, Func &&func, int num_threads) {
+  mystl::parallel_for(0, numChunks(n), [&](int chunk) {
+    func(chunk * kChunkSize, std::min(n, (chunk + 1) * kChunkSize));
+  }, num_threads, 1);
+}
+
+// Sums of K terms over [0, n), term(i) returning the K summands of row i.
+template<int K, typename Term>
+std::array<double, K> sumRows(int n, Term &&term, int num_threads) {
+  std::vector<std::array<double, K>> partial(numChunks(n));
+  mystl::parallel_for(0, numChunks(n), [&](int chunk) {
+    std::array<double, K> sums{};
+    int end = std::min(n, (chunk + 1) * kChunkSize);
+    for (int i = chunk * kChunkSize; i < end; i++) {
+      auto t = term(i);
+      for (int k = 0; k < K; k++)
+        sums[k] += t[k];
+    }
+    partial[chunk] = sums;
+  }, num_threads, 1);
+  std::array<double, K> total{};
+  for (const auto &sums : partial)
+    for (int k = 0; k < K; k++)
+      total[k] += sums[k];
+  return total;
+}
+
+// Factorizations tried before giving up: unshifted, then shifts of 1e-3 growing fourfold, the last
+// one adding about 65 times the diagonal.
+constexpr int kMaxIncompleteCholeskyShifts = 10;
+
+// Factors a + shift * diag(a) into lower, false if a pivot is not positive.
+bool tryIncompleteCholesky(const CsrMatrix &a, double shift, CsrMatrix &lower) {
+  int n = a.rows();
+  lower.row_offsets.assign(n + 1, 0);
+  lower.columns.clear();
+  lower.values.clear();
+  for (int i = 0; i < n; i++) {
+    int begin = static_cast<int>(lower.columns.size());
+    double diagonal = 0.0;
+    for (int k = a.row_offsets[i]; k < a.row_offsets[i + 1]; k++) {
+      int j = a.columns[k];
+      if (j == i) diagonal = a.values[k] * (1.0 + shift);
+      if (j >= i) continue;
+      // l_ij = (a_ij - sum over m < j of l_im l_jm) / l_jj, merging the sorted rows i and j.
+      double sum = a.values[k];
+      int p = begin;
+      int q = lower.row_offsets[j];
+      int q_end = lower.row_offsets[j + 1] - 1;
+      while (p < static_cast<int>(lower.columns.size()) && q < q_end) {
+        if (lower.columns[p] < lower.columns[q])
+          p++;
+        else if (lower.columns[p] > lower.columns[q])
+          q++;
+        else
+          sum -= lower.values[p++] * lower.values[q++];
+      }
+      lower.columns.push_back(j);
+      lower.values.push_back(sum / lower.values[q_end]);
+    }
+    for (int k = begin; k < static_cast<int>(lower.values.size()); k++)
+      diagonal -= lower.values[k] * lower.values[k];
+    if (!(diagonal > 0.0)) return false;
+    lower.columns.push_back(i);
+    lower.values.push_back(std::sqrt(diagonal));
+    lower.row_offsets[i + 1] = static_cast<int>(lower.columns.size());
+  }
+  return true;
+}
+
+// Leaves of the nested dissection are ordered as they were visited.
+constexpr int kDissectionLeafSize = 64;
+
+struct Dissection {
+  const CsrMatrix &a;
+  // Part that every vertex currently belongs to, -1 once ordered.
+  std::vector<int> owner;
+  std::vector<int> level;
+  std::vector<int> order;
+  int num_parts{1};
+
+  // Visits the vertices of part reachable from start in breadth-first order, setting their levels, and
+  // moves them to new_part.
+  std::vector<int> search(int part, int start, int new_part) {
+    std::vector<int> visited{start};
+    int visiting = -2 - part;
+    owner[start] = visiting;
+    level[start] = 0;
+    for (size_t head = 0; head < visited.size(); head++) {
+      int i = visited[head];
+      for (int k = a.row_offsets[i]; k < a.row_offsets[i + 1]; k++) {
+        int j = a.columns[k];
+        if (owner[j] != part) continue;
+        owner[j] = visiting;
+        level[j] = level[i] + 1;
+        visited.push_back(j);
+      }
+    }
+    for (int i : visited)
+      owner[i] = new_part;
+    return visited;
+  }
+
+  // Orders the vertices of part into order[begin, begin + vertices.size()), one component after the
+  // other.
+  void dissect(int part, const std::vector<int> &vertices, int begin) {
+    for (int start : vertices) {
+      if (owner[start] != part) continue;
+      int component = num_parts++;
+      auto visited = search(part, start, component);
+      visited = search(component, visited.back(), component);
+      bisect(visited, begin);
+      begin += static_cast<int>(visited.size());
+    }
+  }
+
+  // Splits a component at a level of a search from a peripheral vertex, visited in level order.
+  void bisect(const std::vector<int> &visited, int begin) {
+    int size = static_cast<int>(visited.size());
+    int depth = level[visited.back()];
+    if (size <= kDissectionLeafSize || depth < 2) {
+      std::copy(visited.begin(), visited.end(), order.begin() + begin);
+      for (int i : visited)
+        owner[i] = -1;
+      return;
+    }
+    // The smallest level that leaves at least a third of the vertices on either side, or the middle one.
+    std::vector<int> level_sizes(depth + 1);
+    for (int i : visited)
+      level_sizes[level[i]]++;
+    int middle = std::clamp(level[visited[size / 2]], 1, depth - 1);
+    for (int l = 1, below = level_sizes[0]; l < depth; below += level_sizes[l++]) {
+      if (3 * below >= size && 3 * (size - below - level_sizes[l]) >= size && level_sizes[l] < level_sizes[middle])
+        middle = l;
+    }
+    int low_part = num_parts++;
+    int high_part = num_parts++;
+    std::vector<int> low, high;
+    int end = begin + size;
+    int separator = end;
+    for (int i : visited) {
+      if (level[i] < middle) {
+        owner[i] = low_part;
+        low.push_back(i);
+      } else if (level[i] > middle) {
+        owner[i] = high_part;
+        high.push_back(i);
+      } else {
+        owner[i] = -1;
+        order[--separator] = i;
+      }
+    }
+    std::reverse(order.begin() + separator, order.begin() + end);
+    dissect(low_part, low, begin);
+    dissect(high_part, high, begin + static_cast<int>(low.size()));
+  }
+};
+
+std::vector<int> nestedDissection(const CsrMatrix &a) {
+  int n = a.rows();
+  Dissection dissection{a, std::vector<int>(n, 0), std::vector<int>(n), std::vector<int>(n)};
+  if (n == 0) return {};
+  std::vector<int> vertices(n);
+  std::iota(vertices.begin(), vertices.end(), 0);
+  dissection.dissect(0, vertices, 0);
+  return std::move(dissection.order);
+}
+}
+
+std::vector<double> CsrMatrix::diagonal() const {
+  std::vector<double> d(rows());
+  for (int i = 0; i < rows(); i++) {
+    auto begin = columns.begin() + row_offsets[i];
+    auto end = columns.begin() + row_offsets[i + 1];
+    auto it = std::lower_bound(begin, end, i);
+    if (it != end && *it == i) d[i] = values[it - columns.begin()];
+  }
+  return d;
+}
+
+void CsrMatrix::multiply(const std::vector<double> &x, std::vector<double> &y, int num_threads) const {
+  y.resize(rows());
+  forEachChunk(rows(), [&](int begin, int end) {
+    const int *cols = columns.data();
+    const double *vals = values.data();
+    const double *xs = x.data();
+    for (int i = begin; i < end; i++) {
+      double sum = 0.0;
+      for (int k = row_offsets[i]; k < row_offsets[i + 1]; k++)
+        sum += vals[k] * xs[cols[k]];
+      y[i] = sum;
+    }
+  }, num_threads);
+}
+
+std::optional<IncompleteCholesky> factorIncompleteCholesky(const CsrMatrix &a) {
+  for (double d : a.diagonal()) {
+    if (!(d > 0.0) || !std::isfinite(d)) {
+      std::cerr << "Incomplete Cholesky needs a positive finite diagonal" << std::endl;
+      return std::nullopt;
+    }
+  }
+  IncompleteCholesky factor;
+  for (int attempt = 0; attempt < kMaxIncompleteCholeskyShifts; attempt++) {
+    if (tryIncompleteCholesky(a, factor.shift, factor.lower)) return factor;
+    factor.shift = factor.shift == 0.0 ? 1e-3 : factor.shift * 4.0;
+  }
+  std::cerr << "Incomplete Cholesky broke down with a shift of " << factor.shift / 4.0 << std::endl;
+  return std::nullopt;
+}
+
+void IncompleteCholesky::solve(const std::vector<double> &r, std::vector<double> &z) const {
+  int n = lower.rows();
+  z.resize(n);
+  for (int i = 0; i < n; i++) {
+    double sum = r[i];
+    int end = lower.row_offsets[i + 1] - 1;
+    for (int k = lower.row_offsets[i]; k < end; k++)
+      sum -= lower.values[k] * z[lower.columns[k]];
+    z[i] = sum / lower.values[end];
+  }
+  // L^T z = y by columns of L^T, that is by rows of L.
+  for (int i = n - 1; i >= 0; i--) {
+    int end = lower.row_offsets[i + 1] - 1;
+    z[i] /= lower.values[end];
+    for (int k = lower.row_offsets[i]; k < end; k++)
+      z[lower.columns[k]] -= lower.values[k] * z[i];
+  }
+}
+
+ConjugateGradientSolver::ConjugateGradientSolver(CsrMatrix a, const ConjugateGradientOptions &options)
+    : matrix(std::move(a)), options(options) {
+  if (options.preconditioner == Preconditioner::kIncompleteCholesky) {
+    factor = factorIncompleteCholesky(matrix);
+    if (factor) return;
+    std::cerr << "Falling back to Jacobi preconditioning" << std::endl;
+  }
+  if (options.preconditioner != Preconditioner::kNone) {
+    inverse_diagonal = matrix.diagonal();
+    for (double &d : inverse_diagonal)
+      d = d != 0.0 ? 1.0 / d : 1.0;
+  }
+}
+
+ConjugateGradientResult ConjugateGradientSolver::solve(const std::vector<double> &b, std::vector<double> &x) const {
+  const CsrMatrix &a = matrix;
+  int n = a.rows();
+  int num_threads = options.num_threads;
+  ConjugateGradientResult result;
+  x.resize(n);
+  bool factored = factor.has_value();
+  std::vector<double> r(n), z(n), p(n), ap(n);
+  // Diagonal preconditioners are applied row by row inside the fused loops.
+  auto precondition = [&](int i) {
+    if (factored) return;
+    z[i] = inverse_diagonal.empty() ? r[i] : r[i] * inverse_diagonal[i];
+  };
+  auto dotRz = [&](std::array<double, 2> &sums) {
+    if (!factored) return;
+    factor->solve(r, z);
+    sums[1] = sumRows<1>(n, [&](int i) { return std::array{r[i] * z[i]}; }, num_threads)[0];
+  };
+  double b_norm = std::sqrt(sumRows<1>(n, [&](int i) { return std::array{b[i] * b[i]}; }, num_threads)[0]);
+  if (b_norm == 0.0) {
+    std::fill(x.begin(), x.end(), 0.0);
+    result.converged = true;
+    return result;
+  }
+  a.multiply(x, ap, num_threads);
+  auto sums = sumRows<2>(n, [&](int i) {
+    r[i] = b[i] - ap[i];
+    precondition(i);
+    return std::array{r[i] * r[i], r[i] * z[i]};
+  }, num_threads);
+  dotRz(sums);
+  std::copy(z.begin(), z.end(), p.begin());
+  double rr = sums[0];
+  double rz = sums[1];
+  while (true) {
+    result.residual = std::sqrt(rr) / b_norm;
+    if (result.residual <= options.tolerance) {
+      result.converged = true;
+      break;
+    }
+    if (result.iterations >= options.max_iterations) break;
+    a.multiply(p, ap, num_threads);
+    double pap = sumRows<1>(n, [&](int i) { return std::array{p[i] * ap[i]}; }, num_threads)[0];
+    // A is not positive definite along p.
+    if (!(pap > 0.0)) break;
+    double alpha = rz / pap;
+    double previous_rz = rz;
+    sums = sumRows<2>(n, [&](int i) {
+      x[i] += alpha * p[i];
+      r[i] -= alpha * ap[i];
+      precondition(i);
+      return std::array{r[i] * r[i], r[i] * z[i]};
+    }, num_threads);
+    dotRz(sums);
+    rr = sums[0];
+    rz = sums[1];
+    double beta = rz / previous_rz;
+    forEachChunk(n, [&](int begin, int end) {
+      for (int i = begin; i < end; i++)
+        p[i] = z[i] + beta * p[i];
+    }, num_threads);
+    result.iterations++;
+  }
+  return result;
+}
+
+ConjugateGradientResult solveConjugateGradient(const CsrMatrix &a, const std::vector<double> &b,
+                                               std::vector<double> &x, const ConjugateGradientOptions &options) {
+  return ConjugateGradientSolver(a, options).solve(b, x);
+}
+
+std::unique_ptr<SparseCholesky> factorCholesky(const CsrMatrix &a) {
+  int n = a.rows();
+  auto factor = std::make_unique<SparseCholesky>();
+  factor->permutation = nestedDissection(a);
+  std::vector<int> inverse(n);
+  for (int k = 0; k < n; k++)
+    inverse[factor->permutation[k]] = k;
+  // Elimination tree of P A P^T, with path compression through ancestor.
+  std::vector<int> parent(n, -1), ancestor(n, -1);
+  for (int k = 0; k < n; k++) {
+    int row = factor->permutation[k];
+    for (int p = a.row_offsets[row]; p < a.row_offsets[row + 1]; p++) {
+      for (int i = inverse[a.columns[p]]; i != -1 && i < k;) {
+        int next = ancestor[i];
+        ancestor[i] = k;
+        if (next == -1) parent[i] = k;
+        i = next;
+      }
+    }
+  }
+  // Row k of L has its nonzeros on the paths from the nonzeros of row k of P A P^T up the tree to k,
+  // returned in stack[top, n) in an order that solves row k.
+  std::vector<int> mark(n, -1), stack(n), path(n);
+  auto reach = [&](int k) {
+    int top = n;
+    mark[k] = k;
+    int row = factor->permutation[k];
+    for (int p = a.row_offsets[row]; p < a.row_offsets[row + 1]; p++) {
+      int i = inverse[a.columns[p]];
+      if (i > k) continue;
+      int length = 0;
+      for (; mark[i] != k; i = parent[i]) {
+        path[length++] = i;
+        mark[i] = k;
+      }
+      while (length > 0)
+        stack[--top] = path[--length];
+    }
+    return top;
+  };
+  std::vector<int> counts(n, 1);
+  for (int k = 0; k < n; k++)
+    for (int top = reach(k); top < n; top++)
+      counts[stack[top]]++;
+  factor->column_offsets.assign(n + 1, 0);
+  for (int k = 0; k < n; k++)
+    factor->column_offsets[k + 1] = factor->column_offsets[k] + counts[k];
+  factor->rows.resize(factor->column_offsets[n]);
+  factor->values.resize(factor->column_offsets[n]);
+  std::vector<int> next(factor->column_offsets.begin(), factor->column_offsets.end() - 1);
+  std::vector<double> x(n);
+  std::fill(mark.begin(), mark.end(), -1);
+  for (int k = 0; k < n; k++) {
+    // Solve L[0, k) l_k = a_k for row k, then its diagonal.
+    int top = reach(k);
+    int row = factor->permutation[k];
+    for (int p = a.row_offsets[row]; p < a.row_offsets[row + 1]; p++) {
+      int i = inverse[a.columns[p]];
+      if (i <= k) x[i] = a.values[p];
+    }
+    double diagonal = x[k];
+    x[k] = 0.0;
+    for (; top < n; top++) {
+      int i = stack[top];
+      double l = x[i] / factor->values[factor->column_offsets[i]];
+      x[i] = 0.0;
+      for (int p = factor->column_offsets[i] + 1; p < next[i]; p++)
+        x[factor->rows[p]] -= factor->values[p] * l;
+      diagonal -= l * l;
+      factor->rows[next[i]] = k;
+      factor->values[next[i]++] = l;
+    }
+    if (!(diagonal > 0.0)) {
+      std::cerr << "Cholesky factorization needs a positive definite matrix" << std::endl;
+      return nullptr;
+    }
+    factor->rows[next[k]] = k;
+    factor->values[next[k]++] = std::sqrt(diagonal);
+  }
+  return factor;
+}
+
+void SparseCholesky::solve(const std::vector<double> &b, std::vector<double> &x) const {
+  int n = static_cast<int>(permutation.size());
+  std::vector<double> y(n);
+  for (int k = 0; k < n; k++)
+    y[k] = b[permutation[k]];
+  for (int j = 0; j < n; j++) {
+    y[j] /= values[column_offsets[j]];
+    for (int p = column_offsets[j] + 1; p < column_offsets[j + 1]; p++)
+      y[rows[p]] -= values[p] * y[j];
+  }
+  for (int j = n - 1; j >= 0; j--) {
+    for (int p = column_offsets[j] + 1; p < column_offsets[j + 1]; p++)
+      y[j] -= values[p] * y[rows[p]];
+    y[j] /= values[column_offsets[j]];
+  }
+  x.resize(n);
+  for (int k = 0; k < n; k++)
+    x[permutation[k]] = y[k];
+}
+}
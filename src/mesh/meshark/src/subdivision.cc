@@ -0,0 +1,222 @@
+//
+// Created by creeper on 10/16/26.
+//
+#include <meshark/subdivision.h>
+#include <mystl/parallel-for.h>
+#include <atomic>
+#include <cmath>
+#include <iostream>
+#include <limits>
+#include <numbers>
+#include <optional>
+
+namespace meshark {
+
+namespace {
+// Flat connectivity of a closed triangle mesh: half-edge c = 3 f + k leaves corner k of face f, so
+// next, previous and face are index arithmetic and only twins, edges and positions are stored.
+struct TriangleLevel {
+  std::vector<glm::vec3> positions;
+  // Vertex at every corner, the tail of the half-edge leaving it.
+  std::vector<int> corners;
+  std::vector<int> twins;
+  std::vector<int> edges;
+  std::vector<int> edge_half_edges;
+  std::vector<int> vertex_half_edges;
+
+  [[nodiscard]] int numVertices() const {
+    return static_cast<int>(positions.size());
+  }
+  [[nodiscard]] int numEdges() const {
+    return static_cast<int>(edge_half_edges.size());
+  }
+  [[nodiscard]] int numFaces() const {
+    return static_cast<int>(corners.size() / 3);
+  }
+};
+
+int nextHalfEdge(int c) {
+  return c % 3 == 2 ? c - 2 : c + 1;
+}
+
+int prevHalfEdge(int c) {
+  return c % 3 == 0 ? c + 2 : c - 1;
+}
+
+std::optional<TriangleLevel> extractLevel(const GeometryMesh &mesh, int num_threads) {
+  int num_vertices = static_cast<int>(mesh.numVertices());
+  int num_edges = static_cast<int>(mesh.numEdges());
+  int num_faces = static_cast<int>(mesh.numFaces());
+  if (mesh.numHalfEdges() != 3 * mesh.numFaces()) {
+    std::cerr << "Loop subdivision needs a closed triangle mesh" << std::endl;
+    return std::nullopt;
+  }
+  TriangleLevel level;
+  level.positions.resize(num_vertices);
+  level.corners.resize(3 * num_faces);
+  level.twins.resize(3 * num_faces);
+  level.edges.resize(3 * num_faces);
+  level.edge_half_edges.resize(num_edges);
+  level.vertex_half_edges.resize(num_vertices);
+  std::vector<int> codes(mesh.numHalfEdges());
+  std::atomic<bool> valid{true};
+  mystl::parallel_for(0, num_faces, [&](int f) {
+    auto h = mesh.face(f)->halfEdge();
+    if (h->next->next->next != h) {
+      valid = false;
+      return;
+    }
+    for (int k = 0; k < 3; k++, h = h->next) {
+      codes[mesh.index(h)] = 3 * f + k;
+      level.corners[3 * f + k] = mesh.index(h->tail);
+      level.edges[3 * f + k] = mesh.index(h->edge);
+    }
+  }, num_threads);
+  if (!valid) {
+    std::cerr << "Loop subdivision needs a closed triangle mesh" << std::endl;
+    return std::nullopt;
+  }
+  mystl::parallel_for(0, num_faces, [&](int f) {
+    auto h = mesh.face(f)->halfEdge();
+    for (int k = 0; k < 3; k++, h = h->next) {
+      if (!h->twin) {
+        valid = false;
+        return;
+      }
+      level.twins[3 * f + k] = codes[mesh.index(h->twin)];
+    }
+  }, num_threads);
+  mystl::parallel_for(0, num_vertices, [&](int i) {
+    auto v = mesh.vertex(i);
+    if (!v->halfEdge()) {
+      valid = false;
+      return;
+    }
+    level.positions[i] = mesh.pos(v);
+    level.vertex_half_edges[i] = codes[mesh.index(v->halfEdge())];
+  }, num_threads);
+  mystl::parallel_for(0, num_edges, [&](int e) {
+    level.edge_half_edges[e] = codes[mesh.index(mesh.edge(e)->halfEdge())];
+  }, num_threads);
+  if (!valid) {
+    std::cerr << "Loop subdivision needs a closed triangle mesh" << std::endl;
+    return std::nullopt;
+  }
+  return level;
+}
+
+// Half of h_k, the k-th half-edge of face f running from a_k to a_{k + 1}, lies in corner face 4f + k
+// as its half-edge 0 (a_k to m_k), the other half in corner face 4f + k + 1 as its half-edge 2 (m_k to
+// a_{k + 1}). Half-edge 1 of corner face 4f + k runs from m_k to m_{k - 1}, opposite half-edge k - 1 of
+// the middle face. Edge e splits into 2e, at the tail of its half-edge, and 2e + 1; the edge between
+// corner face 4f + k and the middle face is 2E + 3f + k.
+TriangleLevel subdivideLevel(const TriangleLevel &in, int num_threads) {
+  int num_vertices = in.numVertices();
+  int num_edges = in.numEdges();
+  int num_faces = in.numFaces();
+  TriangleLevel out;
+  out.positions.resize(num_vertices + num_edges);
+  out.corners.resize(12 * num_faces);
+  out.twins.resize(12 * num_faces);
+  out.edges.resize(12 * num_faces);
+  out.edge_half_edges.resize(2 * num_edges + 3 * num_faces);
+  out.vertex_half_edges.resize(num_vertices + num_edges);
+  mystl::parallel_for(0, num_faces, [&](int f) {
+    int middle = 3 * (4 * f + 3);
+    for (int k = 0; k < 3; k++) {
+      int c = 3 * f + k;
+      int prev = prevHalfEdge(c);
+      int corner = 3 * (4 * f + k);
+      int e = in.edges[c];
+      int prev_e = in.edges[prev];
+      bool canonical = in.edge_half_edges[e] == c;
+      out.corners[corner] = in.corners[c];
+      out.corners[corner + 1] = num_vertices + e;
+      out.corners[corner + 2] = num_vertices + prev_e;
+      out.corners[middle + k] = num_vertices + e;
+      int twin = in.twins[c];
+      int prev_twin = in.twins[prev];
+      out.twins[corner] = 3 * (4 * (twin / 3) + (twin % 3 + 1) % 3) + 2;
+      out.twins[corner + 1] = middle + (k + 2) % 3;
+      out.twins[corner + 2] = 3 * (4 * (prev_twin / 3) + prev_twin % 3);
+      out.twins[middle + k] = 3 * (4 * f + (k + 1) % 3) + 1;
+      out.edges[corner] = 2 * e + (canonical ? 0 : 1);
+      out.edges[corner + 1] = 2 * num_edges + c;
+      out.edges[corner + 2] = 2 * prev_e + (in.edge_half_edges[prev_e] == prev ? 1 : 0);
+      out.edges[middle + (k + 2) % 3] = 2 * num_edges + c;
+      out.edge_half_edges[2 * num_edges + c] = corner + 1;
+      if (canonical) {
+        out.edge_half_edges[2 * e] = corner;
+        out.edge_half_edges[2 * e + 1] = 3 * (4 * f + (k + 1) % 3) + 2;
+        out.vertex_half_edges[num_vertices + e] = corner + 1;
+      }
+      if (in.vertex_half_edges[in.corners[c]] == c)
+        out.vertex_half_edges[in.corners[c]] = corner;
+    }
+  }, num_threads, 1024);
+  // Edge points weigh the endpoints by 3/8 and the opposite corners by 1/8.
+  mystl::parallel_for(0, num_edges, [&](int e) {
+    int c = in.edge_half_edges[e];
+    const auto &a = in.positions[in.corners[c]];
+    const auto &b = in.positions[in.corners[nextHalfEdge(c)]];
+    const auto &o1 = in.positions[in.corners[prevHalfEdge(c)]];
+    const auto &o2 = in.positions[in.corners[prevHalfEdge(in.twins[c])]];
+    out.positions[num_vertices + e] = (a + b) * 0.375f + (o1 + o2) * 0.125f;
+  }, num_threads, 4096);
+  mystl::parallel_for(0, num_vertices, [&](int v) {
+    int start = in.vertex_half_edges[v];
+    glm::vec3 sum(0.0f);
+    int valence = 0;
+    int c = start;
+    do {
+      sum += in.positions[in.corners[nextHalfEdge(c)]];
+      valence++;
+      c = nextHalfEdge(in.twins[c]);
+    } while (c != start);
+    double w = 0.375 + 0.25 * std::cos(2.0 * std::numbers::pi / valence);
+    auto beta = static_cast<float>((0.625 - w * w) / valence);
+    out.positions[v] = in.positions[v] * (1.0f - static_cast<float>(valence) * beta) + sum * beta;
+  }, num_threads, 4096);
+  return out;
+}
+
+std::unique_ptr<GeometryMesh> buildMesh(const TriangleLevel &level, int num_threads) {
+  auto mesh = std::make_unique<GeometryMesh>();
+  int num_half_edges = 3 * level.numFaces();
+  mesh->allocateElements(level.numVertices(), level.numEdges(), level.numFaces(), num_half_edges, num_threads);
+  mystl::parallel_for(0, num_half_edges, [&](int c) {
+    auto h = mesh->halfEdge(c);
+    h->tail = mesh->vertex(level.corners[c]);
+    h->tip = mesh->vertex(level.corners[nextHalfEdge(c)]);
+    h->next = mesh->halfEdge(nextHalfEdge(c));
+    h->twin = mesh->halfEdge(level.twins[c]);
+    h->face = mesh->face(c / 3);
+    h->edge = mesh->edge(level.edges[c]);
+  }, num_threads, 4096);
+  mystl::parallel_for(0, level.numFaces(), [&](int f) {
+    mesh->face(f)->halfEdge() = mesh->halfEdge(3 * f);
+  }, num_threads, 4096);
+  mystl::parallel_for(0, level.numEdges(), [&](int e) {
+    mesh->edge(e)->halfEdge() = mesh->halfEdge(level.edge_half_edges[e]);
+  }, num_threads, 4096);
+  mystl::parallel_for(0, level.numVertices(), [&](int v) {
+    mesh->vertex(v)->halfEdge() = mesh->halfEdge(level.vertex_half_edges[v]);
+  }, num_threads, 4096);
+  mesh->setVertexPositions(level.positions, num_threads);
+  return mesh;
+}
+}
+
+std::unique_ptr<GeometryMesh> loopSubdivide(const GeometryMesh &mesh, int levels, int num_threads) {
+  if (static_cast<double>(mesh.numFaces()) * 3.0 * std::pow(4.0, levels) > std::numeric_limits<int>::max()) {
+    std::cerr << "Loop subdivision output too large: " << mesh.numFaces() << " faces, " << levels << " levels"
+              << std::endl;
+    return nullptr;
+  }
+  auto level = extractLevel(mesh, num_threads);
+  if (!level) return nullptr;
+  for (int i = 0; i < levels; i++)
+    level = subdivideLevel(*level, num_threads);
+  return buildMesh(*level, num_threads);
+}
+}
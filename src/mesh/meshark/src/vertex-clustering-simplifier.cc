@@ -0,0 +1,114 @@
+//
+// Created by creeper on 10/16/26.
+//
+#include <meshark/vertex-clustering-simplifier.h>
+#include <meshark/quadric.h>
+#include <mystl/parallel-for.h>
+#include <mystl/parallel-sort.h>
+#include <numeric>
+
+namespace meshark {
+
+std::unique_ptr<WavefrontObj> VertexClusteringSimplifier::runSimplify(int target_faces, int num_threads) {
+  if (num_threads <= 0) num_threads = mystl::default_concurrency();
+  int num_vertices = static_cast<int>(mesh.numVertices());
+  int num_faces = static_cast<int>(mesh.numFaces());
+  auto obj = std::make_unique<WavefrontObj>();
+  obj->face_splits.push_back(0);
+  if (num_faces == 0) return obj;
+
+  std::vector<double> face_area(num_faces);
+  mystl::parallel_for(0, num_faces, [&](int i) {
+    auto h = mesh.face(i)->halfEdge();
+    glm::dvec3 p0 = mesh.pos(h->tail), p1 = mesh.pos(h->tip), p2 = mesh.pos(h->next->tip);
+    face_area[i] = 0.5 * glm::length(glm::cross(p1 - p0, p2 - p0));
+  }, num_threads);
+  double total_area = std::accumulate(face_area.begin(), face_area.end(), 0.0);
+  glm::dvec3 lo(std::numeric_limits<double>::max());
+  for (auto v : mesh.vertices())
+    lo = glm::min(lo, glm::dvec3(mesh.pos(v)));
+  // A surface of area A crosses about 1.5 A / s^2 cells of size s on average over all orientations,
+  // and a closed triangle mesh has about twice as many faces as vertices. Cells holding a single
+  // vertex lose fewer faces than that, the constant below is calibrated on the bundled assets.
+  cell_size = std::sqrt(2.5 * total_area / std::max(target_faces, 1));
+  if (!(cell_size > 0)) cell_size = 1.0;
+
+  constexpr int kCoordBits = 21;
+  auto cellCoord = [&](const glm::vec3 &p) {
+    return glm::clamp(glm::i64vec3(glm::floor((glm::dvec3(p) - lo) / cell_size)),
+                      glm::i64vec3(0), glm::i64vec3((int64_t(1) << kCoordBits) - 1));
+  };
+  std::vector<std::pair<uint64_t, int>> keyed_vertices(num_vertices);
+  mystl::parallel_for(0, num_vertices, [&](int i) {
+    auto c = cellCoord(mesh.pos(mesh.vertex(i)));
+    keyed_vertices[i] = {static_cast<uint64_t>(c.x) << (2 * kCoordBits) | static_cast<uint64_t>(c.y) << kCoordBits
+                             | static_cast<uint64_t>(c.z), i};
+  }, num_threads);
+  mystl::parallel_sort(keyed_vertices.begin(), keyed_vertices.end(), std::less<>{}, num_threads);
+
+  std::vector<int> cell_start;
+  std::vector<int> vertex_cell(num_vertices);
+  for (int i = 0; i < num_vertices; i++) {
+    if (i == 0 || keyed_vertices[i].first != keyed_vertices[i - 1].first)
+      cell_start.push_back(i);
+    vertex_cell[keyed_vertices[i].second] = static_cast<int>(cell_start.size()) - 1;
+  }
+  int num_cells = static_cast<int>(cell_start.size());
+  cell_start.push_back(num_vertices);
+
+  std::vector<glm::vec3> representatives(num_cells);
+  mystl::parallel_for(0, num_cells, [&](int c) {
+    Quadric q;
+    glm::dvec3 mean(0.0);
+    for (int i = cell_start[c]; i < cell_start[c + 1]; i++) {
+      auto v = mesh.vertex(keyed_vertices[i].second);
+      glm::dvec3 p = mesh.pos(v);
+      mean += p;
+      for (auto h : v->outgoingHalfEdges()) {
+        glm::dvec3 n = mesh.normal(h->face);
+        q += Quadric::fromPlane(glm::dvec4(n, -glm::dot(n, p)), face_area[mesh.index(h->face)]);
+      }
+    }
+    mean /= static_cast<double>(cell_start[c + 1] - cell_start[c]);
+    auto cell_lo = lo + glm::dvec3(cellCoord(mesh.pos(mesh.vertex(keyed_vertices[cell_start[c]].second)))) * cell_size;
+    representatives[c] = q.boundedMinimizer(mean, cell_lo - 0.5 * cell_size, cell_lo + 1.5 * cell_size);
+  }, num_threads, 64);
+
+  // Faces are rotated so that their smallest cell comes first, which keeps the orientation and makes
+  // duplicates adjacent after sorting.
+  constexpr std::array<int, 3> kDropped{-1, -1, -1};
+  std::vector<std::array<int, 3>> triangles(num_faces);
+  mystl::parallel_for(0, num_faces, [&](int i) {
+    auto h = mesh.face(i)->halfEdge();
+    std::array<int, 3> t{vertex_cell[mesh.index(h->tail)], vertex_cell[mesh.index(h->tip)],
+                         vertex_cell[mesh.index(h->next->tip)]};
+    if (t[0] == t[1] || t[1] == t[2] || t[0] == t[2]) {
+      triangles[i] = kDropped;
+      return;
+    }
+    int first = static_cast<int>(std::min_element(t.begin(), t.end()) - t.begin());
+    triangles[i] = {t[first], t[(first + 1) % 3], t[(first + 2) % 3]};
+  }, num_threads);
+  triangles.erase(std::remove(triangles.begin(), triangles.end(), kDropped), triangles.end());
+  mystl::parallel_sort(triangles.begin(), triangles.end(), std::less<>{}, num_threads);
+  triangles.erase(std::unique(triangles.begin(), triangles.end()), triangles.end());
+
+  std::vector<int> cell_vertex(num_cells, -1);
+  for (const auto &t : triangles)
+    for (int c : t)
+      cell_vertex[c] = 0;
+  for (int c = 0; c < num_cells; c++) {
+    if (cell_vertex[c] < 0) continue;
+    cell_vertex[c] = static_cast<int>(obj->positions.size());
+    obj->positions.push_back(representatives[c]);
+  }
+  obj->face_vertices.resize(3 * triangles.size());
+  obj->face_splits.resize(triangles.size() + 1);
+  mystl::parallel_for(0, static_cast<int>(triangles.size()), [&](int i) {
+    for (int k = 0; k < 3; k++)
+      obj->face_vertices[3 * i + k].v = cell_vertex[triangles[i][k]];
+    obj->face_splits[i + 1] = 3 * (i + 1);
+  }, num_threads);
+  return obj;
+}
+}
@@ -31,6 +31,61 @@ target("project2")
     add_files("src/mesh/meshark/apps/simplify.cc")
     add_deps("meshark")
 
+target("check-determinism")
+    set_kind("binary")
+    add_files("src/mesh/meshark/apps/check-determinism.cc")
+    add_deps("meshark")
+
+target("build-meshlet-dag")
+    set_kind("binary")
+    add_files("src/mesh/meshark/apps/build-meshlet-dag.cc")
+    add_deps("meshark")
+
+target("meshark-simplify-bench")
+    set_kind("binary")
+    add_files("src/mesh/meshark/apps/simplify-bench.cc")
+    add_deps("meshark")
+
+target("meshark-bvh-bench")
+    set_kind("binary")
+    add_files("src/mesh/meshark/apps/bvh-bench.cc")
+    add_deps("meshark")
+
+target("meshark-metro")
+    set_kind("binary")
+    add_files("src/mesh/meshark/apps/metro.cc")
+    add_deps("meshark")
+
+target("meshark-subdivide")
+    set_kind("binary")
+    add_files("src/mesh/meshark/apps/subdivide.cc")
+    add_deps("meshark")
+
+target("meshark-remesh")
+    set_kind("binary")
+    add_files("src/mesh/meshark/apps/remesh.cc")
+    add_deps("meshark")
+
+target("meshark-smooth")
+    set_kind("binary")
+    add_files("src/mesh/meshark/apps/smooth.cc")
+    add_deps("meshark")
+
+target("meshark-geodesic-bench")
+    set_kind("binary")
+    add_files("src/mesh/meshark/apps/geodesic-bench.cc")
+    add_deps("meshark")
+
+target("meshark-components")
+    set_kind("binary")
+    add_files("src/mesh/meshark/apps/components.cc")
+    add_deps("meshark")
+
+target("meshark-curvature")
+    set_kind("binary")
+    add_files("src/mesh/meshark/apps/curvature.cc")
+    add_deps("meshark")
+
 --
 -- If you want to known more usage about xmake, please see https://xmake.io
 --